@@ -0,0 +1,327 @@
+#include "calibration.h"
+#include "profil.h"
+#include "eeprom.h"
+#include "i2c.h"
+#include "test.h"
+
+static const Calibration calibrationParDefaut = CALIBRATION_IDEALE;
+
+Calibration calibration = CALIBRATION_IDEALE;
+
+/** Calibration proposée par le raspberry. */
+static Calibration proposee;
+
+/** Copie de la calibration et de son CRC, à écrire en EEPROM. */
+static unsigned char enregistrement[CALIBRATION_TAILLE + 1];
+
+/** Position du prochain octet à écrire en EEPROM. */
+static volatile unsigned char aEcrire = CALIBRATION_TAILLE + 1;
+
+/** 
+ * Vaut 255 lorsque la calibration appliquée doit être enregistrée.
+ * La commande arrive par l'interruption I2C: seule la boucle principale
+ * prépare et écrit l'enregistrement.
+ */
+static volatile unsigned char aEnregistrer = 0;
+
+/** État de la calibration. */
+static volatile CalibrationEtat etat = CALIBRATION_DEFAUT_UTILISEE;
+
+/**
+ * Calcule le CRC-8 (polynôme 0x07) d'un bloc.
+ * La valeur initiale dépend du profil: une calibration enregistrée par
+ * un autre profil est rejetée.
+ * N'est utilisé qu'au démarrage et lors des enregistrements.
+ * @param donnees Le bloc.
+ * @param taille Sa taille.
+ * @return Le CRC.
+ */
+static unsigned char crc8(const unsigned char *donnees, unsigned char taille) {
+    unsigned char crc = 0xFF ^ PROFIL_IDENTIFIANT;
+    unsigned char n;
+    
+    while (taille-- > 0) {
+        crc ^= *donnees++;
+        for (n = 0; n < 8; n++) {
+            if (crc & 0x80) {
+                crc = (crc << 1) ^ 0x07;
+            } else {
+                crc <<= 1;
+            }
+        }
+    }
+    return crc;
+}
+
+/**
+ * Copie une calibration.
+ */
+static void copie(Calibration *destination, const Calibration *source) {
+    unsigned char n;
+    for (n = 0; n < CALIBRATION_TAILLE; n++) {
+        ((unsigned char *) destination)[n] = ((const unsigned char *) source)[n];
+    }
+}
+
+/**
+ * Vérifie qu'une calibration est utilisable: les gains et décalages
+ * dans leurs limites, et les seuils dans l'ordre, sans atteindre les
+ * bornes de la conversion. Un gain nul, par exemple, ferait lire 0V sur
+ * l'alimentation et déclencherait une défaillance permanente.
+ * @param c La calibration.
+ * @return 255 si elle est utilisable.
+ */
+static unsigned char estValide(const Calibration *c) {
+    unsigned char n;
+
+    for (n = 0; n < CALIBRATION_NOMBRE_CANAUX; n++) {
+        if ((c->gain[n] < CALIBRATION_GAIN_MINIMUM) || (c->gain[n] > CALIBRATION_GAIN_MAXIMUM)) {
+            return 0;
+        }
+        if ((c->decalage[n] < -CALIBRATION_DECALAGE_MAXIMUM) || (c->decalage[n] > CALIBRATION_DECALAGE_MAXIMUM)) {
+            return 0;
+        }
+    }
+    if ((c->alimentationDefaillante == 0)
+            || (c->alimentationDefaillante >= c->alimentationPresente)
+            || (c->alimentationPresente == 255)) {
+        return 0;
+    }
+    if ((c->raspberryInactif == 0) || (c->raspberryInactif == 255)) {
+        return 0;
+    }
+    if ((c->accumulateurAbsent == 0)
+            || (c->accumulateurAbsent >= c->accumulateurPasUtilisable)
+            || (c->accumulateurPasUtilisable >= c->accumulateurFaible)
+            || (c->accumulateurFaible >= c->accumulateurCharge)
+            || (c->accumulateurCharge >= c->accumulateurSurtension)
+            || (c->accumulateurSurtension == 255)) {
+        return 0;
+    }
+    return 255;
+}
+
+/**
+ * Expose la calibration proposée et l'état sur les registres I2C.
+ */
+static void expose() {
+    unsigned char n;
+    for (n = 0; n < CALIBRATION_TAILLE; n++) {
+        i2cExposeRegistre(REGISTRE_CALIBRATION + n, ((unsigned char *) &proposee)[n]);
+    }
+    i2cExposeRegistre(REGISTRE_CALIBRATION_COMMANDE, etat);
+}
+
+void calibrationInitialise() {
+    unsigned char n;
+    
+    for (n = 0; n <= CALIBRATION_TAILLE; n++) {
+        enregistrement[n] = eepromLit(EEPROM_CALIBRATION_DEBUT + n);
+    }
+    if ((crc8(enregistrement, CALIBRATION_TAILLE) == enregistrement[CALIBRATION_TAILLE])
+            && estValide((Calibration *) enregistrement)) {
+        copie(&calibration, (Calibration *) enregistrement);
+        etat = CALIBRATION_EEPROM_UTILISEE;
+    } else {
+        copie(&calibration, &calibrationParDefaut);
+        etat = CALIBRATION_DEFAUT_UTILISEE;
+    }
+    copie(&proposee, &calibration);
+    aEcrire = CALIBRATION_TAILLE + 1;
+    aEnregistrer = 0;
+    expose();
+}
+
+unsigned char calibrationCorrige(unsigned char canal, unsigned char v) {
+    int c;
+    
+    c = (int) (((unsigned int) v * calibration.gain[canal]) >> 7);
+    c += calibration.decalage[canal];
+    if (c < 0) {
+        return 0;
+    }
+    if (c > 255) {
+        return 255;
+    }
+    return (unsigned char) c;
+}
+
+void calibrationPropose(unsigned char position, unsigned char valeur) {
+    if (position < CALIBRATION_TAILLE) {
+        ((unsigned char *) &proposee)[position] = valeur;
+        i2cExposeRegistre(REGISTRE_CALIBRATION + position, valeur);
+    }
+}
+
+void calibrationCommande(unsigned char commande) {
+    switch (commande) {
+        case CALIBRATION_PAR_DEFAUT:
+            copie(&proposee, &calibrationParDefaut);
+            // Continue avec CALIBRATION_APPLIQUE.
+        case CALIBRATION_APPLIQUE:
+            if (!estValide(&proposee)) {
+                etat = CALIBRATION_REJETEE;
+                i2cExposeRegistre(REGISTRE_CALIBRATION_COMMANDE, etat);
+                break;
+            }
+            copie(&calibration, &proposee);
+            aEnregistrer = 255;
+            etat = CALIBRATION_EN_ECRITURE;
+            expose();
+            break;
+    }
+}
+
+void calibrationEcrit() {
+    // Prépare l'enregistrement une fois l'écriture précédente terminée.
+    // Une commande reçue pendant la copie en demande un nouveau:
+    if (aEcrire > CALIBRATION_TAILLE) {
+        if (!aEnregistrer) {
+            return;
+        }
+        aEnregistrer = 0;
+        copie((Calibration *) enregistrement, &calibration);
+        enregistrement[CALIBRATION_TAILLE] = crc8(enregistrement, CALIBRATION_TAILLE);
+        aEcrire = 0;
+    }
+    if (eepromEcrit(EEPROM_CALIBRATION_DEBUT + aEcrire, enregistrement[aEcrire])) {
+        if ((++aEcrire > CALIBRATION_TAILLE) && !aEnregistrer) {
+            etat = CALIBRATION_EEPROM_UTILISEE;
+            i2cExposeRegistre(REGISTRE_CALIBRATION_COMMANDE, etat);
+        }
+    }
+}
+
+#ifdef TEST
+
+static void ecritTout() {
+    while (etat == CALIBRATION_EN_ECRITURE) {
+        while (eepromOccupee());
+        calibrationEcrit();
+    }
+    while (eepromOccupee());
+}
+
+static void corrige_le_gain_et_le_decalage() {
+    calibrationCommande(CALIBRATION_PAR_DEFAUT);
+    verifieEgalite("CALCO01", calibrationCorrige(0, 200), 200);
+
+    calibrationPropose(0, 132);         // Gain de 1.031 sur ALIMENTATION.
+    calibrationPropose(4, (unsigned char) -3);  // Décalage de -3 sur BOOST.
+    verifieEgalite("CALCO02", calibrationCorrige(0, 200), 200);
+    calibrationCommande(CALIBRATION_APPLIQUE);
+    verifieEgalite("CALCO03", calibrationCorrige(0, 200), 206);
+    verifieEgalite("CALCO04", calibrationCorrige(0, 255), 255);
+    verifieEgalite("CALCO05", calibrationCorrige(1, 200), 197);
+    verifieEgalite("CALCO06", calibrationCorrige(1, 2), 0);
+    verifieEgalite("CALCO07", calibrationCorrige(2, 100), 100);
+    ecritTout();
+}
+
+static void retrouve_la_calibration_en_eeprom() {
+    calibrationCommande(CALIBRATION_PAR_DEFAUT);
+    calibrationPropose(6, 185);         // Seuil de défaillance de l'alimentation.
+    calibrationCommande(CALIBRATION_APPLIQUE);
+    ecritTout();
+
+    calibration.alimentationDefaillante = 0;
+    calibrationInitialise();
+    verifieEgalite("CALEE01", calibration.alimentationDefaillante, 185);
+    verifieEgalite("CALEE02", calibration.alimentationPresente, 198);
+}
+
+static void utilise_la_calibration_par_defaut_si_le_crc_est_faux() {
+    calibrationCommande(CALIBRATION_PAR_DEFAUT);
+    calibrationPropose(6, 185);
+    calibrationCommande(CALIBRATION_APPLIQUE);
+    ecritTout();
+    
+    while (!eepromEcrit(EEPROM_CALIBRATION_DEBUT + 9, 0));
+    while (eepromOccupee());
+    calibrationInitialise();
+    verifieEgalite("CALCR01", calibration.alimentationDefaillante, 180);
+    verifieEgalite("CALCR02", calibration.alimentationPresente, 198);
+}
+
+static void une_commande_pendant_l_ecriture_est_enregistree_ensuite() {
+    unsigned char n;
+
+    calibrationCommande(CALIBRATION_PAR_DEFAUT);
+    calibrationPropose(6, 185);
+    calibrationCommande(CALIBRATION_APPLIQUE);
+    for (n = 0; n < 3; n++) {
+        while (eepromOccupee());
+        calibrationEcrit();
+    }
+    calibrationPropose(6, 175);
+    calibrationCommande(CALIBRATION_APPLIQUE);
+    verifieEgalite("CALEC01", etat, CALIBRATION_EN_ECRITURE);
+    ecritTout();
+    verifieEgalite("CALEC02", etat, CALIBRATION_EEPROM_UTILISEE);
+
+    calibration.alimentationDefaillante = 0;
+    calibrationInitialise();
+    verifieEgalite("CALEC03", etat, CALIBRATION_EEPROM_UTILISEE);
+    verifieEgalite("CALEC04", calibration.alimentationDefaillante, 175);
+}
+
+static void refuse_une_calibration_hors_limites() {
+    calibrationCommande(CALIBRATION_PAR_DEFAUT);
+    ecritTout();
+
+    // Un gain nul sur ALIMENTATION:
+    calibrationPropose(0, 0);
+    calibrationCommande(CALIBRATION_APPLIQUE);
+    verifieEgalite("CALLI01", etat, CALIBRATION_REJETEE);
+    verifieEgalite("CALLI02", calibration.gain[0], CALIBRATION_GAIN_UNITAIRE);
+    verifieEgalite("CALLI03", calibrationCorrige(0, 200), 200);
+
+    // Des seuils d'alimentation inversés:
+    calibrationPropose(0, CALIBRATION_GAIN_UNITAIRE);
+    calibrationPropose(6, 200);
+    calibrationCommande(CALIBRATION_APPLIQUE);
+    verifieEgalite("CALLI04", etat, CALIBRATION_REJETEE);
+    verifieEgalite("CALLI05", calibration.alimentationDefaillante, 180);
+
+    // Un seuil de surtension que la conversion ne peut dépasser:
+    calibrationPropose(6, 180);
+    calibrationPropose(13, 255);
+    calibrationCommande(CALIBRATION_APPLIQUE);
+    verifieEgalite("CALLI06", etat, CALIBRATION_REJETEE);
+
+    // Corrigée, la calibration est acceptée:
+    calibrationPropose(13, PROFIL_SEUIL_SURTENSION);
+    calibrationCommande(CALIBRATION_APPLIQUE);
+    verifieEgalite("CALLI07", etat, CALIBRATION_EN_ECRITURE);
+    ecritTout();
+}
+
+static void rejette_une_calibration_hors_limites_en_eeprom() {
+    unsigned char n;
+
+    // Un gain nul, avec un CRC correct:
+    copie((Calibration *) enregistrement, &calibrationParDefaut);
+    enregistrement[0] = 0;
+    enregistrement[CALIBRATION_TAILLE] = crc8(enregistrement, CALIBRATION_TAILLE);
+    for (n = 0; n <= CALIBRATION_TAILLE; n++) {
+        while (!eepromEcrit(EEPROM_CALIBRATION_DEBUT + n, enregistrement[n]));
+    }
+    while (eepromOccupee());
+    calibrationInitialise();
+    verifieEgalite("CALLI08", etat, CALIBRATION_DEFAUT_UTILISEE);
+    verifieEgalite("CALLI09", calibration.gain[0], CALIBRATION_GAIN_UNITAIRE);
+}
+
+void testeCalibration() {
+    corrige_le_gain_et_le_decalage();
+    refuse_une_calibration_hors_limites();
+    rejette_une_calibration_hors_limites_en_eeprom();
+    retrouve_la_calibration_en_eeprom();
+    utilise_la_calibration_par_defaut_si_le_crc_est_faux();
+    une_commande_pendant_l_ecriture_est_enregistree_ensuite();
+    
+    calibrationCommande(CALIBRATION_PAR_DEFAUT);
+    ecritTout();
+}
+
+#endif
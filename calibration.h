@@ -0,0 +1,134 @@
+#ifndef CALIBRATION_H
+#define	CALIBRATION_H
+
+/** Nombre de canaux analogiques calibrés (ALIMENTATION, BOOST, ACCUMULATEUR). */
+#define CALIBRATION_NOMBRE_CANAUX 3
+
+/** Gain correspondant à 1.0. */
+#define CALIBRATION_GAIN_UNITAIRE 128
+
+/** Gains acceptés, de 0.75 à 1.25: au-delà, le circuit est défectueux. */
+#define CALIBRATION_GAIN_MINIMUM 96
+#define CALIBRATION_GAIN_MAXIMUM 160
+
+/** Décalage accepté, en valeur absolue. */
+#define CALIBRATION_DECALAGE_MAXIMUM 32
+
+/**
+ * Calibration du circuit: corrections des canaux analogiques, et seuils
+ * de l'administration d'énergie, exprimés en valeurs corrigées.
+ */
+typedef struct {
+    /** Gain de chaque canal, en 1/128. */
+    unsigned char gain[CALIBRATION_NOMBRE_CANAUX];
+    /** Décalage de chaque canal, ajouté après le gain. */
+    signed char decalage[CALIBRATION_NOMBRE_CANAUX];
+    /** L'alimentation fait défaut en dessous de ce seuil (7.05V). */
+    unsigned char alimentationDefaillante;
+    /** L'alimentation est de retour au dessus de ce seuil (7.8V). */
+    unsigned char alimentationPresente;
+    /** Le raspberry ne consomme plus au dessus de ce seuil du Boost (9.5V). */
+    unsigned char raspberryInactif;
+    /** L'accumulateur est absent en dessous de ce seuil (voir profil.h). */
+    unsigned char accumulateurAbsent;
+    /** L'accumulateur n'est pas utilisable jusqu'à ce seuil (voir profil.h). */
+    unsigned char accumulateurPasUtilisable;
+    /** L'accumulateur est faible jusqu'à ce seuil (voir profil.h). */
+    unsigned char accumulateurFaible;
+    /** L'accumulateur est chargé à partir de ce seuil (voir profil.h). */
+    unsigned char accumulateurCharge;
+    /** L'accumulateur est absent au dessus de ce seuil (voir profil.h). */
+    unsigned char accumulateurSurtension;
+} Calibration;
+
+/**
+ * Calibration d'un circuit idéal: diviseurs de 1/2 et référence de 5V,
+ * avec les seuils de l'accumulateur du profil.
+ */
+#define CALIBRATION_IDEALE {                                                            \
+    {CALIBRATION_GAIN_UNITAIRE, CALIBRATION_GAIN_UNITAIRE, CALIBRATION_GAIN_UNITAIRE},  \
+    {0, 0, 0},                                                                          \
+    180, 198,                                                                           \
+    241,                                                                                \
+    PROFIL_SEUIL_ABSENT, PROFIL_SEUIL_PAS_UTILISABLE, PROFIL_SEUIL_FAIBLE,              \
+    PROFIL_SEUIL_CHARGE, PROFIL_SEUIL_SURTENSION                                        \
+}
+
+/** Taille de la calibration, en octets. */
+#define CALIBRATION_TAILLE (2 * CALIBRATION_NOMBRE_CANAUX + 8)
+
+/**
+ * Énumère les commandes de calibration.
+ */
+typedef enum {
+    /** Applique la calibration proposée, et l'écrit en EEPROM. */
+    CALIBRATION_APPLIQUE = 0xA5,
+    /** Revient à la calibration par défaut, et l'écrit en EEPROM. */
+    CALIBRATION_PAR_DEFAUT = 0x5A
+} CalibrationCommande;
+
+/**
+ * Énumère les états de la calibration.
+ */
+typedef enum {
+    /** La calibration par défaut est utilisée. */
+    CALIBRATION_DEFAUT_UTILISEE = 0,
+    /** La calibration provient de l'EEPROM. */
+    CALIBRATION_EEPROM_UTILISEE = 1,
+    /** La calibration est en cours d'écriture en EEPROM. */
+    CALIBRATION_EN_ECRITURE = 2,
+    /** 
+     * La calibration proposée a été refusée: un gain ou un décalage hors
+     * limites, ou des seuils inversés. La calibration actuelle est gardée.
+     */
+    CALIBRATION_REJETEE = 3
+} CalibrationEtat;
+
+/**
+ * Calibration actuelle, lue par les mesures.
+ */
+extern Calibration calibration;
+
+/**
+ * Charge la calibration depuis l'EEPROM. Si son CRC n'est pas valide,
+ * ou si elle est hors limites, la calibration par défaut est utilisée.
+ * Bloque pendant la lecture de l'EEPROM.
+ */
+void calibrationInitialise();
+
+/**
+ * Corrige une conversion selon le gain et le décalage du canal.
+ * @param canal Le canal analogique.
+ * @param v La valeur convertie.
+ * @return La valeur corrigée.
+ */
+unsigned char calibrationCorrige(unsigned char canal, unsigned char v);
+
+/**
+ * Modifie un octet de la calibration proposée. 
+ * La calibration actuelle n'est pas modifiée avant la commande
+ * CALIBRATION_APPLIQUE.
+ * @param position La position de l'octet dans la calibration.
+ * @param valeur La valeur.
+ */
+void calibrationPropose(unsigned char position, unsigned char valeur);
+
+/**
+ * Exécute une commande de calibration. CALIBRATION_APPLIQUE refuse une
+ * calibration hors limites, et passe à l'état CALIBRATION_REJETEE.
+ * @param commande Voir CalibrationCommande.
+ */
+void calibrationCommande(unsigned char commande);
+
+/**
+ * Écrit en EEPROM le prochain octet de la calibration, si l'EEPROM n'est
+ * pas occupée. L'enregistrement est préparé ici, après la commande
+ * CALIBRATION_APPLIQUE. À appeler depuis la boucle principale.
+ */
+void calibrationEcrit();
+
+#ifdef TEST
+void testeCalibration();
+#endif
+
+#endif
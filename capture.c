@@ -0,0 +1,300 @@
+#include "capture.h"
+#include "test.h"
+
+/** Taille d'un échantillon, en octets: minimum et maximum de chaque canal. */
+#define CAPTURE_TAILLE_ECHANTILLON (2 * CAPTURE_NOMBRE_CANAUX)
+
+/** Taille de l'anneau, en octets. */
+#define CAPTURE_TAILLE (CAPTURE_ECHANTILLONS * CAPTURE_TAILLE_ECHANTILLON)
+
+/** Taille de la lecture, en octets. */
+#define CAPTURE_TAILLE_LECTURE (CAPTURE_TAILLE_EN_TETE + CAPTURE_TAILLE)
+
+/** Vérifie à la compilation que l'anneau peut se parcourir par masque. */
+typedef char verifieTailleAnneau[(CAPTURE_ECHANTILLONS & (CAPTURE_ECHANTILLONS - 1)) ? -1 : 1];
+
+/** Anneau des échantillons, minimum puis maximum de chaque canal. */
+static unsigned char anneau[CAPTURE_TAILLE];
+
+/** Minimum et maximum de chaque canal, sur la fenêtre de l'échantillon. */
+static unsigned char minimums[CAPTURE_NOMBRE_CANAUX];
+static unsigned char maximums[CAPTURE_NOMBRE_CANAUX];
+
+/** Position, en octets, du prochain échantillon à écrire dans l'anneau. */
+static unsigned int position;
+
+/** Nombre de séquences avant le prochain échantillon. */
+static unsigned char sequences;
+
+/** Nombre d'échantillons à enregistrer avant de figer la capture. */
+static unsigned char restants;
+
+static CaptureEtat etat;
+
+static CaptureCause cause;
+
+/** Position du prochain octet à rendre par captureLecture. */
+static unsigned int lecture;
+
+/** Indique qu'une lecture est en cours: l'anneau n'avance pas. */
+static unsigned char gele;
+
+/**
+ * Commence la fenêtre de l'échantillon suivant.
+ */
+static void fenetreInitialise() {
+    unsigned char n;
+
+    for (n = 0; n < CAPTURE_NOMBRE_CANAUX; n++) {
+        minimums[n] = 255;
+        maximums[n] = 0;
+    }
+}
+
+void captureInitialise() {
+    unsigned int n;
+    
+    for (n = 0; n < CAPTURE_TAILLE; n++) {
+        anneau[n] = 0;
+    }
+    fenetreInitialise();
+    position = 0;
+    sequences = CAPTURE_DECIMATION;
+    etat = CAPTURE_EN_ATTENTE;
+    cause = CAPTURE_AUCUNE;
+    gele = 0;
+}
+
+void captureMesure(unsigned char canal, unsigned char valeur) {
+    if (valeur < minimums[canal]) {
+        minimums[canal] = valeur;
+    }
+    if (valeur > maximums[canal]) {
+        maximums[canal] = valeur;
+    }
+}
+
+void captureSequence() {
+    unsigned char n;
+
+    if (--sequences) {
+        return;
+    }
+    sequences = CAPTURE_DECIMATION;
+    if (gele || (etat == CAPTURE_FIGEE)) {
+        fenetreInitialise();
+        return;
+    }
+    for (n = 0; n < CAPTURE_NOMBRE_CANAUX; n++) {
+        anneau[position++] = minimums[n];
+        anneau[position++] = maximums[n];
+    }
+    fenetreInitialise();
+    if (position >= CAPTURE_TAILLE) {
+        position = 0;
+    }
+    if (etat == CAPTURE_DECLENCHEE) {
+        if (--restants == 0) {
+            etat = CAPTURE_FIGEE;
+        }
+    }
+}
+
+void captureDeclenche(CaptureCause c) {
+    if (etat == CAPTURE_EN_ATTENTE) {
+        etat = CAPTURE_DECLENCHEE;
+        cause = c;
+        restants = CAPTURE_APRES;
+    }
+}
+
+unsigned char captureLecture(unsigned char premier) {
+    unsigned int n;
+
+    if (premier) {
+        lecture = 0;
+        gele = 255;
+    }
+    if (lecture >= CAPTURE_TAILLE_LECTURE) {
+        return 0;
+    }
+    n = lecture++;
+    switch (n) {
+        case 0:
+            return etat;
+        case 1:
+            return cause;
+        case 2:
+            return CAPTURE_AVANT;
+        case 3:
+            return CAPTURE_DECIMATION;
+    }
+    
+    // L'échantillon le plus ancien est celui qui sera écrit ensuite:
+    n += position - CAPTURE_TAILLE_EN_TETE;
+    if (n >= CAPTURE_TAILLE) {
+        n -= CAPTURE_TAILLE;
+    }
+    if (lecture == CAPTURE_TAILLE_LECTURE) {
+        gele = 0;
+        if (etat == CAPTURE_FIGEE) {
+            etat = CAPTURE_EN_ATTENTE;
+            cause = CAPTURE_AUCUNE;
+        }
+    }
+    return anneau[n];
+}
+
+void captureFinLecture() {
+    gele = 0;
+}
+
+#ifdef TEST
+
+/**
+ * Ajoute un échantillon à l'anneau, avec la même valeur pour chaque canal.
+ */
+static void echantillon(unsigned char valeur) {
+    unsigned char n;
+    
+    for (n = 0; n < CAPTURE_NOMBRE_CANAUX; n++) {
+        captureMesure(n, valeur + n);
+    }
+    for (n = 0; n < CAPTURE_DECIMATION; n++) {
+        captureSequence();
+    }
+}
+
+/**
+ * Lit l'échantillon suivant, et rend le minimum de son premier canal.
+ */
+static unsigned char litEchantillon() {
+    unsigned char n, valeur;
+    
+    valeur = captureLecture(0);
+    for (n = 1; n < CAPTURE_TAILLE_ECHANTILLON; n++) {
+        captureLecture(0);
+    }
+    return valeur;
+}
+
+static void fige_la_capture_apres_le_declenchement() {
+    unsigned char n;
+
+    captureInitialise();
+    for (n = 0; n < 200; n++) {
+        echantillon(n);
+    }
+    captureDeclenche(CAPTURE_ALIMENTATION);
+    for (n = 0; n < CAPTURE_APRES - 1; n++) {
+        echantillon(n);
+    }
+    verifieEgalite("CAPDE01", etat, CAPTURE_DECLENCHEE);
+    echantillon(CAPTURE_APRES - 1);
+    verifieEgalite("CAPDE02", etat, CAPTURE_FIGEE);
+    echantillon(250);
+
+    verifieEgalite("CAPDE03", captureLecture(255), CAPTURE_FIGEE);
+    verifieEgalite("CAPDE04", captureLecture(0), CAPTURE_ALIMENTATION);
+    verifieEgalite("CAPDE05", captureLecture(0), CAPTURE_AVANT);
+    verifieEgalite("CAPDE06", captureLecture(0), CAPTURE_DECIMATION);
+    verifieEgalite("CAPDE07", litEchantillon(), 200 - CAPTURE_AVANT);
+    for (n = 1; n < CAPTURE_AVANT; n++) {
+        litEchantillon();
+    }
+    verifieEgalite("CAPDE08", litEchantillon(), 0);
+    verifieEgalite("CAPDE09", captureLecture(0), 1);
+    verifieEgalite("CAPDE10", captureLecture(0), 1);
+    verifieEgalite("CAPDE11", captureLecture(0), 2);
+}
+
+static void libere_la_capture_apres_une_lecture_complete() {
+    unsigned int n;
+
+    captureInitialise();
+    captureDeclenche(CAPTURE_RASPBERRY);
+    for (n = 0; n < CAPTURE_APRES; n++) {
+        echantillon(1);
+    }
+    captureDeclenche(CAPTURE_ALIMENTATION);
+    captureLecture(255);
+    verifieEgalite("CAPLI01", captureLecture(0), CAPTURE_RASPBERRY);
+    for (n = 2; n < CAPTURE_TAILLE_LECTURE - 1; n++) {
+        captureLecture(0);
+    }
+    verifieEgalite("CAPLI02", etat, CAPTURE_FIGEE);
+    captureLecture(0);
+    verifieEgalite("CAPLI03", etat, CAPTURE_EN_ATTENTE);
+    verifieEgalite("CAPLI04", captureLecture(0), 0);
+}
+
+static void n_avance_pas_pendant_une_lecture() {
+    captureInitialise();
+    echantillon(10);
+    captureLecture(255);
+    echantillon(20);
+    verifieEgalite("CAPGE01", position, CAPTURE_TAILLE_ECHANTILLON);
+}
+
+static void reprend_apres_une_lecture_interrompue() {
+    unsigned char n;
+
+    captureInitialise();
+    captureDeclenche(CAPTURE_RASPBERRY);
+    for (n = 0; n < CAPTURE_APRES; n++) {
+        echantillon(1);
+    }
+    captureLecture(255);
+    captureLecture(0);
+    captureFinLecture();
+    verifieEgalite("CAPIN01", etat, CAPTURE_FIGEE);
+
+    captureInitialise();
+    echantillon(10);
+    captureLecture(255);
+    captureLecture(0);
+    captureFinLecture();
+    echantillon(20);
+    verifieEgalite("CAPIN02", position, 2 * CAPTURE_TAILLE_ECHANTILLON);
+}
+
+static void garde_le_minimum_et_le_maximum_de_chaque_fenetre() {
+    unsigned int n;
+
+    captureInitialise();
+    for (n = 0; n < CAPTURE_DECIMATION; n++) {
+        captureMesure(0, 200);
+        captureMesure(CAPTURE_CANAL_REFERENCE, 128);
+        if (n == 1) {
+            captureMesure(0, 120);
+            captureMesure(CAPTURE_CANAL_REFERENCE, 160);
+        }
+        captureSequence();
+    }
+    echantillon(50);
+    captureLecture(255);
+    for (n = 1; n < CAPTURE_TAILLE_EN_TETE + (CAPTURE_ECHANTILLONS - 2) * CAPTURE_TAILLE_ECHANTILLON; n++) {
+        captureLecture(0);
+    }
+    verifieEgalite("CAPMM01", captureLecture(0), 120);
+    verifieEgalite("CAPMM02", captureLecture(0), 200);
+    for (n = 2; n < 2 * CAPTURE_CANAL_REFERENCE; n++) {
+        captureLecture(0);
+    }
+    verifieEgalite("CAPMM03", captureLecture(0), 128);
+    verifieEgalite("CAPMM04", captureLecture(0), 160);
+
+    // La fenêtre suivante recommence:
+    verifieEgalite("CAPMM05", litEchantillon(), 50);
+    captureFinLecture();
+}
+
+void testeCapture() {
+    fige_la_capture_apres_le_declenchement();
+    garde_le_minimum_et_le_maximum_de_chaque_fenetre();
+    libere_la_capture_apres_une_lecture_complete();
+    n_avance_pas_pendant_une_lecture();
+    reprend_apres_une_lecture_interrompue();
+}
+
+#endif
@@ -0,0 +1,119 @@
+#ifndef CAPTURE_H
+#define	CAPTURE_H
+
+/**
+ * Capture des conversions autour des événements d'alimentation, comme
+ * un oscilloscope en mode déclenché: un anneau garde les derniers 
+ * échantillons de chaque canal; lorsque l'état de l'alimentation ou du
+ * raspberry change, l'anneau se fige CAPTURE_APRES échantillons plus tard.
+ * La capture se lit en une rafale à l'adresse LECTURE_CAPTURE, puis 
+ * l'anneau repart.
+ * Les conversions sont capturées brutes, avant filtre et compensation,
+ * et chaque échantillon garde le minimum et le maximum de chaque canal
+ * sur sa fenêtre: un creux plus bref qu'un échantillon reste visible.
+ */
+
+/** 
+ * Nombre de canaux capturés (ALIMENTATION, BOOST, ACCUMULATEUR, 
+ * THERMISTANCE, puis la référence fixe).
+ */
+#define CAPTURE_NOMBRE_CANAUX 5
+
+/** 
+ * Canal de la référence fixe: sa conversion monte quand VDD baisse.
+ */
+#define CAPTURE_CANAL_REFERENCE 4
+
+/** Nombre d'échantillons avant le déclenchement. */
+#define CAPTURE_AVANT 32
+
+/** Nombre d'échantillons après le déclenchement. */
+#define CAPTURE_APRES 32
+
+/** Nombre d'échantillons de l'anneau (une puissance de 2). */
+#define CAPTURE_ECHANTILLONS (CAPTURE_AVANT + CAPTURE_APRES)
+
+/** 
+ * Nombre de séquences de conversions par échantillon. Une séquence
+ * dure 5ms: un échantillon toutes les 40ms, soit 1.28s de chaque côté
+ * du déclenchement.
+ */
+#define CAPTURE_DECIMATION 8
+
+/** Taille de l'en-tête de la lecture, en octets. */
+#define CAPTURE_TAILLE_EN_TETE 4
+
+/**
+ * Énumère les états de la capture.
+ */
+typedef enum {
+    /** L'anneau enregistre, en attente d'un déclenchement. */
+    CAPTURE_EN_ATTENTE = 0,
+    /** Déclenchée: l'anneau enregistre les échantillons suivants. */
+    CAPTURE_DECLENCHEE = 1,
+    /** Figée: la capture est prête à être lue. */
+    CAPTURE_FIGEE = 2
+} CaptureEtat;
+
+/**
+ * Énumère les causes du déclenchement.
+ */
+typedef enum {
+    CAPTURE_AUCUNE = 0,
+    /** L'alimentation fait défaut, ou revient. */
+    CAPTURE_ALIMENTATION = 1,
+    /** Le raspberry cesse de consommer. */
+    CAPTURE_RASPBERRY = 2
+} CaptureCause;
+
+/**
+ * Vide l'anneau, et attend un déclenchement.
+ */
+void captureInitialise();
+
+/**
+ * Retient une conversion d'un canal dans le minimum et le maximum du
+ * prochain échantillon.
+ * @param canal Le canal, entre 0 et CAPTURE_NOMBRE_CANAUX - 1.
+ * @param valeur La conversion brute (ADRESH).
+ */
+void captureMesure(unsigned char canal, unsigned char valeur);
+
+/**
+ * Signale la fin d'une séquence de conversions. Une séquence sur
+ * CAPTURE_DECIMATION ajoute un échantillon à l'anneau, et commence
+ * la fenêtre du suivant.
+ */
+void captureSequence();
+
+/**
+ * Déclenche la capture, si elle est en attente.
+ * @param cause Voir CaptureCause.
+ */
+void captureDeclenche(CaptureCause cause);
+
+/**
+ * Rend la capture, octet par octet, pour la lecture I2C à l'adresse 
+ * LECTURE_CAPTURE. Un en-tête (état, cause, CAPTURE_AVANT, 
+ * CAPTURE_DECIMATION), puis les CAPTURE_ECHANTILLONS échantillons du
+ * plus ancien au plus récent: pour chaque canal, le minimum puis le
+ * maximum.
+ * L'anneau est gelé pendant la lecture, jusqu'à captureFinLecture. Une
+ * fois lue jusqu'au bout, une capture figée est libérée et l'anneau 
+ * attend le déclenchement suivant.
+ * @param premier Différent de 0 pour le premier octet de la lecture.
+ * @return L'octet suivant.
+ */
+unsigned char captureLecture(unsigned char premier);
+
+/**
+ * La lecture I2C est terminée, complète ou interrompue: l'anneau avance
+ * à nouveau. Une capture figée qui n'a pas été lue jusqu'au bout le reste.
+ */
+void captureFinLecture();
+
+#ifdef TEST
+void testeCapture();
+#endif
+
+#endif
@@ -0,0 +1,334 @@
+#include "charge.h"
+#include "i2c.h"
+#include "test.h"
+
+#ifdef PROFIL_CHARGE_DELTA_V
+
+/** Indique si l'accumulateur est en charge. */
+static unsigned char enCharge = 0;
+
+/** Raison de la fin de la dernière charge. */
+static ChargeFin fin = CHARGE_AUCUNE;
+
+/** Indique si la charge en cours est abandonnée. */
+static unsigned char abandonnee = 0;
+
+/** Somme des échantillons en cours de décimation. */
+static unsigned int somme;
+
+/** Nombre d'échantillons dans la somme, modulo CHARGE_DECIMATION. */
+static unsigned char nombre;
+
+/** Fenêtre glissante des derniers échantillons décimés. */
+static unsigned int fenetre[CHARGE_FENETRE];
+
+/** Position du prochain échantillon décimé dans la fenêtre. */
+static unsigned char position;
+
+/** Nombre d'échantillons décimés dans la fenêtre, jusqu'à ce qu'elle soit pleine. */
+static unsigned char remplissage;
+
+/** Somme des échantillons décimés de la fenêtre. */
+static unsigned long total;
+
+/** Pic de la moyenne de la fenêtre, en 1/256 de pas de conversion. */
+static unsigned int pic;
+
+/** Secondes et minutes écoulées depuis le début de la charge. */
+static unsigned char secondes;
+static unsigned int minutes;
+
+#ifdef PROFIL_DELTA_T_DEGRES
+/** Nombre de minutes entre deux comparaisons de température. */
+#define CHARGE_DELTA_T_MINUTES 3
+
+/** Dernière température mesurée. */
+static signed char temperature;
+
+/** Température lors de la dernière comparaison. */
+static signed char temperatureReference;
+
+/** Indique si la température de référence est établie. */
+static unsigned char referenceEtablie;
+#endif
+
+/**
+ * Termine la charge.
+ * @param raison Voir ChargeFin.
+ */
+static void termine(ChargeFin raison) {
+    fin = raison;
+    i2cExposeRegistre(REGISTRE_FIN_CHARGE, fin);
+}
+
+/**
+ * Commence une nouvelle charge.
+ */
+static void demarre() {
+    unsigned char n;
+
+    for (n = 0; n < CHARGE_FENETRE; n++) {
+        fenetre[n] = 0;
+    }
+    somme = 0;
+    nombre = 0;
+    position = 0;
+    remplissage = 0;
+    total = 0;
+    pic = 0;
+    secondes = 0;
+    minutes = 0;
+#ifdef PROFIL_DELTA_T_DEGRES
+    referenceEtablie = 0;
+#endif
+    enCharge = 1;
+    abandonnee = 0;
+    termine(CHARGE_EN_COURS);
+}
+
+void chargeInitialise() {
+    enCharge = 0;
+    abandonnee = 0;
+    fin = CHARGE_AUCUNE;
+}
+
+void chargeInterrompt() {
+    enCharge = 0;
+}
+
+void chargeAbandonne() {
+    enCharge = 0;
+    abandonnee = 1;
+}
+
+unsigned char chargeMesureAccumulateur(unsigned char v) {
+    unsigned int moyenne;
+
+    if (!enCharge) {
+        if (fin != CHARGE_EN_COURS || abandonnee) {
+            demarre();
+        } else {
+            enCharge = 1;
+        }
+    }
+    if (fin != CHARGE_EN_COURS) {
+        return 1;
+    }
+
+    // Décimation:
+    somme += v;
+    if (++nombre != (unsigned char) CHARGE_DECIMATION) {
+        return 0;
+    }
+    total -= fenetre[position];
+    fenetre[position] = somme;
+    total += somme;
+    position = (position + 1) & (CHARGE_FENETRE - 1);
+    somme = 0;
+
+    // Attend que la fenêtre soit pleine:
+    if (remplissage < CHARGE_FENETRE) {
+        remplissage++;
+        return 0;
+    }
+    
+    // Pendant l'attente, la tension n'est pas significative:
+    if (minutes < CHARGE_ATTENTE_MINUTES) {
+        return 0;
+    }
+
+    // Suit le pic, et détecte la chute:
+    moyenne = (unsigned int) (total / CHARGE_FENETRE);
+    if (moyenne > pic) {
+        pic = moyenne;
+    } else if (pic - moyenne >= CHARGE_DELTA_V) {
+        termine(CHARGE_FIN_DELTA_V);
+        return 1;
+    }
+    return 0;
+}
+
+void chargeMesureTemperature(signed char degres) {
+#ifdef PROFIL_DELTA_T_DEGRES
+    temperature = degres;
+#endif
+}
+
+unsigned char chargeSeconde() {
+    if (!enCharge) {
+        return 0;
+    }
+    if (fin != CHARGE_EN_COURS) {
+        return 1;
+    }
+    if (++secondes < 60) {
+        return 0;
+    }
+    secondes = 0;
+    minutes++;
+
+    if (minutes >= CHARGE_DUREE_MAXIMALE_MINUTES) {
+        termine(CHARGE_FIN_MINUTERIE);
+        return 1;
+    }
+
+#ifdef PROFIL_DELTA_T_DEGRES
+    if (minutes % CHARGE_DELTA_T_MINUTES == 0) {
+        if (referenceEtablie && (temperature - temperatureReference >= PROFIL_DELTA_T_DEGRES)) {
+            termine(CHARGE_FIN_DELTA_T);
+            return 1;
+        }
+        temperatureReference = temperature;
+        referenceEtablie = 1;
+    }
+#endif
+    return 0;
+}
+
+#ifdef TEST
+
+#include "energie.h"
+
+static unsigned char echantillons(unsigned char v, unsigned int n) {
+    unsigned char terminee = 0;
+    while (n-- > 0) {
+        terminee = chargeMesureAccumulateur(v);
+    }
+    return terminee;
+}
+
+static unsigned char secondesDeCharge(unsigned int n) {
+    unsigned char terminee = 0;
+    while (n-- > 0) {
+        terminee = chargeSeconde();
+    }
+    return terminee;
+}
+
+static void termine_la_charge_quand_la_tension_baisse_apres_le_pic() {
+    chargeInitialise();
+    echantillons(105, 1);
+    secondesDeCharge(CHARGE_ATTENTE_MINUTES * 60);
+    
+    verifieEgalite("CHGDV01", echantillons(108, CHARGE_DECIMATION * CHARGE_FENETRE), 0);
+    verifieEgalite("CHGDV02", echantillons(110, CHARGE_DECIMATION * CHARGE_FENETRE * 2), 0);
+
+    // Chaque échantillon décimé à 109 fait baisser la moyenne de 32/256:
+    verifieEgalite("CHGDV03", echantillons(109, CHARGE_DECIMATION * 3), 0);
+    verifieEgalite("CHGDV04", echantillons(109, CHARGE_DECIMATION), 1);
+    verifieEgalite("CHGDV05", chargeSeconde(), 1);
+}
+
+static void ignore_la_baisse_de_tension_en_debut_de_charge() {
+    chargeInitialise();
+    echantillons(110, CHARGE_DECIMATION * CHARGE_FENETRE);
+    verifieEgalite("CHGAT01", echantillons(100, CHARGE_DECIMATION * CHARGE_FENETRE), 0);
+    secondesDeCharge(CHARGE_ATTENTE_MINUTES * 60);
+    verifieEgalite("CHGAT02", echantillons(104, CHARGE_DECIMATION * CHARGE_FENETRE), 0);
+}
+
+static void termine_la_charge_si_elle_dure_trop_longtemps() {
+    chargeInitialise();
+    echantillons(100, 1);
+    verifieEgalite("CHGMI01", secondesDeCharge(CHARGE_DUREE_MAXIMALE_MINUTES * 60 - 1), 0);
+    verifieEgalite("CHGMI02", chargeSeconde(), 1);
+
+    // Une nouvelle charge relance la minuterie:
+    chargeInterrompt();
+    echantillons(100, 1);
+    verifieEgalite("CHGMI03", chargeSeconde(), 0);
+}
+
+static void les_interruptions_ne_relancent_pas_la_minuterie() {
+    chargeInitialise();
+    echantillons(100, 1);
+    secondesDeCharge(CHARGE_DUREE_MAXIMALE_MINUTES * 30);
+
+    // La charge est interrompue, puis reprend:
+    chargeInterrompt();
+    verifieEgalite("CHGIN01", secondesDeCharge(600), 0);
+    echantillons(100, 1);
+    verifieEgalite("CHGIN02", secondesDeCharge(CHARGE_DUREE_MAXIMALE_MINUTES * 30 - 1), 0);
+    verifieEgalite("CHGIN03", chargeSeconde(), 1);
+}
+
+static void l_interruption_conserve_le_pic() {
+    chargeInitialise();
+    echantillons(105, 1);
+    secondesDeCharge(CHARGE_ATTENTE_MINUTES * 60);
+    echantillons(110, CHARGE_DECIMATION * CHARGE_FENETRE * 2);
+
+    // Après la reprise, la chute sous le pic termine la charge sans
+    // nouvelle attente:
+    chargeInterrompt();
+    echantillons(109, CHARGE_DECIMATION * 3);
+    verifieEgalite("CHGIN04", echantillons(109, CHARGE_DECIMATION), 1);
+}
+
+static void une_charge_abandonnee_recommence() {
+    chargeInitialise();
+    echantillons(100, 1);
+    secondesDeCharge(CHARGE_DUREE_MAXIMALE_MINUTES * 60 - 1);
+
+    // L'accumulateur s'est déchargé pendant l'interruption:
+    chargeAbandonne();
+    echantillons(100, 1);
+    verifieEgalite("CHGIN05", secondesDeCharge(CHARGE_DUREE_MAXIMALE_MINUTES * 60 - 1), 0);
+    verifieEgalite("CHGIN06", chargeSeconde(), 1);
+}
+
+#ifdef PROFIL_DELTA_T_DEGRES
+static void termine_la_charge_si_la_temperature_monte_trop_vite() {
+    chargeInitialise();
+    echantillons(100, 1);
+    chargeMesureTemperature(25);
+    verifieEgalite("CHGDT01", secondesDeCharge(CHARGE_DELTA_T_MINUTES * 60), 0);
+    chargeMesureTemperature(25 + PROFIL_DELTA_T_DEGRES - 1);
+    verifieEgalite("CHGDT02", secondesDeCharge(CHARGE_DELTA_T_MINUTES * 60), 0);
+    chargeMesureTemperature(25 + 2 * PROFIL_DELTA_T_DEGRES - 1);
+    verifieEgalite("CHGDT03", secondesDeCharge(CHARGE_DELTA_T_MINUTES * 60), 1);
+}
+#endif
+
+static void l_administration_d_energie_arrete_la_charge_au_pic() {
+    unsigned int n;
+    
+    initialiseEnergie();
+    mesureTemperature(25);
+    mesureAccumulateur((TENSION_FAIBLE * 255) / 100);
+    verifieEgalite("CHGEN01", energieActuelle()->chargerAccumulateur, 1);
+    mesureAccumulateur(110);
+    for (n = 0; n < CHARGE_ATTENTE_MINUTES * 60; n++) {
+        energieSeconde();
+    }
+    for (n = 0; n < CHARGE_DECIMATION * CHARGE_FENETRE * 2; n++) {
+        mesureAccumulateur(110);
+    }
+    verifieEgalite("CHGEN02", energieActuelle()->chargerAccumulateur, 1);
+    for (n = 0; n < CHARGE_DECIMATION * 4; n++) {
+        mesureAccumulateur(109);
+    }
+    verifieEgalite("CHGEN03", energieActuelle()->chargerAccumulateur, 0);
+    verifieEgalite("CHGEN04", energieActuelle()->accumulateurDisponible, 1);
+    
+    // La charge ne reprend pas tant que l'accumulateur n'est pas faible:
+    verifieEgalite("CHGEN05", mesureAccumulateur(100)->chargerAccumulateur, 0);
+    initialiseEnergie();
+}
+
+void testeCharge() {
+    termine_la_charge_quand_la_tension_baisse_apres_le_pic();
+    ignore_la_baisse_de_tension_en_debut_de_charge();
+    termine_la_charge_si_elle_dure_trop_longtemps();
+    les_interruptions_ne_relancent_pas_la_minuterie();
+    l_interruption_conserve_le_pic();
+    une_charge_abandonnee_recommence();
+#ifdef PROFIL_DELTA_T_DEGRES
+    termine_la_charge_si_la_temperature_monte_trop_vite();
+#endif
+    l_administration_d_energie_arrete_la_charge_au_pic();
+}
+
+#endif
+
+#endif
@@ -0,0 +1,106 @@
+#ifndef CHARGE_H
+#define	CHARGE_H
+
+#include "profil.h"
+
+/**
+ * Moteur de fin de charge des accumulateurs NiMH: la tension monte 
+ * pendant la charge, passe par un pic, puis redescend légèrement (-ΔV) 
+ * lorsque l'accumulateur est plein et que l'énergie se transforme 
+ * en chaleur.
+ * N'est compilé que si le profil le demande (PROFIL_CHARGE_DELTA_V).
+ */
+#ifdef PROFIL_CHARGE_DELTA_V
+
+/**
+ * Nombre d'échantillons de l'accumulateur additionnés dans un 
+ * échantillon décimé. À 400 échantillons par seconde, un échantillon
+ * décimé tous les 0.64s. La somme garde la résolution apportée par
+ * le bruit de conversion.
+ */
+#define CHARGE_DECIMATION 256
+
+/**
+ * Nombre d'échantillons décimés dans la fenêtre glissante dont la
+ * moyenne est comparée au pic.
+ */
+#define CHARGE_FENETRE 8
+
+/**
+ * Chute de tension sous le pic qui termine la charge, en 1/256 de pas
+ * de conversion.
+ */
+#define CHARGE_DELTA_V ((PROFIL_DELTA_V_MILLIVOLTS * 65280UL) / 10000)
+
+/**
+ * Pendant les premières minutes de charge, la tension d'un accumulateur
+ * très déchargé peut baisser: le -ΔV n'est pas surveillé.
+ */
+#define CHARGE_ATTENTE_MINUTES 5
+
+/**
+ * Durée maximale de la charge, en minutes: 150% de la durée nominale.
+ */
+#define CHARGE_DUREE_MAXIMALE_MINUTES ((PROFIL_CAPACITE_MAH * 90UL) / PROFIL_COURANT_CHARGE_MA)
+
+/**
+ * Énumère les raisons de la fin de la dernière charge.
+ */
+typedef enum {
+    /** Aucune charge terminée depuis le démarrage. */
+    CHARGE_AUCUNE = 0,
+    /** La charge est en cours. */
+    CHARGE_EN_COURS = 1,
+    /** La tension est passée par un pic, puis a baissé. */
+    CHARGE_FIN_DELTA_V = 2,
+    /** La charge a duré trop longtemps. */
+    CHARGE_FIN_MINUTERIE = 3,
+    /** La température a augmenté trop vite. */
+    CHARGE_FIN_DELTA_T = 4
+} ChargeFin;
+
+/**
+ * Réinitialise le moteur de charge.
+ */
+void chargeInitialise();
+
+/**
+ * Indique que l'accumulateur n'est pas en charge. Si la charge n'était
+ * pas terminée, la prochaine mesure en charge la reprend: la durée
+ * écoulée, le pic et l'attente du début de charge sont conservés, et la
+ * minuterie de 150% n'est pas relancée par les interruptions.
+ */
+void chargeInterrompt();
+
+/**
+ * Indique que l'accumulateur est déchargé, ou a été retiré. La prochaine
+ * mesure en charge commencera une nouvelle charge.
+ */
+void chargeAbandonne();
+
+/**
+ * Suit la tension de l'accumulateur pendant la charge.
+ * @param v Tension de l'accumulateur, numérisée sur 8 bits.
+ * @return 1 si la charge est terminée.
+ */
+unsigned char chargeMesureAccumulateur(unsigned char v);
+
+/**
+ * Suit la température de l'accumulateur pendant la charge.
+ * @param degres Température, en °C.
+ */
+void chargeMesureTemperature(signed char degres);
+
+/**
+ * Fait avancer la minuterie de charge d'une seconde.
+ * @return 1 si la charge est terminée.
+ */
+unsigned char chargeSeconde();
+
+#ifdef TEST
+void testeCharge();
+#endif
+
+#endif
+
+#endif
@@ -0,0 +1,369 @@
+#include "compteurs.h"
+#include "jauge.h"
+#include "eeprom.h"
+#include "i2c.h"
+#include "test.h"
+
+/** Position du numéro de séquence dans un emplacement. */
+#define POSITION_SEQUENCE (COMPTEURS_TAILLE_EMPLACEMENT - 2)
+
+/** Position du CRC dans un emplacement. */
+#define POSITION_CRC (COMPTEURS_TAILLE_EMPLACEMENT - 1)
+
+/** Les compteurs de 32 bits. */
+static unsigned long compteurs[COMPTEURS_NOMBRE];
+
+/** Nombre de défaillances de l'alimentation. */
+static unsigned int defaillances = 0;
+
+/** Nombre de cycles de charge équivalents. */
+static unsigned int cycles = 0;
+
+/** Charge fournie depuis le dernier cycle complet, en mAh. */
+static unsigned int mAhDepuisCycle = 0;
+
+/** Charge fournie qui n'atteint pas encore 1 mAh, en mA·s. */
+static unsigned int masFournis = 0;
+
+/** Secondes restantes avant l'enregistrement périodique. */
+static unsigned int secondesAvantEnregistrement = COMPTEURS_SECONDES_ENREGISTREMENT;
+
+/** Indique que les compteurs ont changé depuis le dernier enregistrement. */
+static unsigned char modifies = 0;
+
+/** Copie des compteurs, de leur séquence et de leur CRC, à écrire en EEPROM. */
+static unsigned char enregistrement[COMPTEURS_TAILLE_EMPLACEMENT];
+
+/** Position du prochain octet à écrire en EEPROM. */
+static volatile unsigned char aEcrire = COMPTEURS_TAILLE_EMPLACEMENT;
+
+/** Adresse de l'emplacement en cours d'écriture. */
+static unsigned char adresse = EEPROM_COMPTEURS_DEBUT;
+
+/** Numéro de séquence du dernier enregistrement. */
+static unsigned char sequence = 0;
+
+/**
+ * Calcule le CRC-8 (polynôme 0x07) d'un bloc.
+ * N'est utilisé qu'au démarrage et lors des enregistrements.
+ * @param donnees Le bloc.
+ * @param taille Sa taille.
+ * @return Le CRC.
+ */
+static unsigned char crc8(const unsigned char *donnees, unsigned char taille) {
+    unsigned char crc = 0xFF;
+    unsigned char n;
+
+    while (taille-- > 0) {
+        crc ^= *donnees++;
+        for (n = 0; n < 8; n++) {
+            if (crc & 0x80) {
+                crc = (crc << 1) ^ 0x07;
+            } else {
+                crc <<= 1;
+            }
+        }
+    }
+    return crc;
+}
+
+/**
+ * Expose les compteurs sur les registres I2C.
+ */
+static void expose() {
+    unsigned char n;
+    for (n = 0; n < COMPTEURS_NOMBRE; n++) {
+        i2cExposeRegistre16(REGISTRE_SECONDES_SECTEUR + 4 * n, (unsigned int) compteurs[n]);
+        i2cExposeRegistre16(REGISTRE_SECONDES_SECTEUR + 4 * n + 2, (unsigned int) (compteurs[n] >> 16));
+    }
+    i2cExposeRegistre16(REGISTRE_DEFAILLANCES, defaillances);
+    i2cExposeRegistre16(REGISTRE_CYCLES, cycles);
+}
+
+/**
+ * Lit un emplacement de l'EEPROM dans la copie.
+ * @param debut L'adresse de l'emplacement.
+ * @return 255 si son CRC est correct.
+ */
+static unsigned char litEmplacement(unsigned char debut) {
+    unsigned char n;
+
+    for (n = 0; n < COMPTEURS_TAILLE_EMPLACEMENT; n++) {
+        enregistrement[n] = eepromLit(debut + n);
+    }
+    if (crc8(enregistrement, POSITION_CRC) == enregistrement[POSITION_CRC]) {
+        return 255;
+    }
+    return 0;
+}
+
+void compteursInitialise() {
+    unsigned char premier, second;
+    unsigned char sequencePremier;
+    unsigned char n;
+
+    premier = litEmplacement(EEPROM_COMPTEURS_DEBUT);
+    sequencePremier = enregistrement[POSITION_SEQUENCE];
+    second = litEmplacement(EEPROM_COMPTEURS_DEBUT + COMPTEURS_TAILLE_EMPLACEMENT);
+
+    // Le second emplacement est le plus récent s'il est seul valide, ou
+    // si sa séquence suit celle du premier:
+    if (second && (!premier || ((signed char) (enregistrement[POSITION_SEQUENCE] - sequencePremier) > 0))) {
+        adresse = EEPROM_COMPTEURS_DEBUT;
+    } else if (premier) {
+        litEmplacement(EEPROM_COMPTEURS_DEBUT);
+        adresse = EEPROM_COMPTEURS_DEBUT + COMPTEURS_TAILLE_EMPLACEMENT;
+    } else {
+        for (n = 0; n < COMPTEURS_TAILLE_EMPLACEMENT; n++) {
+            enregistrement[n] = 0;
+        }
+        adresse = EEPROM_COMPTEURS_DEBUT;
+    }
+
+    for (n = 0; n < COMPTEURS_NOMBRE; n++) {
+        compteurs[n] = enregistrement[4 * n]
+                | ((unsigned long) enregistrement[4 * n + 1] << 8)
+                | ((unsigned long) enregistrement[4 * n + 2] << 16)
+                | ((unsigned long) enregistrement[4 * n + 3] << 24);
+    }
+    defaillances = enregistrement[4 * COMPTEURS_NOMBRE]
+            | ((unsigned int) enregistrement[4 * COMPTEURS_NOMBRE + 1] << 8);
+    sequence = enregistrement[POSITION_SEQUENCE];
+
+    // Les divisions ne sont faites qu'ici:
+    cycles = (unsigned int) (compteurs[COMPTEUR_MAH_FOURNIS] / JAUGE_CAPACITE_MAH);
+    mAhDepuisCycle = (unsigned int) (compteurs[COMPTEUR_MAH_FOURNIS] % JAUGE_CAPACITE_MAH);
+    masFournis = 0;
+
+    secondesAvantEnregistrement = COMPTEURS_SECONDES_ENREGISTREMENT;
+    modifies = 0;
+    aEcrire = COMPTEURS_TAILLE_EMPLACEMENT;
+    expose();
+}
+
+void compteursSeconde(Energie *energie) {
+    unsigned char nouvelles;
+
+    nouvelles = energieReleveDefaillances();
+    if (nouvelles) {
+        defaillances += nouvelles;
+        modifies = 255;
+    }
+    if (energieAlimentationPresente()) {
+        compteurs[COMPTEUR_SECONDES_SECTEUR]++;
+        modifies = 255;
+    }
+    if (energie->chargerAccumulateur) {
+        compteurs[COMPTEUR_SECONDES_CHARGE]++;
+    }
+    // Intègre le courant de décharge estimé par la jauge:
+    if (energie->solliciterAccumulateur) {
+        compteurs[COMPTEUR_SECONDES_ACCUMULATEUR]++;
+        modifies = 255;
+        masFournis += jaugeCourantDecharge();
+        while (masFournis >= 3600) {
+            masFournis -= 3600;
+            compteurs[COMPTEUR_MAH_FOURNIS]++;
+            if (++mAhDepuisCycle >= JAUGE_CAPACITE_MAH) {
+                mAhDepuisCycle = 0;
+                cycles++;
+            }
+        }
+    }
+
+    if (--secondesAvantEnregistrement == 0) {
+        secondesAvantEnregistrement = COMPTEURS_SECONDES_ENREGISTREMENT;
+        compteursEnregistre();
+    }
+    expose();
+}
+
+void compteursEnregistre() {
+    unsigned char n;
+
+    if (!modifies || (aEcrire < COMPTEURS_TAILLE_EMPLACEMENT)) {
+        return;
+    }
+    for (n = 0; n < COMPTEURS_NOMBRE; n++) {
+        enregistrement[4 * n] = (unsigned char) compteurs[n];
+        enregistrement[4 * n + 1] = (unsigned char) (compteurs[n] >> 8);
+        enregistrement[4 * n + 2] = (unsigned char) (compteurs[n] >> 16);
+        enregistrement[4 * n + 3] = (unsigned char) (compteurs[n] >> 24);
+    }
+    enregistrement[4 * COMPTEURS_NOMBRE] = (unsigned char) defaillances;
+    enregistrement[4 * COMPTEURS_NOMBRE + 1] = (unsigned char) (defaillances >> 8);
+    enregistrement[POSITION_SEQUENCE] = ++sequence;
+    enregistrement[POSITION_CRC] = crc8(enregistrement, POSITION_CRC);
+    modifies = 0;
+    aEcrire = 0;
+}
+
+void compteursEcrit() {
+    if (aEcrire < COMPTEURS_TAILLE_EMPLACEMENT) {
+        if (eepromEcrit(adresse + aEcrire, enregistrement[aEcrire])) {
+            if (++aEcrire >= COMPTEURS_TAILLE_EMPLACEMENT) {
+                // Le prochain enregistrement va dans l'autre emplacement:
+                if (adresse == EEPROM_COMPTEURS_DEBUT) {
+                    adresse = EEPROM_COMPTEURS_DEBUT + COMPTEURS_TAILLE_EMPLACEMENT;
+                } else {
+                    adresse = EEPROM_COMPTEURS_DEBUT;
+                }
+            }
+        }
+    }
+}
+
+unsigned char compteursEstEcrit() {
+    if ((aEcrire >= COMPTEURS_TAILLE_EMPLACEMENT) && !eepromOccupee()) {
+        return 255;
+    }
+    return 0;
+}
+
+unsigned long compteursLit(Compteur compteur) {
+    return compteurs[compteur];
+}
+
+unsigned int compteursDefaillances() {
+    return defaillances;
+}
+
+unsigned int compteursCycles() {
+    return cycles;
+}
+
+#ifdef TEST
+
+static void ecritTout() {
+    while (!compteursEstEcrit()) {
+        compteursEcrit();
+    }
+}
+
+static void effaceEmplacements() {
+    unsigned char n;
+    for (n = 0; n < 2 * COMPTEURS_TAILLE_EMPLACEMENT; n++) {
+        while (!eepromEcrit(EEPROM_COMPTEURS_DEBUT + n, 0xFF));
+    }
+    while (eepromOccupee());
+}
+
+static void initialise() {
+    effaceEmplacements();
+    initialiseEnergie();
+    jaugeInitialise();
+    compteursInitialise();
+}
+
+static void avance(Energie *energie, unsigned int secondes) {
+    while (secondes-- > 0) {
+        compteursSeconde(energie);
+    }
+}
+
+static void compte_les_secondes_et_les_defaillances() {
+    Energie energie = {0, 0, 0, 0};
+
+    initialise();
+    verifieEgalite("CPTSE01", (int) compteursLit(COMPTEUR_SECONDES_SECTEUR), 0);
+
+    energie.chargerAccumulateur = 1;
+    avance(&energie, 3);
+    verifieEgalite("CPTSE02", (int) compteursLit(COMPTEUR_SECONDES_SECTEUR), 3);
+    verifieEgalite("CPTSE03", (int) compteursLit(COMPTEUR_SECONDES_CHARGE), 3);
+    verifieEgalite("CPTSE04", (int) compteursLit(COMPTEUR_SECONDES_ACCUMULATEUR), 0);
+
+    mesureAlimentation(0);
+    energie.chargerAccumulateur = 0;
+    energie.solliciterAccumulateur = 1;
+    avance(&energie, 2);
+    verifieEgalite("CPTSE05", (int) compteursLit(COMPTEUR_SECONDES_SECTEUR), 3);
+    verifieEgalite("CPTSE06", (int) compteursLit(COMPTEUR_SECONDES_ACCUMULATEUR), 2);
+    verifieEgalite("CPTSE07", (int) compteursLit(COMPTEUR_MAH_FOURNIS), 1);
+    verifieEgalite("CPTSE08", compteursDefaillances(), 1);
+
+    // Une défaillance plus brève qu'une seconde est comptée aussi:
+    mesureAlimentation(255);
+    mesureAlimentation(0);
+    mesureAlimentation(255);
+    avance(&energie, 1);
+    verifieEgalite("CPTSE09", compteursDefaillances(), 2);
+}
+
+static void compte_les_cycles_de_charge() {
+    Energie energie = {1, 0, 1, 0};
+
+    initialise();
+    mesureAlimentation(0);
+    while (compteursLit(COMPTEUR_MAH_FOURNIS) < JAUGE_CAPACITE_MAH - 1) {
+        compteursSeconde(&energie);
+    }
+    verifieEgalite("CPTCY01", compteursCycles(), 0);
+    while (compteursLit(COMPTEUR_MAH_FOURNIS) < JAUGE_CAPACITE_MAH) {
+        compteursSeconde(&energie);
+    }
+    verifieEgalite("CPTCY02", compteursCycles(), 1);
+
+    // Le nombre de cycles est retrouvé à partir de la charge fournie:
+    ecritTout();
+    compteursEnregistre();
+    ecritTout();
+    compteursInitialise();
+    verifieEgalite("CPTCY03", compteursCycles(), 1);
+    verifieEgalite("CPTCY04", (int) compteursLit(COMPTEUR_MAH_FOURNIS), JAUGE_CAPACITE_MAH);
+}
+
+static void enregistre_une_fois_par_heure() {
+    Energie energie = {0, 0, 0, 0};
+
+    initialise();
+    avance(&energie, COMPTEURS_SECONDES_ENREGISTREMENT - 1);
+    verifieEgalite("CPTHR01", compteursEstEcrit(), 255);
+    avance(&energie, 1);
+    verifieEgalite("CPTHR02", compteursEstEcrit(), 0);
+    ecritTout();
+    compteursInitialise();
+    verifieEgalite("CPTHR03", compteursLit(COMPTEUR_SECONDES_SECTEUR) == COMPTEURS_SECONDES_ENREGISTREMENT, 1);
+}
+
+static void alterne_les_emplacements() {
+    Energie energie = {0, 0, 0, 0};
+
+    initialise();
+    avance(&energie, 5);
+    compteursEnregistre();
+    ecritTout();
+
+    // Sans modification, rien n'est enregistré:
+    compteursEnregistre();
+    verifieEgalite("CPTAL01", compteursEstEcrit(), 255);
+
+    avance(&energie, 2);
+    compteursEnregistre();
+    ecritTout();
+    compteursInitialise();
+    verifieEgalite("CPTAL02", (int) compteursLit(COMPTEUR_SECONDES_SECTEUR), 7);
+
+    // Un enregistrement interrompu laisse le précédent intact:
+    avance(&energie, 3);
+    compteursEnregistre();
+    compteursEcrit();
+    while (eepromOccupee());
+    compteursInitialise();
+    verifieEgalite("CPTAL03", (int) compteursLit(COMPTEUR_SECONDES_SECTEUR), 7);
+
+    // Si aucun emplacement n'est valide, les compteurs sont à zéro:
+    effaceEmplacements();
+    compteursInitialise();
+    verifieEgalite("CPTAL04", (int) compteursLit(COMPTEUR_SECONDES_SECTEUR), 0);
+}
+
+void testeCompteurs() {
+    compte_les_secondes_et_les_defaillances();
+    compte_les_cycles_de_charge();
+    enregistre_une_fois_par_heure();
+    alterne_les_emplacements();
+    initialise();
+}
+
+#endif
@@ -0,0 +1,96 @@
+#ifndef COMPTEURS_H
+#define	COMPTEURS_H
+
+#include "energie.h"
+
+/**
+ * Compteurs cumulés de l'usage de l'énergie, pour suivre l'usure de
+ * l'accumulateur et les statistiques de pannes d'alimentation sur toute
+ * la vie du circuit.
+ *
+ * Les compteurs avancent une fois par seconde, par des additions
+ * seulement. Ils sont enregistrés en EEPROM une fois par heure et avant
+ * d'isoler l'accumulateur, alternativement dans deux emplacements: une
+ * écriture interrompue par une coupure n'efface jamais les totaux.
+ * Chaque octet d'un emplacement est donc écrit une fois toutes les deux
+ * heures, soit plus de 20 ans avant d'atteindre l'endurance de l'EEPROM.
+ */
+
+/**
+ * Énumère les compteurs de 32 bits.
+ * Chacun est exposé à partir de REGISTRE_SECONDES_SECTEUR + 4 * compteur.
+ */
+typedef enum {
+    /** Secondes passées avec l'alimentation présente. */
+    COMPTEUR_SECONDES_SECTEUR = 0,
+    /** Secondes passées à alimenter le raspberry depuis l'accumulateur. */
+    COMPTEUR_SECONDES_ACCUMULATEUR = 1,
+    /** Secondes passées à charger l'accumulateur. */
+    COMPTEUR_SECONDES_CHARGE = 2,
+    /** Charge fournie par l'accumulateur, selon le courant de décharge estimé par la jauge, en mAh. */
+    COMPTEUR_MAH_FOURNIS = 3,
+    COMPTEURS_NOMBRE = 4
+} Compteur;
+
+/** Nombre de secondes entre deux enregistrements en EEPROM. */
+#define COMPTEURS_SECONDES_ENREGISTREMENT 3600
+
+/**
+ * Taille d'un emplacement en EEPROM: les compteurs de 32 bits, le
+ * nombre de défaillances, un numéro de séquence et le CRC.
+ */
+#define COMPTEURS_TAILLE_EMPLACEMENT (4 * COMPTEURS_NOMBRE + 2 + 2)
+
+/**
+ * Relit les compteurs du plus récent emplacement valide de l'EEPROM, ou
+ * les met à zéro si aucun n'est valide. Le nombre de cycles de charge en
+ * est déduit.
+ * Appeler après initialiseEnergie.
+ */
+void compteursInitialise();
+
+/**
+ * Fait avancer les compteurs d'une seconde.
+ * @param energie L'état actuel de l'administration d'énergie.
+ */
+void compteursSeconde(Energie *energie);
+
+/**
+ * Demande l'enregistrement des compteurs en EEPROM, si ils ont changé
+ * depuis le dernier enregistrement et si aucun n'est en cours.
+ */
+void compteursEnregistre();
+
+/**
+ * Poursuit l'enregistrement des compteurs en EEPROM, sans attendre.
+ * À appeler depuis la boucle principale.
+ */
+void compteursEcrit();
+
+/**
+ * @return 255 / -1 si aucun enregistrement n'est en cours.
+ */
+unsigned char compteursEstEcrit();
+
+/**
+ * @param compteur Voir Compteur.
+ * @return La valeur du compteur.
+ */
+unsigned long compteursLit(Compteur compteur);
+
+/**
+ * @return Le nombre de défaillances de l'alimentation.
+ */
+unsigned int compteursDefaillances();
+
+/**
+ * @return Le nombre de cycles de charge équivalents: la charge fournie,
+ * divisée par la capacité de l'accumulateur.
+ */
+unsigned int compteursCycles();
+
+#ifdef TEST
+void testeCompteurs();
+#endif
+
+#endif
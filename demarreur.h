@@ -0,0 +1,144 @@
+#ifndef DEMARREUR_H
+#define	DEMARREUR_H
+
+/**
+ * Démarreur: mise à jour du micrologiciel par I2C, depuis le raspberry
+ * (voir demarreur/demarreur.c, et raspberry/ups-flash.c).
+ *
+ * Répartition de la mémoire programme (32ko):
+ * - 0x0000 - 0x0FFF: le démarreur, protégé en écriture.
+ * - 0x1000 - 0x47FF: emplacement A, le micrologiciel exécuté.
+ * - 0x4800 - 0x7FFF: emplacement B, la nouvelle version reçue.
+ * La dernière rangée de chaque emplacement contient son descripteur,
+ * l'avant-dernière est une réserve pour l'échange.
+ * Le micrologiciel est compilé pour l'emplacement A (décalage 0x1000).
+ * Une nouvelle version est reçue dans l'emplacement B, vérifiée, puis
+ * échangée avec l'emplacement A: l'ancienne version est gardée dans
+ * l'emplacement B, décalée d'une rangée. Chaque étape de l'échange est
+ * notée dans l'EEPROM: un échange interrompu reprend au démarrage
+ * suivant. La nouvelle version est démarrée à l'essai, avec le chien de
+ * garde: si elle ne confirme pas son démarrage avant le redémarrage
+ * suivant, le démarreur rétablit l'ancienne version.
+ */
+
+/** Adresse du micrologiciel, et fin du démarreur. */
+#define DEMARREUR_APPLICATION 0x1000
+
+/** Taille d'une rangée de la mémoire programme, effacée et écrite d'un bloc. */
+#define DEMARREUR_TAILLE_RANGEE 64
+
+/** Taille de chaque emplacement. */
+#define DEMARREUR_TAILLE_EMPLACEMENT 0x3800
+
+#define DEMARREUR_EMPLACEMENT_A DEMARREUR_APPLICATION
+#define DEMARREUR_EMPLACEMENT_B (DEMARREUR_EMPLACEMENT_A + DEMARREUR_TAILLE_EMPLACEMENT)
+
+/** Position du descripteur dans chaque emplacement. */
+#define DEMARREUR_POSITION_DESCRIPTEUR (DEMARREUR_TAILLE_EMPLACEMENT - DEMARREUR_TAILLE_RANGEE)
+
+/** Position de la rangée de réserve, qui reçoit la première rangée échangée. */
+#define DEMARREUR_POSITION_RESERVE (DEMARREUR_POSITION_DESCRIPTEUR - DEMARREUR_TAILLE_RANGEE)
+
+/** Taille maximum du micrologiciel: jusqu'à la rangée de réserve. */
+#define DEMARREUR_TAILLE_IMAGE DEMARREUR_POSITION_RESERVE
+
+/** Valeur du descripteur d'un emplacement valide. */
+#define DEMARREUR_MAGIQUE 0x55AA
+
+/**
+ * Descripteur d'un emplacement, au début de sa dernière rangée.
+ * Les valeurs de 16 bits sont rangées octet le moins signifiant en premier.
+ */
+typedef struct {
+    /** DEMARREUR_MAGIQUE. */
+    unsigned int magique;
+    /** Taille du micrologiciel, en octets (un multiple de DEMARREUR_TAILLE_RANGEE). */
+    unsigned int longueur;
+    /** CRC du micrologiciel. */
+    unsigned int crc;
+    /** Version du micrologiciel, choisie par le raspberry. */
+    unsigned int version;
+} DemarreurDescripteur;
+
+/**
+ * Le CRC est le CRC-16/CCITT (polynôme 0x1021, valeur initiale 0xFFFF),
+ * calculé octet le plus signifiant en premier.
+ */
+#define DEMARREUR_CRC_INITIAL 0xFFFF
+#define DEMARREUR_CRC_POLYNOME 0x1021
+
+/**
+ * Valeur à écrire dans REGISTRE_MISE_A_JOUR pour redémarrer dans le
+ * démarreur. Elle est retenue dans l'EEPROM (EEPROM_DEMARREUR) jusqu'à
+ * la fin de la mise à jour.
+ */
+#define DEMARREUR_DEMANDE 0xB0
+
+/**
+ * Valeurs de EEPROM_DEMARREUR pendant la mise en place d'une nouvelle
+ * version: échange en cours, nouvelle version à démarrer à l'essai,
+ * puis démarrée à l'essai. Le micrologiciel confirme son démarrage en
+ * effaçant DEMARREUR_LANCE; si le démarreur la trouve encore, il
+ * rétablit l'ancienne version.
+ */
+#define DEMARREUR_ECHANGE 0xB2
+#define DEMARREUR_ESSAI 0xB3
+#define DEMARREUR_LANCE 0xB4
+
+/**
+ * Le micrologiciel démarré à l'essai confirme son démarrage après ce
+ * temps, avant que le chien de garde (4s) ne le redémarre.
+ */
+#define DEMARREUR_CONFIRMATION_SECONDES 2
+
+/**
+ * Sans commande pendant ce temps, le démarreur abandonne la mise à jour
+ * et démarre le micrologiciel, si il est valide.
+ */
+#define DEMARREUR_ATTENTE_SECONDES 60
+
+/**
+ * Énumère les commandes du démarreur, écrites à l'adresse REGISTRES.
+ * Chaque commande est une écriture: le numéro de commande, puis ses
+ * paramètres.
+ */
+typedef enum {
+    /**
+     * Écrit une rangée de l'emplacement B: position (16 bits),
+     * DEMARREUR_TAILLE_RANGEE octets, puis le CRC de la position et
+     * des octets (16 bits).
+     */
+    DEMARREUR_ECRIT = 1,
+    /**
+     * Vérifie l'emplacement B et l'échange avec l'emplacement A: longueur,
+     * CRC et version (16 bits chacun).
+     */
+    DEMARREUR_VALIDE = 2,
+    /** Démarre le micrologiciel de l'emplacement A. */
+    DEMARREUR_DEMARRE = 3
+} DemarreurCommande;
+
+/** Taille de la plus longue commande: DEMARREUR_ECRIT. */
+#define DEMARREUR_TAILLE_COMMANDE (1 + 2 + DEMARREUR_TAILLE_RANGEE + 2)
+
+/**
+ * Énumère les états rendus par une lecture de l'adresse REGISTRES.
+ * La lecture est retenue par le démarreur (étirement de l'horloge)
+ * tant que la commande précédente n'est pas terminée.
+ */
+typedef enum {
+    /** La commande précédente a réussi. */
+    DEMARREUR_PRET = 0,
+    /** Le CRC de la rangée ou de l'emplacement ne correspond pas. */
+    DEMARREUR_ERREUR_CRC = 1,
+    /** La position ou la longueur est hors de l'emplacement. */
+    DEMARREUR_ERREUR_POSITION = 2,
+    /** La relecture de la mémoire programme ne correspond pas. */
+    DEMARREUR_ERREUR_ECRITURE = 3,
+    /** Commande inconnue, ou de mauvaise longueur. */
+    DEMARREUR_ERREUR_COMMANDE = 4,
+    /** Le micrologiciel est vérifié et échangé avec l'emplacement A. */
+    DEMARREUR_VALIDE_ET_COPIE = 5
+} DemarreurEtat;
+
+#endif
@@ -0,0 +1,646 @@
+/**
+ * Démarreur: reçoit une nouvelle version du micrologiciel par I2C, et
+ * démarre le micrologiciel de l'emplacement A (voir demarreur.h).
+ *
+ * Le démarreur n'utilise pas d'interruptions: il surveille le MSSP1 en
+ * boucle, et s'arrête pendant les écritures de la mémoire programme. Le
+ * maître attend la fin de chaque commande en lisant l'état: l'esclave
+ * étire l'horloge jusqu'à ce que l'état soit prêt.
+ *
+ * Avec DEMARREUR_SIMULATION, la mémoire programme est un tableau, et ce
+ * fichier peut être inclus dans un programme pour PC (voir
+ * raspberry/ups-flash.c).
+ */
+#ifndef DEMARREUR_SIMULATION
+#include <xc.h>
+#endif
+#include "../demarreur.h"
+#include "../eeprom.h"
+#include "../i2c.h"
+
+#ifndef DEMARREUR_SIMULATION
+
+/**
+ * Bits de configuration. Ceux du micrologiciel sont ignorés lors des
+ * mises à jour: ceux-ci s'appliquent.
+ */
+#pragma config FOSC = INTIO67   // Osc. interne, A6 et A7 comme IO.
+#pragma config IESO = OFF       // Pas d'osc. au démarrage.
+#pragma config FCMEN = OFF      // Pas de monitorage de l'oscillateur.
+#pragma config MCLRE = EXTMCLR  // RE3 est actif comme master reset.
+#pragma config WDTEN = SWON     // Watchdog inactif, sauf pendant la veille.
+#pragma config WDTPS = 1024     // Période de la veille: 4s (voir horloge.h).
+#pragma config LVP = OFF        // Single Supply Enable bits off.
+#pragma config BBSIZ = ON       // Bloc de démarrage de 2kW (0x0000 - 0x0FFF).
+#pragma config WRTB = ON        // Bloc de démarrage protégé en écriture.
+
+/**
+ * Les interruptions sont celles du micrologiciel, compilé avec un
+ * décalage de DEMARREUR_APPLICATION.
+ */
+#asm
+    PSECT intcode
+    GOTO 0x1008
+    PSECT intcodelo
+    GOTO 0x1018
+#endasm
+
+#else
+
+/** Mémoire programme simulée. */
+unsigned char flash[0x8000];
+
+/** Différent de 0 lorsque le micrologiciel a été démarré. */
+unsigned char demarre;
+
+/**
+ * Si positif, nombre de rangées écrites avant une coupure simulée: les
+ * rangées suivantes sont effacées, mais pas écrites.
+ */
+int rangeesAvantCoupure = -1;
+
+#endif
+
+/** Résultats de l'automate esclave I2C. */
+#define DEMARREUR_I2C_EMET 1
+#define DEMARREUR_I2C_EXECUTE 2
+
+/** Commande en cours de réception. */
+static unsigned char commande[DEMARREUR_TAILLE_COMMANDE];
+
+/** État de la dernière commande, voir DemarreurEtat. */
+static unsigned char etat = DEMARREUR_PRET;
+
+/** Tampon d'une rangée de la mémoire programme. */
+static unsigned char rangee[DEMARREUR_TAILLE_RANGEE];
+
+/**
+ * Ajoute un octet au CRC.
+ * @param crc Le CRC des octets précédents.
+ * @param octet L'octet.
+ * @return Le CRC.
+ */
+static unsigned int crc16(unsigned int crc, unsigned char octet) {
+    unsigned char n;
+
+    crc ^= (unsigned int) octet << 8;
+    for (n = 0; n < 8; n++) {
+        if (crc & 0x8000) {
+            crc = (crc << 1) ^ DEMARREUR_CRC_POLYNOME;
+        } else {
+            crc <<= 1;
+        }
+    }
+    // Sans effet sur le PIC, où les entiers ont 16 bits:
+    return crc & 0xFFFF;
+}
+
+/**
+ * Lit une rangée de la mémoire programme dans le tampon.
+ * @param adresse L'adresse de la rangée.
+ */
+static void litRangee(unsigned int adresse) {
+    unsigned char n;
+
+#ifndef DEMARREUR_SIMULATION
+    TBLPTRU = 0;
+    TBLPTRH = adresse >> 8;
+    TBLPTRL = (unsigned char) adresse;
+    for (n = 0; n < DEMARREUR_TAILLE_RANGEE; n++) {
+        asm("TBLRD*+");
+        rangee[n] = TABLAT;
+    }
+#else
+    for (n = 0; n < DEMARREUR_TAILLE_RANGEE; n++) {
+        rangee[n] = flash[adresse + n];
+    }
+#endif
+}
+
+#ifndef DEMARREUR_SIMULATION
+/**
+ * Séquence de déverrouillage des écritures de la mémoire programme.
+ * Le processeur s'arrête pendant l'effacement ou l'écriture.
+ */
+static void deverrouille() {
+    EECON1bits.WREN = 1;
+    EECON2 = 0x55;
+    EECON2 = 0xAA;
+    EECON1bits.WR = 1;
+    EECON1bits.WREN = 0;
+}
+#endif
+
+/**
+ * Efface une rangée de la mémoire programme et y écrit le tampon,
+ * puis relit la rangée.
+ * @param adresse L'adresse de la rangée.
+ * @return 255 si la rangée relue correspond au tampon.
+ */
+static unsigned char ecritRangee(unsigned int adresse) {
+    unsigned char n;
+
+#ifndef DEMARREUR_SIMULATION
+    TBLPTRU = 0;
+    TBLPTRH = adresse >> 8;
+    TBLPTRL = (unsigned char) adresse;
+    EECON1bits.EEPGD = 1;
+    EECON1bits.CFGS = 0;
+    EECON1bits.FREE = 1;
+    deverrouille();
+    EECON1bits.FREE = 0;
+
+    // Remplit les registres d'écriture, puis revient dans la rangée:
+    for (n = 0; n < DEMARREUR_TAILLE_RANGEE; n++) {
+        TABLAT = rangee[n];
+        asm("TBLWT*+");
+    }
+    asm("TBLRD*-");
+    deverrouille();
+
+    TBLPTRH = adresse >> 8;
+    TBLPTRL = (unsigned char) adresse;
+    for (n = 0; n < DEMARREUR_TAILLE_RANGEE; n++) {
+        asm("TBLRD*+");
+        if (TABLAT != rangee[n]) {
+            return 0;
+        }
+    }
+#else
+    if (rangeesAvantCoupure == 0) {
+        for (n = 0; n < DEMARREUR_TAILLE_RANGEE; n++) {
+            flash[adresse + n] = 0xFF;
+        }
+        return 0;
+    }
+    if (rangeesAvantCoupure > 0) {
+        rangeesAvantCoupure--;
+    }
+    for (n = 0; n < DEMARREUR_TAILLE_RANGEE; n++) {
+        flash[adresse + n] = rangee[n];
+    }
+#endif
+    return 255;
+}
+
+/**
+ * Lit le descripteur d'un emplacement.
+ * @param emplacement DEMARREUR_EMPLACEMENT_A ou DEMARREUR_EMPLACEMENT_B.
+ * @param descripteur Le descripteur.
+ */
+static void litDescripteur(unsigned int emplacement, DemarreurDescripteur *descripteur) {
+    litRangee(emplacement + DEMARREUR_POSITION_DESCRIPTEUR);
+    descripteur->magique = rangee[0] | ((unsigned int) rangee[1] << 8);
+    descripteur->longueur = rangee[2] | ((unsigned int) rangee[3] << 8);
+    descripteur->crc = rangee[4] | ((unsigned int) rangee[5] << 8);
+    descripteur->version = rangee[6] | ((unsigned int) rangee[7] << 8);
+}
+
+/**
+ * Calcule le CRC du début d'un emplacement.
+ * @param emplacement DEMARREUR_EMPLACEMENT_A ou DEMARREUR_EMPLACEMENT_B.
+ * @param longueur Nombre d'octets, multiple de DEMARREUR_TAILLE_RANGEE.
+ * @return Le CRC.
+ */
+static unsigned int crcEmplacement(unsigned int emplacement, unsigned int longueur) {
+    unsigned int crc = DEMARREUR_CRC_INITIAL;
+    unsigned int position;
+    unsigned char n;
+
+    for (position = 0; position < longueur; position += DEMARREUR_TAILLE_RANGEE) {
+        litRangee(emplacement + position);
+        for (n = 0; n < DEMARREUR_TAILLE_RANGEE; n++) {
+            crc = crc16(crc, rangee[n]);
+        }
+    }
+    return crc;
+}
+
+/**
+ * @param emplacement DEMARREUR_EMPLACEMENT_A ou DEMARREUR_EMPLACEMENT_B.
+ * @return 255 si l'emplacement contient un micrologiciel complet.
+ */
+static unsigned char emplacementValide(unsigned int emplacement) {
+    DemarreurDescripteur descripteur;
+
+    litDescripteur(emplacement, &descripteur);
+    if ((descripteur.magique != DEMARREUR_MAGIQUE)
+            || (descripteur.longueur == 0)
+            || (descripteur.longueur > DEMARREUR_TAILLE_IMAGE)
+            || (descripteur.longueur % DEMARREUR_TAILLE_RANGEE)) {
+        return 0;
+    }
+    if (crcEmplacement(emplacement, descripteur.longueur) != descripteur.crc) {
+        return 0;
+    }
+    return 255;
+}
+
+/**
+ * Écrit un octet de l'EEPROM et attend la fin de l'écriture.
+ * @param adresse L'adresse.
+ * @param valeur La valeur.
+ */
+static void ecritEeprom(unsigned char adresse, unsigned char valeur) {
+    eepromEcrit(adresse, valeur);
+    while (eepromOccupee());
+}
+
+/** Nombre d'étapes de l'échange: les rangées du micrologiciel, puis le descripteur. */
+#define ETAPES_ECHANGE (DEMARREUR_TAILLE_IMAGE / DEMARREUR_TAILLE_RANGEE + 1)
+
+/**
+ * @param etape Une étape de l'échange.
+ * @return La position de la rangée échangée à cette étape.
+ */
+static unsigned int positionEtape(unsigned char etape) {
+    if (etape < ETAPES_ECHANGE - 1) {
+        return (unsigned int) etape * DEMARREUR_TAILLE_RANGEE;
+    }
+    return DEMARREUR_POSITION_DESCRIPTEUR;
+}
+
+/**
+ * La rangée de A échangée à une étape est gardée dans la rangée de B
+ * échangée à l'étape précédente, déjà copiée dans A. Celle de la
+ * première étape est gardée dans la rangée de réserve.
+ * @param etape Une étape de l'échange.
+ * @return L'adresse où l'ancienne rangée de A est gardée.
+ */
+static unsigned int sauvegardeEtape(unsigned char etape) {
+    if (etape == 0) {
+        return DEMARREUR_EMPLACEMENT_B + DEMARREUR_POSITION_RESERVE;
+    }
+    return DEMARREUR_EMPLACEMENT_B + positionEtape(etape - 1);
+}
+
+/**
+ * Échange les emplacements A et B, ou reprend un échange interrompu.
+ * Chaque étape garde la rangée de A, puis y copie la rangée de B. Le
+ * nombre de rangées gardées et copiées est noté dans l'EEPROM après
+ * chaque écriture: une étape interrompue est refaite à partir de la
+ * dernière écriture notée, dont la source est intacte.
+ * @return 255 si l'échange est terminé.
+ */
+static unsigned char echangeEmplacements() {
+    unsigned char sauvees, copiees;
+
+    sauvees = eepromLit(EEPROM_DEMARREUR_SAUVEES);
+    copiees = eepromLit(EEPROM_DEMARREUR_COPIEES);
+    if ((sauvees != copiees) && (sauvees != copiees + 1)) {
+        return 0;
+    }
+    while (copiees < ETAPES_ECHANGE) {
+        if (sauvees == copiees) {
+            litRangee(DEMARREUR_EMPLACEMENT_A + positionEtape(copiees));
+            if (!ecritRangee(sauvegardeEtape(copiees))) {
+                return 0;
+            }
+            ecritEeprom(EEPROM_DEMARREUR_SAUVEES, ++sauvees);
+        }
+        litRangee(DEMARREUR_EMPLACEMENT_B + positionEtape(copiees));
+        if (!ecritRangee(DEMARREUR_EMPLACEMENT_A + positionEtape(copiees))) {
+            return 0;
+        }
+        ecritEeprom(EEPROM_DEMARREUR_COPIEES, ++copiees);
+    }
+    return 255;
+}
+
+/**
+ * Termine l'échange des emplacements: la nouvelle version, vérifiée, est
+ * à démarrer à l'essai.
+ * @return Voir DemarreurEtat.
+ */
+static unsigned char termineEchange() {
+    if (!echangeEmplacements() || !emplacementValide(DEMARREUR_EMPLACEMENT_A)) {
+        return DEMARREUR_ERREUR_ECRITURE;
+    }
+    ecritEeprom(EEPROM_DEMARREUR, DEMARREUR_ESSAI);
+    return DEMARREUR_VALIDE_ET_COPIE;
+}
+
+/**
+ * Rétablit l'ancienne version gardée dans l'emplacement B par l'échange.
+ * L'emplacement B n'est pas modifié: une copie interrompue est refaite.
+ * Le descripteur est copié en dernier.
+ * @return 255 si la copie a réussi.
+ */
+static unsigned char retablitEmplacement() {
+    unsigned char etape;
+
+    for (etape = 0; etape < ETAPES_ECHANGE; etape++) {
+        litRangee(sauvegardeEtape(etape));
+        if (!ecritRangee(DEMARREUR_EMPLACEMENT_A + positionEtape(etape))) {
+            return 0;
+        }
+    }
+    return 255;
+}
+
+/**
+ * Démarre le micrologiciel de l'emplacement A.
+ * Le micrologiciel suppose les registres dans leur état de mise sous
+ * tension: si le MSSP1 a été configuré (SEN étire l'horloge, ce que le
+ * micrologiciel ne gère pas), le démarreur redémarre le micro-contrôleur
+ * plutôt que de sauter. La demande de mise à jour est effacée avant,
+ * pour que le démarreur démarre alors directement l'emplacement A.
+ * Une nouvelle version est démarrée à l'essai, avec le chien de garde.
+ */
+static void demarreApplication() {
+    unsigned char demande = eepromLit(EEPROM_DEMARREUR);
+
+#ifndef DEMARREUR_SIMULATION
+    if (SSP1CON1bits.SSPEN) {
+        if (demande == DEMARREUR_DEMANDE) {
+            ecritEeprom(EEPROM_DEMARREUR, 0xFF);
+        }
+        RESET();
+    }
+#endif
+    if (demande == DEMARREUR_ESSAI) {
+        ecritEeprom(EEPROM_DEMARREUR, DEMARREUR_LANCE);
+#ifndef DEMARREUR_SIMULATION
+        WDTCONbits.SWDTEN = 1;
+#endif
+    }
+#ifndef DEMARREUR_SIMULATION
+    asm("GOTO 0x1000");
+#else
+    demarre = 255;
+#endif
+}
+
+/**
+ * Démarre le micrologiciel de l'emplacement A si il est valide.
+ * @return 0 si aucun micrologiciel valide ne peut être démarré.
+ */
+static unsigned char demarreSiPossible() {
+    if (!emplacementValide(DEMARREUR_EMPLACEMENT_A)) {
+        return 0;
+    }
+    demarreApplication();
+    return 255;
+}
+
+/**
+ * Au lancement du démarreur: termine un échange interrompu, ou rétablit
+ * l'ancienne version si la nouvelle n'a pas confirmé son démarrage, puis
+ * démarre le micrologiciel, sauf si une mise à jour est demandée.
+ */
+static void lancement() {
+    switch (eepromLit(EEPROM_DEMARREUR)) {
+        case DEMARREUR_DEMANDE:
+            break;
+        case DEMARREUR_ECHANGE:
+            if (termineEchange() == DEMARREUR_VALIDE_ET_COPIE) {
+                demarreSiPossible();
+            }
+            break;
+        case DEMARREUR_LANCE:
+            if (retablitEmplacement()) {
+                ecritEeprom(EEPROM_DEMARREUR, 0xFF);
+                demarreSiPossible();
+            }
+            break;
+        default:
+            demarreSiPossible();
+            break;
+    }
+}
+
+/**
+ * Écrit une rangée de l'emplacement B.
+ * @return Voir DemarreurEtat.
+ */
+static unsigned char commandeEcrit() {
+    unsigned int position, crc;
+    unsigned char n;
+
+    crc = DEMARREUR_CRC_INITIAL;
+    for (n = 1; n < 1 + 2 + DEMARREUR_TAILLE_RANGEE; n++) {
+        crc = crc16(crc, commande[n]);
+    }
+    if (crc != (commande[n] | ((unsigned int) commande[n + 1] << 8))) {
+        return DEMARREUR_ERREUR_CRC;
+    }
+    position = commande[1] | ((unsigned int) commande[2] << 8);
+    if ((position >= DEMARREUR_TAILLE_IMAGE) || (position % DEMARREUR_TAILLE_RANGEE)) {
+        return DEMARREUR_ERREUR_POSITION;
+    }
+    for (n = 0; n < DEMARREUR_TAILLE_RANGEE; n++) {
+        rangee[n] = commande[3 + n];
+    }
+    if (!ecritRangee(DEMARREUR_EMPLACEMENT_B + position)) {
+        return DEMARREUR_ERREUR_ECRITURE;
+    }
+    return DEMARREUR_PRET;
+}
+
+/**
+ * Vérifie l'emplacement B, écrit son descripteur, et l'échange avec
+ * l'emplacement A.
+ * @return Voir DemarreurEtat.
+ */
+static unsigned char commandeValide() {
+    unsigned int longueur, crc;
+    unsigned char n;
+
+    longueur = commande[1] | ((unsigned int) commande[2] << 8);
+    crc = commande[3] | ((unsigned int) commande[4] << 8);
+    if ((longueur == 0) || (longueur > DEMARREUR_TAILLE_IMAGE) || (longueur % DEMARREUR_TAILLE_RANGEE)) {
+        return DEMARREUR_ERREUR_POSITION;
+    }
+    if (crcEmplacement(DEMARREUR_EMPLACEMENT_B, longueur) != crc) {
+        return DEMARREUR_ERREUR_CRC;
+    }
+
+    for (n = 0; n < DEMARREUR_TAILLE_RANGEE; n++) {
+        rangee[n] = 0xFF;
+    }
+    rangee[0] = (unsigned char) DEMARREUR_MAGIQUE;
+    rangee[1] = DEMARREUR_MAGIQUE >> 8;
+    for (n = 1; n < 7; n++) {
+        rangee[n + 1] = commande[n];
+    }
+    if (!ecritRangee(DEMARREUR_EMPLACEMENT_B + DEMARREUR_POSITION_DESCRIPTEUR)) {
+        return DEMARREUR_ERREUR_ECRITURE;
+    }
+
+    // Désormais, l'échange reprend au démarrage suivant:
+    ecritEeprom(EEPROM_DEMARREUR_SAUVEES, 0);
+    ecritEeprom(EEPROM_DEMARREUR_COPIEES, 0);
+    ecritEeprom(EEPROM_DEMARREUR, DEMARREUR_ECHANGE);
+    return termineEchange();
+}
+
+/**
+ * Exécute la commande reçue.
+ * @param longueur Le nombre d'octets reçus.
+ */
+static void executeCommande(unsigned char longueur) {
+    switch (commande[0]) {
+        case DEMARREUR_ECRIT:
+            etat = longueur == DEMARREUR_TAILLE_COMMANDE ? commandeEcrit() : DEMARREUR_ERREUR_COMMANDE;
+            break;
+        case DEMARREUR_VALIDE:
+            etat = longueur == 7 ? commandeValide() : DEMARREUR_ERREUR_COMMANDE;
+            break;
+        case DEMARREUR_DEMARRE:
+            if (!demarreSiPossible()) {
+                etat = DEMARREUR_ERREUR_CRC;
+            }
+            break;
+        default:
+            etat = DEMARREUR_ERREUR_COMMANDE;
+            break;
+    }
+}
+
+/** Bits de SSP1STAT utilisés par l'automate esclave. */
+#define STATUT_BF 0x01
+#define STATUT_RW 0x04
+#define STATUT_P 0x10
+#define STATUT_DA 0x20
+
+/** Nombre d'octets de la commande en cours de réception. */
+static unsigned char longueur = 0;
+
+/** Vaut 255 si la transaction en cours est une lecture. */
+static unsigned char enLecture = 0;
+
+/**
+ * Automate esclave I2C du démarreur. Seule l'adresse REGISTRES est
+ * utilisée: les écritures sont des commandes, les lectures rendent l'état.
+ * Un octet n'est ajouté à la commande que si il a été reçu (BF) pendant
+ * une écriture: le NACK qui termine la lecture de l'état interrompt aussi,
+ * avec R/W à 0, alors que SSP1BUF contient encore l'état émis.
+ * @param statut La valeur de SSP1STAT.
+ * @param octet La valeur de SSP1BUF, si BF.
+ * @param horlogeRetenue 255 / -1 si le maître attend un octet.
+ * @param emission Reçoit l'octet à émettre.
+ * @return DEMARREUR_I2C_EMET si l'octet est à émettre,
+ * DEMARREUR_I2C_EXECUTE si une commande a été exécutée, sinon 0.
+ */
+static unsigned char i2cAutomate(unsigned char statut, unsigned char octet,
+        unsigned char horlogeRetenue, unsigned char *emission) {
+    if (statut & STATUT_P) {
+        enLecture = 0;
+        if (longueur) {
+            executeCommande(longueur);
+            longueur = 0;
+            return DEMARREUR_I2C_EXECUTE;
+        }
+        return 0;
+    }
+    if (!(statut & STATUT_DA)) {
+        // Adresse: seule la correspondance d'adresse allume BF.
+        if (!(statut & STATUT_BF)) {
+            return 0;
+        }
+        longueur = 0;
+        if (statut & STATUT_RW) {
+            enLecture = 255;
+            *emission = etat;
+            return DEMARREUR_I2C_EMET;
+        }
+        enLecture = 0;
+        return 0;
+    }
+    if (enLecture) {
+        // Le maître a acquitté l'octet précédent, et en attend un autre:
+        if ((statut & STATUT_RW) && horlogeRetenue) {
+            *emission = 0xFF;
+            return DEMARREUR_I2C_EMET;
+        }
+        return 0;
+    }
+    if (statut & STATUT_BF) {
+        if (longueur < DEMARREUR_TAILLE_COMMANDE) {
+            commande[longueur++] = octet;
+        } else {
+            longueur = DEMARREUR_TAILLE_COMMANDE + 1;
+        }
+    }
+    return 0;
+}
+
+#ifndef DEMARREUR_SIMULATION
+
+/**
+ * Initialise le MSSP1 en esclave I2C, aux mêmes adresses que le
+ * micrologiciel, sans interruptions.
+ */
+static void i2cInitialise() {
+    ANSELC = 0;
+    TRISCbits.RC3 = 1;
+    TRISCbits.RC4 = 1;
+    SSP1ADD = LECTURE_ALIMENTATION;
+    SSP1MSK = I2C_MASQUE_ADRESSES_ESCLAVES;
+    SSP1CON1bits.SSPM = 0b1110;         // Esclave 7 bits, interruptions START et STOP.
+    SSP1CON2bits.SEN = 1;               // Étire l'horloge après chaque octet reçu.
+    SSP1CON3bits.PCIE = 1;
+    SSP1CON3bits.BOEN = 1;
+    SSP1CON1bits.SSPEN = 1;
+}
+
+/**
+ * Traite une interruption du MSSP1, si il y en a une.
+ * @return 255 si une commande a été exécutée.
+ */
+static unsigned char i2cDemarreur() {
+    unsigned char statut, octet = 0, emission, resultat;
+
+    if (!PIR1bits.SSP1IF) {
+        return 0;
+    }
+    PIR1bits.SSP1IF = 0;
+
+    statut = SSP1STAT;
+    if (statut & STATUT_BF) {
+        octet = SSP1BUF;
+    }
+    resultat = i2cAutomate(statut, octet, SSP1CON1bits.CKP ? 0 : 255, &emission);
+    if (resultat == DEMARREUR_I2C_EMET) {
+        SSP1BUF = emission;
+    }
+    if (SSP1CON1bits.SSPOV) {
+        SSP1CON1bits.SSPOV = 0;
+    }
+    // SEN retient aussi l'horloge après chaque octet reçu:
+    SSP1CON1bits.CKP = 1;
+    return resultat == DEMARREUR_I2C_EXECUTE;
+}
+
+void main(void) {
+    unsigned char debordements = 0;
+
+    // Maintient l'alimentation, comme le micrologiciel:
+    TRISAbits.RA5 = 0;
+    PORTAbits.RA5 = 1;
+
+    // Horloge à 16MHz, pour vérifier les emplacements rapidement:
+    OSCCONbits.IRCF = 7;
+
+    lancement();
+
+    // Mise à jour demandée, ou aucun micrologiciel valide.
+    // Temporisateur 0 sur 16 bits, Fosc/4 / 256: un débordement toutes
+    // les 4.2s.
+    T0CON = 0b10000111;
+    i2cInitialise();
+    while (1) {
+        if (i2cDemarreur()) {
+            debordements = 0;
+        }
+        if (INTCONbits.TMR0IF) {
+            INTCONbits.TMR0IF = 0;
+            if (++debordements >= DEMARREUR_ATTENTE_SECONDES * 10 / 42) {
+                debordements = 0;
+                demarreSiPossible();
+            }
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,41 @@
+#include <xc.h>
+#include "eeprom.h"
+
+unsigned char eepromOccupee() {
+    if (EECON1bits.WR) {
+        return 255;
+    }
+    return 0;
+}
+
+unsigned char eepromLit(unsigned char adresse) {
+    EEADR = adresse;
+    EECON1bits.EEPGD = 0;   // Mémoire EEPROM de données...
+    EECON1bits.CFGS = 0;    // ... et pas de configuration.
+    EECON1bits.RD = 1;
+    return EEDATA;
+}
+
+unsigned char eepromEcrit(unsigned char adresse, unsigned char valeur) {
+    unsigned char gie;
+
+    if (EECON1bits.WR) {
+        return 0;
+    }
+    EEADR = adresse;
+    EEDATA = valeur;
+    EECON1bits.EEPGD = 0;
+    EECON1bits.CFGS = 0;
+    EECON1bits.WREN = 1;
+
+    // Séquence de déverrouillage, sans interruptions:
+    gie = INTCONbits.GIE;
+    INTCONbits.GIE = 0;
+    EECON2 = 0x55;
+    EECON2 = 0xAA;
+    EECON1bits.WR = 1;
+    INTCONbits.GIE = gie;
+
+    EECON1bits.WREN = 0;
+    return 255;
+}
@@ -0,0 +1,42 @@
+#ifndef EEPROM_H
+#define	EEPROM_H
+
+/**
+ * Répartition de la mémoire EEPROM de données (256 octets).
+ */
+#define EEPROM_JOURNAL_DEBUT 0x00
+#define EEPROM_JOURNAL_TAILLE 192
+#define EEPROM_CALIBRATION_DEBUT 0xC0
+/** Demande de mise à jour, lue par le démarreur (voir demarreur.h). */
+#define EEPROM_DEMARREUR 0xCF
+/** Deux emplacements des compteurs cumulés (voir compteurs.h). */
+#define EEPROM_COMPTEURS_DEBUT 0xD0
+/** Progression de l'échange des emplacements (voir demarreur.h). */
+#define EEPROM_DEMARREUR_SAUVEES 0xF8
+#define EEPROM_DEMARREUR_COPIEES 0xF9
+
+/**
+ * Lit un octet de l'EEPROM de données.
+ * Ne pas appeler pendant une écriture.
+ * @param adresse L'adresse.
+ * @return La valeur.
+ */
+unsigned char eepromLit(unsigned char adresse);
+
+/**
+ * Lance l'écriture d'un octet de l'EEPROM de données, sans attendre
+ * qu'elle se termine. Les interruptions ne sont désactivées que pendant
+ * la séquence de déverrouillage.
+ * @param adresse L'adresse.
+ * @param valeur La valeur.
+ * @return 0 si une écriture est déjà en cours et que l'octet n'a pas 
+ * été écrit.
+ */
+unsigned char eepromEcrit(unsigned char adresse, unsigned char valeur);
+
+/**
+ * @return 255 / -1 si une écriture est en cours.
+ */
+unsigned char eepromOccupee();
+
+#endif
@@ -1,4 +1,11 @@
 #include "energie.h"
+#include "i2c.h"
+#include "journal.h"
+#include "calibration.h"
+#include "temperature.h"
+#include "profil.h"
+#include "charge.h"
+#include "capture.h"
 #include "test.h"
 
 /** 
@@ -47,12 +54,31 @@ typedef enum {
      * Le raspberry est probablement allumé, et a besoin de courant.
      */
     PROBABLEMENT_ACTIF,
+    /**
+     * Le raspberry a annoncé qu'il s'arrête, et a besoin de courant
+     * jusqu'à la fin du compte à rebours.
+     */
+    ARRET_ANNONCE,
     /**
      * Le raspberry ne consomme actuellement pas de courant.
      */
     INACTIF
 } EtatRaspberry;
 
+/**
+ * Énumère les états de la température de l'accumulateur.
+ */
+typedef enum {
+    /**
+     * La température permet de charger l'accumulateur.
+     */
+    TEMPERATURE_ADMISE,
+    /**
+     * L'accumulateur est trop chaud ou trop froid pour être chargé.
+     */
+    TEMPERATURE_HORS_LIMITES
+} EtatTemperature;
+
 /** État actuel de l'accumulateur. */
 static EtatAccumulateur etatAccumulateur = UTILISABLE;
 
@@ -62,75 +88,205 @@ static EtatAlimentation etatAlimentation = PRESENTE;
 /** État actuel du raspberry. */
 static EtatRaspberry etatRaspberry = PROBABLEMENT_ACTIF;
 
+/** Secondes restantes avant l'arrêt annoncé par le raspberry. */
+static unsigned char secondesAvantArret = 0;
+
+/** Politique à appliquer si l'alimentation revient pendant un arrêt annoncé. */
+static PolitiqueRetour politiqueRetour = RETOUR_ANNULE_ARRET;
+
+/** État actuel de la température de l'accumulateur. */
+static EtatTemperature etatTemperature = TEMPERATURE_ADMISE;
+
+/** Indique que l'état a changé depuis le dernier appel à energieModifiee. */
+static unsigned char modifiee = 1;
+
+/** Nombre de transitions de chaque catégorie. */
+static unsigned int transitions[ENERGIE_NOMBRE_TRANSITIONS];
+
+/** Nombre de défaillances de l'alimentation depuis le dernier relevé. */
+static unsigned char defaillances = 0;
+
 /**
  * Initialise les états internes.
  */
 void initialiseEnergie() {
+    unsigned char n;
+
     etatAccumulateur = UTILISABLE;
     etatAlimentation = PRESENTE;
     etatRaspberry = PROBABLEMENT_ACTIF;
+    secondesAvantArret = 0;
+    politiqueRetour = RETOUR_ANNULE_ARRET;
+    etatTemperature = TEMPERATURE_ADMISE;
+    modifiee = 1;
+    defaillances = 0;
+    for (n = 0; n < ENERGIE_NOMBRE_TRANSITIONS; n++) {
+        transitions[n] = 0;
+    }
+#ifdef PROFIL_CHARGE_DELTA_V
+    chargeInitialise();
+#endif
 }
 
 Energie energie;
 
+#define NOMBRE_ETATS_ACCUMULATEUR 4
+#define NOMBRE_ETATS_ALIMENTATION 2
+#define NOMBRE_ETATS_RASPBERRY 3
+#define NOMBRE_ETATS_TEMPERATURE 2
+
+/**
+ * Position d'une combinaison d'états dans la table de l'administration
+ * d'énergie.
+ */
+#define INDEX_ENERGIE(accumulateur, alimentation, raspberry, temperature) \
+    ((((accumulateur) * NOMBRE_ETATS_ALIMENTATION + (alimentation))       \
+        * NOMBRE_ETATS_RASPBERRY + (raspberry))                             \
+        * NOMBRE_ETATS_TEMPERATURE + (temperature))
+
+/**
+ * Position de chaque ligne dans la spécification. Une combinaison
+ * répétée y est déclarée deux fois, ce qui fait échouer la compilation.
+ */
+enum {
+#define ENERGIE(a, b, r, t, d, c, s, i) LIGNE_##a##_##b##_##r##_##t,
+#include "energie.def"
+#undef ENERGIE
+    NOMBRE_LIGNES_ENERGIE
+};
+
+/**
+ * Vérifie à la compilation que chaque ligne est à sa place, et que
+ * sa configuration est cohérente.
+ */
+#define ENERGIE(a, b, r, t, d, c, s, i)                                              \
+    typedef char verifiePosition_##a##_##b##_##r##_##t                               \
+        [(LIGNE_##a##_##b##_##r##_##t == INDEX_ENERGIE(a, b, r, t)) ? 1 : -1];      \
+    typedef char verifieConfiguration_##a##_##b##_##r##_##t                          \
+        [((c) && (s)) || ((s) && (i)) ? -1 : 1];
+#include "energie.def"
+#undef ENERGIE
+
+/** Vérifie à la compilation qu'aucune combinaison ne manque. */
+typedef char verifieNombreLignesEnergie[(NOMBRE_LIGNES_ENERGIE == 
+        NOMBRE_ETATS_ACCUMULATEUR * NOMBRE_ETATS_ALIMENTATION 
+        * NOMBRE_ETATS_RASPBERRY * NOMBRE_ETATS_TEMPERATURE) ? 1 : -1];
+
+/**
+ * Configuration de l'accumulateur pour chaque combinaison d'états,
+ * selon la spécification energie.def.
+ */
+static const Energie tableEnergie[] = {
+#define ENERGIE(a, b, r, t, d, c, s, i) {d, c, s, i},
+#include "energie.def"
+#undef ENERGIE
+};
+
+/**
+ * Compte une transition, et l'expose sur les registres I2C.
+ * @param transition Voir TransitionEnergie.
+ */
+static void compteTransition(TransitionEnergie transition) {
+    i2cExposeRegistre16(REGISTRE_TRANSITIONS_DISPONIBLE + 2 * transition, ++transitions[transition]);
+}
+
 /**
  * Calcule la configuration de l'accumulateur, selon les états de l'alimentation,
- * l'accumulateur et le raspberry.
+ * l'accumulateur, le raspberry et la température.
  * @return La configuration de l'accumulateur.
  */
 static Energie *etatEnergie() {
+    Energie precedente = energie;
 
-    // Disponibilité de l'accumulateur:
-    energie.accumulateurDisponible = 0;
-    if ( (etatAccumulateur == UTILISABLE) || (etatAccumulateur == UTILISABLE_MAIS_FAIBLE)) {
-        energie.accumulateurDisponible = 1;
+    energie = tableEnergie[INDEX_ENERGIE(etatAccumulateur, etatAlimentation, etatRaspberry, etatTemperature)];
+
+    // Energie tient dans un octet: une seule comparaison suffit
+    // pour savoir s'il y a quelque chose à faire.
+    if (*((unsigned char *) &energie) == *((unsigned char *) &precedente)) {
+        return &energie;
     }
+    modifiee = 1;
 
-    // Chargement ou sollicitation de l'accumulateur:
-    energie.chargerAccumulateur = 0;
-    energie.solliciterAccumulateur = 0;
-    energie.isolerAccumulateur = 0;
-    if (etatAlimentation == PRESENTE) {
-        if ( (etatAccumulateur == PAS_UTILISABLE) || (etatAccumulateur == UTILISABLE_MAIS_FAIBLE)) {
-            energie.chargerAccumulateur = 1;
-        }
-    } else {
-        if ( (etatAccumulateur == UTILISABLE) || (etatAccumulateur == UTILISABLE_MAIS_FAIBLE)) {
-            if (etatRaspberry == PROBABLEMENT_ACTIF) {
-                energie.solliciterAccumulateur = 1;
-            }
-        } 
-        // Si l'accumulateur n'est pas utilisable, autant l'isoler:
-        else {
-            energie.isolerAccumulateur = 1;
-        }
-        
-        // Si le raspberry est éteint, on peut isoler l'accumulateur:
-        if (etatRaspberry == INACTIF) {
-            energie.isolerAccumulateur = 1;
-        }
+    // Compte les transitions:
+    if (energie.accumulateurDisponible && !precedente.accumulateurDisponible) {
+        compteTransition(TRANSITION_DISPONIBLE);
+    }
+    if (energie.chargerAccumulateur && !precedente.chargerAccumulateur) {
+        compteTransition(TRANSITION_CHARGE);
+    }
+    if (energie.solliciterAccumulateur && !precedente.solliciterAccumulateur) {
+        compteTransition(TRANSITION_SOLLICITATION);
+    }
+
+    // Journalise les événements:
+    if (energie.isolerAccumulateur && !precedente.isolerAccumulateur) {
+        compteTransition(TRANSITION_ISOLATION);
+        journalEnregistre(JOURNAL_ISOLATION_ACCUMULATEUR);
+    }
+    if (precedente.chargerAccumulateur && !energie.chargerAccumulateur 
+            && (etatAccumulateur == UTILISABLE)) {
+        journalEnregistre(JOURNAL_CHARGE_COMPLETE);
     }
 
     // Rend l'état de l'accumulateur.
     return &energie;
 }
 
+Energie *energieActuelle() {
+    return &energie;
+}
+
+unsigned char energieModifiee() {
+    if (modifiee) {
+        modifiee = 0;
+        return 1;
+    }
+    return 0;
+}
+
+unsigned int energieTransitions(TransitionEnergie transition) {
+    return transitions[transition];
+}
+
+unsigned char energieAlimentationPresente() {
+    if (etatAlimentation == PRESENTE) {
+        return 255;
+    }
+    return 0;
+}
+
+unsigned char energieReleveDefaillances() {
+    unsigned char n = defaillances;
+    defaillances = 0;
+    return n;
+}
+
 Energie *mesureAlimentation(unsigned char v) {
     switch(etatAlimentation) {
         case PRESENTE:
             // Si l'alimentation tombe en dessous du 7.05V, elle n'est plus
             // utilisable.
-            if (v < 180) {
+            if (v < calibration.alimentationDefaillante) {
                 etatAlimentation = DEFAILLANTE;
+                if (defaillances < 255) {
+                    defaillances++;
+                }
+                journalEnregistre(JOURNAL_DEFAILLANCE_ALIMENTATION);
+                captureDeclenche(CAPTURE_ALIMENTATION);
             }
             break;
 
         case DEFAILLANTE:
             // Si l'alimentation remonte au dessus de 7.8V, elle est
             // utilisable à nouveau.
-            if (v > 198) {
+            if (v > calibration.alimentationPresente) {
                 etatAlimentation = PRESENTE;
-                etatRaspberry = PROBABLEMENT_ACTIF;
+                journalEnregistre(JOURNAL_RETOUR_ALIMENTATION);
+                captureDeclenche(CAPTURE_ALIMENTATION);
+                if ((etatRaspberry != ARRET_ANNONCE) || (politiqueRetour == RETOUR_ANNULE_ARRET)) {
+                    etatRaspberry = PROBABLEMENT_ACTIF;
+                    secondesAvantArret = 0;
+                }
             }
             break;
     }
@@ -143,32 +299,117 @@ Energie *mesureBoost(unsigned char v) {
         // Si la tension de sortie du convertisseur boost dépasse 9.5V, c'est
         // parce que le raspberry a cessé de consommer du courant.
         case PROBABLEMENT_ACTIF:
-            if (v > 241) {
+        case ARRET_ANNONCE:
+            if (v > calibration.raspberryInactif) {
                 etatRaspberry = INACTIF;
+                secondesAvantArret = 0;
+                captureDeclenche(CAPTURE_RASPBERRY);
             }
             break;
     }
     return etatEnergie();
 }
 
+void energieAnnonceArret(unsigned char secondes) {
+    if (secondes) {
+        etatRaspberry = ARRET_ANNONCE;
+    } else if (etatRaspberry == ARRET_ANNONCE) {
+        etatRaspberry = PROBABLEMENT_ACTIF;
+    }
+    secondesAvantArret = secondes;
+    i2cExposeRegistre(REGISTRE_ARRET_ANNONCE, secondesAvantArret);
+}
+
+void energieEtablitPolitiqueRetour(unsigned char politique) {
+    politiqueRetour = (PolitiqueRetour) politique;
+    i2cExposeRegistre(REGISTRE_POLITIQUE_RETOUR, politique);
+}
+
+unsigned char energieReveille() {
+    if (etatRaspberry == PROBABLEMENT_ACTIF) {
+        return 0;
+    }
+    etatRaspberry = PROBABLEMENT_ACTIF;
+    secondesAvantArret = 0;
+    i2cExposeRegistre(REGISTRE_ARRET_ANNONCE, secondesAvantArret);
+    journalEnregistre(JOURNAL_REVEIL);
+    return 255;
+}
+
+Energie *energieSeconde() {
+    if (etatRaspberry == ARRET_ANNONCE) {
+        if (--secondesAvantArret == 0) {
+            etatRaspberry = INACTIF;
+        }
+    }
+#ifdef PROFIL_CHARGE_DELTA_V
+    if (chargeSeconde()) {
+        etatAccumulateur = UTILISABLE;
+    }
+#endif
+    i2cExposeRegistre(REGISTRE_ARRET_ANNONCE, secondesAvantArret);
+    return etatEnergie();
+}
+
+Energie *mesureTemperature(signed char degres) {
+    // Sans mesure, la charge n'est pas suspendue: les circuits sans
+    // thermistance continuent à charger.
+    if (degres == TEMPERATURE_SONDE_DEFAILLANTE) {
+        etatTemperature = TEMPERATURE_ADMISE;
+    } else {
+        switch(etatTemperature) {
+            case TEMPERATURE_ADMISE:
+                if ((degres < TEMPERATURE_CHARGE_MINIMUM) || (degres > TEMPERATURE_CHARGE_MAXIMUM)) {
+                    etatTemperature = TEMPERATURE_HORS_LIMITES;
+                }
+                break;
+
+            case TEMPERATURE_HORS_LIMITES:
+                if ((degres >= TEMPERATURE_CHARGE_MINIMUM + TEMPERATURE_HYSTERESIS) 
+                        && (degres <= TEMPERATURE_CHARGE_MAXIMUM - TEMPERATURE_HYSTERESIS)) {
+                    etatTemperature = TEMPERATURE_ADMISE;
+                }
+                break;
+        }
+#ifdef PROFIL_CHARGE_DELTA_V
+        chargeMesureTemperature(degres);
+#endif
+    }
+    i2cExposeRegistre(REGISTRE_TEMPERATURE, (unsigned char) degres);
+    i2cExposeRegistre(REGISTRE_CHARGE_SUSPENDUE, etatTemperature == TEMPERATURE_HORS_LIMITES);
+    i2cExposeRegistre(REGISTRE_SONDE_DEFAILLANTE, degres == TEMPERATURE_SONDE_DEFAILLANTE);
+    return etatEnergie();
+}
+
 Energie *mesureAccumulateur(unsigned char vAccumulateur) {
-    // En dessous de 50 (1.96V):
-    if (vAccumulateur < 50) {
+#ifdef PROFIL_CHARGE_DELTA_V
+    // Fin de charge détectée par le moteur de charge:
+    if (energie.chargerAccumulateur) {
+        if (chargeMesureAccumulateur(vAccumulateur)) {
+            etatAccumulateur = UTILISABLE;
+        }
+    } else {
+        chargeInterrompt();
+    }
+#endif
+
+    // En dessous du seuil d'absence:
+    if (vAccumulateur < calibration.accumulateurAbsent) {
         etatAccumulateur = ABSENT;
     }
-    // Entre 50 et 80 (3.13V):
-    else if (vAccumulateur <= 80) {
+    // Jusqu'au seuil d'épuisement:
+    else if (vAccumulateur <= calibration.accumulateurPasUtilisable) {
         etatAccumulateur = PAS_UTILISABLE;
     }
-    // Entre 80 et 90 (3.53V):
-    else if (vAccumulateur <= 90) {
+    // Jusqu'au seuil de faiblesse:
+    else if (vAccumulateur <= calibration.accumulateurFaible) {
         etatAccumulateur = UTILISABLE_MAIS_FAIBLE;
     }
-    // Entre 90 et 107 (4.2V)
-    else if (vAccumulateur <= 107) {
+    // Jusqu'au seuil de charge complète:
+    else if (vAccumulateur <= calibration.accumulateurCharge) {
         switch(etatAccumulateur) {
             case UTILISABLE_MAIS_FAIBLE:
-                if (vAccumulateur >= 107) {
+                if (vAccumulateur >= calibration.accumulateurCharge) {
                     etatAccumulateur = UTILISABLE;
                 }
                 break;
@@ -178,14 +419,22 @@ Energie *mesureAccumulateur(unsigned char vAccumulateur) {
                 break;                
         }
     }
-    // Entre 107 et 114 (4.47V):
-    else if (vAccumulateur <= 114) {
+    // Jusqu'au seuil de surtension:
+    else if (vAccumulateur <= calibration.accumulateurSurtension) {
         etatAccumulateur = UTILISABLE;
     }
-    // Au dessus de 114:
+    // Au dessus du seuil de surtension:
     else {
         etatAccumulateur = ABSENT;
     }
+
+#ifdef PROFIL_CHARGE_DELTA_V
+    // Une charge reprise après une décharge, ou sur un autre 
+    // accumulateur, est une nouvelle charge:
+    if ((etatAccumulateur == ABSENT) || (etatAccumulateur == PAS_UTILISABLE)) {
+        chargeAbandonne();
+    }
+#endif
     
     return etatEnergie();
 }
@@ -200,6 +449,19 @@ Energie *mesureAccumulateur(unsigned char vAccumulateur) {
 
 static void peut_completer_un_cycle_de_charge() {
     initialiseEnergie();    
+#ifdef PROFIL_NIMH
+    verifieEgalite("ACCNY01", mesureAccumulateur(CONVERSION_8BITS(47))->chargerAccumulateur, 0);
+    verifieEgalite("ACCNY02", mesureAccumulateur(CONVERSION_8BITS(40))->chargerAccumulateur, 0);
+    verifieEgalite("ACCNY03", mesureAccumulateur(CONVERSION_8BITS(37))->chargerAccumulateur, 0);
+    verifieEgalite("ACCNY04", mesureAccumulateur(CONVERSION_8BITS(36))->chargerAccumulateur, 1);
+    verifieEgalite("ACCNY05", mesureAccumulateur(CONVERSION_8BITS(40))->chargerAccumulateur, 1);
+    verifieEgalite("ACCNY06", mesureAccumulateur(CONVERSION_8BITS(45))->chargerAccumulateur, 1);
+    verifieEgalite("ACCNY07", mesureAccumulateur(CONVERSION_8BITS(47))->chargerAccumulateur, 0);
+    verifieEgalite("ACCNY08", mesureAccumulateur(CONVERSION_8BITS(45))->chargerAccumulateur, 0);
+    verifieEgalite("ACCNY09", mesureAccumulateur(CONVERSION_8BITS(38))->chargerAccumulateur, 0);
+    verifieEgalite("ACCNY10", mesureAccumulateur(CONVERSION_8BITS(37))->chargerAccumulateur, 0);
+    verifieEgalite("ACCNY11", mesureAccumulateur(CONVERSION_8BITS(36))->chargerAccumulateur, 1);
+#else
     verifieEgalite("ACCCY01", mesureAccumulateur(CONVERSION_8BITS(42))->chargerAccumulateur, 0);
     verifieEgalite("ACCCY02", mesureAccumulateur(CONVERSION_8BITS(39))->chargerAccumulateur, 0);
     verifieEgalite("ACCCY03", mesureAccumulateur(CONVERSION_8BITS(36))->chargerAccumulateur, 0);
@@ -211,10 +473,21 @@ static void peut_completer_un_cycle_de_charge() {
     verifieEgalite("ACCCY09", mesureAccumulateur(CONVERSION_8BITS(38))->chargerAccumulateur, 0);
     verifieEgalite("ACCCY10", mesureAccumulateur(CONVERSION_8BITS(36))->chargerAccumulateur, 0);
     verifieEgalite("ACCCY11", mesureAccumulateur(CONVERSION_8BITS(35))->chargerAccumulateur, 1);    
+#endif
 }
 
 static void ne_recommence_pas_un_cycle_de_charge_si_le_precedent_est_interrompu() {
     initialiseEnergie();    
+#ifdef PROFIL_NIMH
+    verifieEgalite("ACCNI01", mesureAccumulateur(CONVERSION_8BITS(47))->chargerAccumulateur, 0);
+    verifieEgalite("ACCNI02", mesureAccumulateur(CONVERSION_8BITS(36))->chargerAccumulateur, 1);
+    verifieEgalite("ACCNI03", mesureAccumulateur(CONVERSION_8BITS(40))->chargerAccumulateur, 1);
+
+    initialiseEnergie();    
+    verifieEgalite("ACCNI04", mesureAccumulateur(CONVERSION_8BITS(40))->chargerAccumulateur, 0);
+    verifieEgalite("ACCNI05", mesureAccumulateur(CONVERSION_8BITS( 0))->chargerAccumulateur, 0);
+    verifieEgalite("ACCNI06", mesureAccumulateur(CONVERSION_8BITS(40))->chargerAccumulateur, 0);
+#else
     verifieEgalite("ACCCI01", mesureAccumulateur(CONVERSION_8BITS(42))->chargerAccumulateur, 0);
     verifieEgalite("ACCCI02", mesureAccumulateur(CONVERSION_8BITS(35))->chargerAccumulateur, 1);
     verifieEgalite("ACCCI03", mesureAccumulateur(CONVERSION_8BITS(39))->chargerAccumulateur, 1);
@@ -223,20 +496,28 @@ static void ne_recommence_pas_un_cycle_de_charge_si_le_precedent_est_interrompu(
     verifieEgalite("ACCCI04", mesureAccumulateur(CONVERSION_8BITS(39))->chargerAccumulateur, 0);
     verifieEgalite("ACCCI05", mesureAccumulateur(CONVERSION_8BITS( 0))->chargerAccumulateur, 0);
     verifieEgalite("ACCCI06", mesureAccumulateur(CONVERSION_8BITS(39))->chargerAccumulateur, 0);
+#endif
 }
 
 static void peut_detecter_que_l_accumulateur_est_disponible() {
     initialiseEnergie();
     
+#ifdef PROFIL_NIMH
+    verifieEgalite("ACCND01", mesureAccumulateur(CONVERSION_8BITS(29))->accumulateurDisponible, 0);
+    verifieEgalite("ACCND02", mesureAccumulateur(CONVERSION_8BITS(31))->accumulateurDisponible, 1);
+    verifieEgalite("ACCND03", mesureAccumulateur(CONVERSION_8BITS(47))->accumulateurDisponible, 1);
+    verifieEgalite("ACCND04", mesureAccumulateur(CONVERSION_8BITS(49))->accumulateurDisponible, 1);
+#else
     verifieEgalite("ACCDI01", mesureAccumulateur(CONVERSION_8BITS(31))->accumulateurDisponible, 0);
     verifieEgalite("ACCDI02", mesureAccumulateur(CONVERSION_8BITS(32))->accumulateurDisponible, 1);
     verifieEgalite("ACCDI03", mesureAccumulateur(CONVERSION_8BITS(42))->accumulateurDisponible, 1);
     verifieEgalite("ACCDI04", mesureAccumulateur(CONVERSION_8BITS(43))->accumulateurDisponible, 1);
+#endif
 }
 
 static void sollicite_l_accumulateur_si_l_alimentation_fait_defaut() {
     initialiseEnergie();
-    mesureAccumulateur(CONVERSION_8BITS(40));
+    mesureAccumulateur(CONVERSION_8BITS(TENSION_NOMINALE));
     verifieEgalite("ACCSOL01", mesureAlimentation(CONVERSION_8BITS(71))->solliciterAccumulateur, 0);
     verifieEgalite("ACCSOL02", mesureAlimentation(CONVERSION_8BITS(70))->solliciterAccumulateur, 1);
     verifieEgalite("ACCSOL03", mesureAlimentation(CONVERSION_8BITS(71))->solliciterAccumulateur, 1);
@@ -247,7 +528,7 @@ static void sollicite_l_accumulateur_si_l_alimentation_fait_defaut() {
 
 static void isole_l_accumulateur_si_le_raspberry_s_eteint() {
     initialiseEnergie();
-    mesureAccumulateur(CONVERSION_8BITS(40));
+    mesureAccumulateur(CONVERSION_8BITS(TENSION_NOMINALE));
     mesureAlimentation(CONVERSION_8BITS(60));
     verifieEgalite("ACCIS01", mesureBoost(CONVERSION_8BITS(85))->isolerAccumulateur, 0);
     verifieEgalite("ACCIS02", mesureBoost(CONVERSION_8BITS(90))->isolerAccumulateur, 0);
@@ -262,9 +543,17 @@ static void isole_l_accumulateur_si_pas_disponible_quand_l_alimentation_fait_def
     verifieEgalite("ACCIA02", mesureAccumulateur(CONVERSION_8BITS(28))->isolerAccumulateur, 1);
 }
 
+static void isole_l_accumulateur_epuise_selon_le_profil() {
+    initialiseEnergie();
+    mesureAlimentation(CONVERSION_8BITS(60));
+
+    verifieEgalite("ACCIE01", mesureAccumulateur(CONVERSION_8BITS(TENSION_NOMINALE))->isolerAccumulateur, 0);
+    verifieEgalite("ACCIE02", mesureAccumulateur(CONVERSION_8BITS(TENSION_EPUISEE))->isolerAccumulateur, 1);
+}
+
 static void ne_sollicite_plus_l_accumulateur_si_le_raspberry_s_eteint() {
     initialiseEnergie();
-    mesureAccumulateur(CONVERSION_8BITS(40));
+    mesureAccumulateur(CONVERSION_8BITS(TENSION_NOMINALE));
     mesureAlimentation(CONVERSION_8BITS(60));
     verifieEgalite("ACCAU01", mesureBoost(CONVERSION_8BITS(85))->solliciterAccumulateur, 1);
     verifieEgalite("ACCAU02", mesureBoost(CONVERSION_8BITS(90))->solliciterAccumulateur, 1);
@@ -274,7 +563,7 @@ static void ne_sollicite_plus_l_accumulateur_si_le_raspberry_s_eteint() {
 static void assume_que_le_raspberry_s_allume_si_l_alimentation_revient() {
     initialiseEnergie();
 
-    mesureAccumulateur(CONVERSION_8BITS(40));   // L'accumulateur est prêt.
+    mesureAccumulateur(CONVERSION_8BITS(TENSION_NOMINALE));   // L'accumulateur est prêt.
     mesureAlimentation(CONVERSION_8BITS(60));   // L'alimentation défaille.
     mesureBoost(CONVERSION_8BITS(95));          // Le convertisseur sature car pas de raspberry.
     
@@ -291,26 +580,188 @@ static void assume_que_le_raspberry_s_allume_si_l_alimentation_revient() {
 static void ne_solicite_plus_l_accumulateur_si_il_est_pas_disponible() {
     initialiseEnergie();
     
-    mesureAccumulateur(CONVERSION_8BITS(41));
+    mesureAccumulateur(CONVERSION_8BITS(TENSION_PRESQUE_PLEINE));
     verifieEgalite("ACCSL01", mesureAlimentation(CONVERSION_8BITS(59))->solliciterAccumulateur, 1);
     
-    mesureAccumulateur(CONVERSION_8BITS(32));
+    mesureAccumulateur(CONVERSION_8BITS(TENSION_LIMITE));
     verifieEgalite("ACCSL02", mesureAlimentation(CONVERSION_8BITS(59))->solliciterAccumulateur, 1);
 
-    mesureAccumulateur(CONVERSION_8BITS(31));
+    mesureAccumulateur(CONVERSION_8BITS(TENSION_EPUISEE));
     verifieEgalite("ACCSL03", mesureAlimentation(CONVERSION_8BITS(59))->solliciterAccumulateur, 0);
 
-    mesureAccumulateur(CONVERSION_8BITS(32));
+    mesureAccumulateur(CONVERSION_8BITS(TENSION_LIMITE));
     verifieEgalite("ACCSL04", mesureAlimentation(CONVERSION_8BITS(59))->solliciterAccumulateur, 1);
 }
 
 static void ne_solicite_pas_l_accumulateur_si_il_est_pas_disponible() {
     initialiseEnergie();
 
-    mesureAccumulateur(CONVERSION_8BITS(31));
+    mesureAccumulateur(CONVERSION_8BITS(TENSION_EPUISEE));
     verifieEgalite("ACCSD01", mesureAlimentation(CONVERSION_8BITS(59))->solliciterAccumulateur, 0);
 }
 
+static void isole_l_accumulateur_a_la_fin_de_l_arret_annonce() {
+    initialiseEnergie();
+    mesureAccumulateur(CONVERSION_8BITS(TENSION_NOMINALE));
+    mesureAlimentation(CONVERSION_8BITS(60));
+
+    energieAnnonceArret(3);
+    verifieEgalite("ACCAR01", energieSeconde()->isolerAccumulateur, 0);
+    verifieEgalite("ACCAR02", energieSeconde()->solliciterAccumulateur, 1);
+    verifieEgalite("ACCAR03", energieSeconde()->isolerAccumulateur, 1);
+    verifieEgalite("ACCAR04", mesureBoost(CONVERSION_8BITS(60))->solliciterAccumulateur, 0);
+}
+
+static void le_reveil_alimente_le_raspberry_arrete() {
+    initialiseEnergie();
+    mesureAccumulateur(CONVERSION_8BITS(TENSION_NOMINALE));
+    verifieEgalite("ACCRV01", energieReveille(), 0);
+    mesureAlimentation(CONVERSION_8BITS(60));
+
+    energieAnnonceArret(1);
+    verifieEgalite("ACCRV02", energieSeconde()->isolerAccumulateur, 1);
+    verifieEgalite("ACCRV03", energieReveille(), 255);
+    verifieEgalite("ACCRV04", energieSeconde()->solliciterAccumulateur, 1);
+    verifieEgalite("ACCRV05", energieReveille(), 0);
+
+    energieAnnonceArret(10);
+    verifieEgalite("ACCRV06", energieReveille(), 255);
+    verifieEgalite("ACCRV07", energieSeconde()->solliciterAccumulateur, 1);
+    verifieEgalite("ACCRV08", energieSeconde()->isolerAccumulateur, 0);
+}
+
+static void peut_annuler_l_arret_annonce() {
+    initialiseEnergie();
+    mesureAccumulateur(CONVERSION_8BITS(TENSION_NOMINALE));
+    mesureAlimentation(CONVERSION_8BITS(60));
+
+    energieAnnonceArret(2);
+    energieSeconde();
+    energieAnnonceArret(0);
+    energieSeconde();
+    verifieEgalite("ACCAN01", energieSeconde()->isolerAccumulateur, 0);
+    verifieEgalite("ACCAN02", energieSeconde()->solliciterAccumulateur, 1);
+}
+
+static void le_retour_de_l_alimentation_annule_l_arret_annonce() {
+    initialiseEnergie();
+    mesureAccumulateur(CONVERSION_8BITS(TENSION_NOMINALE));
+    mesureAlimentation(CONVERSION_8BITS(60));
+
+    energieAnnonceArret(2);
+    mesureAlimentation(CONVERSION_8BITS(80));
+    energieSeconde();
+    energieSeconde();
+    energieSeconde();
+    verifieEgalite("ACCRA01", mesureAlimentation(CONVERSION_8BITS(60))->solliciterAccumulateur, 1);
+    verifieEgalite("ACCRA02", mesureAlimentation(CONVERSION_8BITS(60))->isolerAccumulateur, 0);
+}
+
+static void le_retour_de_l_alimentation_peut_maintenir_l_arret_annonce() {
+    initialiseEnergie();
+    energieEtablitPolitiqueRetour(RETOUR_MAINTIENT_ARRET);
+    mesureAccumulateur(CONVERSION_8BITS(TENSION_NOMINALE));
+    mesureAlimentation(CONVERSION_8BITS(60));
+
+    energieAnnonceArret(2);
+    mesureAlimentation(CONVERSION_8BITS(80));
+    verifieEgalite("ACCRM01", energieSeconde()->isolerAccumulateur, 0);
+    verifieEgalite("ACCRM02", energieSeconde()->isolerAccumulateur, 0);
+    verifieEgalite("ACCRM03", mesureAlimentation(CONVERSION_8BITS(60))->solliciterAccumulateur, 0);
+    verifieEgalite("ACCRM04", mesureAlimentation(CONVERSION_8BITS(60))->isolerAccumulateur, 1);
+}
+
+static void suspend_la_charge_si_l_accumulateur_est_trop_chaud() {
+    initialiseEnergie();
+    mesureTemperature(25);
+    mesureAccumulateur(CONVERSION_8BITS(TENSION_PLEINE));
+    verifieEgalite("ACCTC01", mesureAccumulateur(CONVERSION_8BITS(TENSION_FAIBLE))->chargerAccumulateur, 1);
+    verifieEgalite("ACCTC02", mesureTemperature(45)->chargerAccumulateur, 1);
+    verifieEgalite("ACCTC03", mesureTemperature(46)->chargerAccumulateur, 0);
+    verifieEgalite("ACCTC04", mesureTemperature(43)->chargerAccumulateur, 0);
+    verifieEgalite("ACCTC05", mesureTemperature(42)->chargerAccumulateur, 1);
+}
+
+static void suspend_la_charge_si_l_accumulateur_est_trop_froid() {
+    initialiseEnergie();
+    mesureTemperature(25);
+    mesureAccumulateur(CONVERSION_8BITS(TENSION_PLEINE));
+    verifieEgalite("ACCTF01", mesureAccumulateur(CONVERSION_8BITS(TENSION_FAIBLE))->chargerAccumulateur, 1);
+    verifieEgalite("ACCTF02", mesureTemperature(0)->chargerAccumulateur, 1);
+    verifieEgalite("ACCTF03", mesureTemperature(-1)->chargerAccumulateur, 0);
+    verifieEgalite("ACCTF04", mesureTemperature(2)->chargerAccumulateur, 0);
+    verifieEgalite("ACCTF05", mesureTemperature(3)->chargerAccumulateur, 1);
+}
+
+static void une_sonde_defaillante_ne_suspend_pas_la_charge() {
+    initialiseEnergie();
+    mesureTemperature(25);
+    mesureAccumulateur(CONVERSION_8BITS(TENSION_PLEINE));
+    verifieEgalite("ACCSF01", mesureAccumulateur(CONVERSION_8BITS(TENSION_FAIBLE))->chargerAccumulateur, 1);
+    verifieEgalite("ACCSF02", mesureTemperature(TEMPERATURE_SONDE_DEFAILLANTE)->chargerAccumulateur, 1);
+    verifieEgalite("ACCSF03", mesureTemperature(60)->chargerAccumulateur, 0);
+    verifieEgalite("ACCSF04", mesureTemperature(TEMPERATURE_SONDE_DEFAILLANTE)->chargerAccumulateur, 1);
+    verifieEgalite("ACCSF05", mesureTemperature(60)->chargerAccumulateur, 0);
+    initialiseEnergie();
+}
+
+static void la_temperature_n_empeche_pas_de_solliciter_l_accumulateur() {
+    initialiseEnergie();
+    mesureTemperature(60);
+    mesureAccumulateur(CONVERSION_8BITS(TENSION_NOMINALE));
+    verifieEgalite("ACCTS01", mesureAlimentation(CONVERSION_8BITS(60))->solliciterAccumulateur, 1);
+    initialiseEnergie();
+}
+
+static void compte_les_transitions() {
+    unsigned int sollicitations;
+
+    initialiseEnergie();
+    mesureAccumulateur(CONVERSION_8BITS(TENSION_NOMINALE));
+    mesureAlimentation(CONVERSION_8BITS(80));
+    sollicitations = energieTransitions(TRANSITION_SOLLICITATION);
+
+    mesureAlimentation(CONVERSION_8BITS(60));
+    verifieEgalite("ACCTR01", energieTransitions(TRANSITION_SOLLICITATION), sollicitations + 1);
+    mesureAlimentation(CONVERSION_8BITS(60));
+    verifieEgalite("ACCTR02", energieTransitions(TRANSITION_SOLLICITATION), sollicitations + 1);
+    mesureAlimentation(CONVERSION_8BITS(80));
+    mesureAlimentation(CONVERSION_8BITS(60));
+    verifieEgalite("ACCTR03", energieTransitions(TRANSITION_SOLLICITATION), sollicitations + 2);
+    verifieEgalite("ACCTR04", energieTransitions(TRANSITION_ISOLATION), 0);
+}
+
+static void releve_les_defaillances_de_l_alimentation() {
+    initialiseEnergie();
+    mesureAccumulateur(CONVERSION_8BITS(TENSION_NOMINALE));
+    mesureAlimentation(CONVERSION_8BITS(80));
+    verifieEgalite("ACCDF01", energieAlimentationPresente(), 255);
+    verifieEgalite("ACCDF02", energieReleveDefaillances(), 0);
+
+    mesureAlimentation(CONVERSION_8BITS(60));
+    verifieEgalite("ACCDF03", energieAlimentationPresente(), 0);
+    mesureAlimentation(CONVERSION_8BITS(60));
+    mesureAlimentation(CONVERSION_8BITS(80));
+    mesureAlimentation(CONVERSION_8BITS(60));
+    verifieEgalite("ACCDF04", energieReleveDefaillances(), 2);
+    verifieEgalite("ACCDF05", energieReleveDefaillances(), 0);
+}
+
+static void signale_seulement_les_modifications() {
+    initialiseEnergie();
+    mesureAccumulateur(CONVERSION_8BITS(TENSION_NOMINALE));
+    mesureAlimentation(CONVERSION_8BITS(80));
+    energieModifiee();
+
+    mesureAlimentation(CONVERSION_8BITS(80));
+    verifieEgalite("ACCMO01", energieModifiee(), 0);
+    mesureAlimentation(CONVERSION_8BITS(60));
+    verifieEgalite("ACCMO02", energieModifiee(), 1);
+    verifieEgalite("ACCMO03", energieModifiee(), 0);
+    mesureAlimentation(CONVERSION_8BITS(60));
+    verifieEgalite("ACCMO04", energieModifiee(), 0);
+}
+
 void testeEnergie() {
     peut_detecter_que_l_accumulateur_est_disponible();
     peut_completer_un_cycle_de_charge();
@@ -322,9 +773,25 @@ void testeEnergie() {
 
     isole_l_accumulateur_si_le_raspberry_s_eteint();
     isole_l_accumulateur_si_pas_disponible_quand_l_alimentation_fait_defaut();
+    isole_l_accumulateur_epuise_selon_le_profil();
 
     ne_solicite_plus_l_accumulateur_si_il_est_pas_disponible();
     ne_solicite_pas_l_accumulateur_si_il_est_pas_disponible();    
+
+    isole_l_accumulateur_a_la_fin_de_l_arret_annonce();
+    le_reveil_alimente_le_raspberry_arrete();
+    peut_annuler_l_arret_annonce();
+    le_retour_de_l_alimentation_annule_l_arret_annonce();
+    le_retour_de_l_alimentation_peut_maintenir_l_arret_annonce();
+
+    suspend_la_charge_si_l_accumulateur_est_trop_chaud();
+    suspend_la_charge_si_l_accumulateur_est_trop_froid();
+    la_temperature_n_empeche_pas_de_solliciter_l_accumulateur();
+    une_sonde_defaillante_ne_suspend_pas_la_charge();
+
+    compte_les_transitions();
+    releve_les_defaillances_de_l_alimentation();
+    signale_seulement_les_modifications();
 }
 
 #endif
\ No newline at end of file
@@ -15,6 +15,22 @@ typedef struct {
     unsigned char isolerAccumulateur : 1;
 } Energie;
 
+/**
+ * Énumère les politiques à appliquer lorsque l'alimentation revient
+ * pendant un arrêt annoncé par le raspberry.
+ */
+typedef enum {
+    /** 
+     * L'arrêt est annulé, et le raspberry est présumé actif. 
+     */
+    RETOUR_ANNULE_ARRET = 0,
+    /** 
+     * Le compte à rebours continue; à son terme le raspberry est considéré
+     * inactif, et l'accumulateur sera isolé dès la prochaine défaillance.
+     */
+    RETOUR_MAINTIENT_ARRET = 1
+} PolitiqueRetour;
+
 /**
  * Initialise l'état de l'administration d'énergie.
  */
@@ -47,6 +63,94 @@ Energie *mesureAccumulateur(unsigned char vacc);
  */
 Energie *mesureBoost(unsigned char vboost);
 
+/**
+ * Administre l'énergie à partir de la température de l'accumulateur.
+ * La charge est suspendue lorsque l'accumulateur est trop chaud ou 
+ * trop froid, et reprend lorsque la température est revenue dans les limites.
+ * @param degres Température de l'accumulateur, en °C.
+ * @return État actuel de l'accumulateur. La fonction appelante est responsable
+ * de le propager sur le circuit.
+ */
+Energie *mesureTemperature(signed char degres);
+
+/**
+ * Le raspberry annonce qu'il s'arrête. L'accumulateur continue à 
+ * l'alimenter pendant le nombre de secondes indiqué, puis est isolé.
+ * @param secondes Le délai avant l'arrêt, ou 0 pour annuler l'arrêt annoncé.
+ */
+void energieAnnonceArret(unsigned char secondes);
+
+/**
+ * Établit la politique à appliquer lorsque l'alimentation revient pendant 
+ * un arrêt annoncé.
+ * @param politique Voir PolitiqueRetour.
+ */
+void energieEtablitPolitiqueRetour(unsigned char politique);
+
+/**
+ * L'heure du réveil programmé est atteinte: le raspberry est à nouveau
+ * présumé actif, et l'accumulateur l'alimente si l'alimentation fait
+ * défaut.
+ * @return 255 / -1 si le raspberry était arrêté ou s'arrêtait, et doit
+ * être démarré.
+ */
+unsigned char energieReveille();
+
+/**
+ * Fait avancer d'une seconde le compte à rebours de l'arrêt annoncé.
+ * @return État actuel de l'accumulateur. La fonction appelante est responsable
+ * de le propager sur le circuit.
+ */
+Energie *energieSeconde();
+
+/**
+ * @return L'état actuel de l'administration d'énergie, tel que calculé
+ * lors de la dernière mesure.
+ */
+Energie *energieActuelle();
+
+/**
+ * Énumère les catégories de transitions comptées.
+ * Chaque compteur est incrémenté lorsque le bit correspondant de
+ * Energie passe à 1.
+ */
+typedef enum {
+    /** L'accumulateur devient disponible. */
+    TRANSITION_DISPONIBLE = 0,
+    /** La charge commence. */
+    TRANSITION_CHARGE = 1,
+    /** L'accumulateur est sollicité. */
+    TRANSITION_SOLLICITATION = 2,
+    /** L'accumulateur est isolé. */
+    TRANSITION_ISOLATION = 3,
+    ENERGIE_NOMBRE_TRANSITIONS = 4
+} TransitionEnergie;
+
+/**
+ * Indique si l'état de l'administration d'énergie a changé depuis
+ * le dernier appel. Le premier appel rend toujours 1.
+ * @return 1 si l'état a changé.
+ */
+unsigned char energieModifiee();
+
+/**
+ * @param transition Voir TransitionEnergie.
+ * @return Le nombre de transitions de la catégorie indiquée.
+ */
+unsigned int energieTransitions(TransitionEnergie transition);
+
+/**
+ * @return 255 / -1 si l'alimentation est présente.
+ */
+unsigned char energieAlimentationPresente();
+
+/**
+ * Relève les défaillances de l'alimentation. Une défaillance trop brève
+ * pour durer une seconde est comptée aussi.
+ * @return Le nombre de défaillances depuis le relevé précédent.
+ */
+unsigned char energieReleveDefaillances();
+
 #ifdef TEST
 void testeEnergie();
 #endif
@@ -118,9 +118,27 @@ void testDebordePuisRecupereLesCaracteres() {
     verifieEgalite("FDB003", c, FILE_TAILLE);
 }
 
+void testMesureLeCoutDeLaFile() {
+    File file;
+    unsigned int cycles;
+    
+    fileReinitialise(&file);
+    fileEnfile(&file, 1);
+    chronometreDemarre();
+    fileEnfile(&file, 2);
+    cycles = chronometreLit();
+    verifieCycles("FCY001", cycles, FILE_CYCLES_MAXIMUM);
+
+    chronometreDemarre();
+    fileDefile(&file);
+    cycles = chronometreLit();
+    verifieCycles("FCY002", cycles, FILE_CYCLES_MAXIMUM);
+}
+
 int testeFile() {
     testEnfileEtDefile();
     testEnfileEtDefileBeaucoupDeCaracteres();
     testDebordePuisRecupereLesCaracteres();
+    testMesureLeCoutDeLaFile();
 }
 #endif
@@ -3,6 +3,12 @@
 
 #define FILE_TAILLE 10
 
+/**
+ * Coût maximum de fileEnfile et de fileDefile, en cycles d'instruction.
+ * Estimé, pas encore mesuré: FCY001 et FCY002 affichent le coût réel.
+ */
+#define FILE_CYCLES_MAXIMUM 80
+
 typedef struct {
     /** Espace de mémoire pour stocker la file. */
     char file[FILE_TAILLE];
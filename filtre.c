@@ -0,0 +1,144 @@
+#include "filtre.h"
+#include "test.h"
+
+/**
+ * État du filtre d'un canal.
+ */
+typedef struct {
+    /** Derniers échantillons, pour le filtre médian. */
+    unsigned char echantillons[FILTRE_MEDIANE];
+    /** Position du prochain échantillon. */
+    unsigned char position;
+    /** Accumulateur du filtre passe-bas, en 1 / 2^FILTRE_PROFONDEUR. */
+    unsigned int accumulateur;
+    /** Indique si le filtre a reçu son premier échantillon. */
+    unsigned char initialise;
+} Filtre;
+
+static Filtre filtres[FILTRE_NOMBRE_CANAUX];
+
+void filtreInitialise() {
+    unsigned char n;
+    for (n = 0; n < FILTRE_NOMBRE_CANAUX; n++) {
+        filtres[n].initialise = 0;
+    }
+}
+
+#if FILTRE_MEDIANE == 3
+/**
+ * @return La médiane de trois valeurs.
+ */
+static unsigned char mediane(unsigned char a, unsigned char b, unsigned char c) {
+    if (a > b) {
+        if (b > c) {
+            return b;
+        }
+        return (a > c) ? c : a;
+    }
+    if (a > c) {
+        return a;
+    }
+    return (b > c) ? c : b;
+}
+#endif
+
+unsigned char filtreEchantillon(unsigned char canal, unsigned char v) {
+    Filtre *filtre = &filtres[canal];
+    unsigned char n;
+
+    // Le premier échantillon remplit le filtre:
+    if (!filtre->initialise) {
+        for (n = 0; n < FILTRE_MEDIANE; n++) {
+            filtre->echantillons[n] = v;
+        }
+        filtre->position = 0;
+        filtre->accumulateur = (unsigned int) v << FILTRE_PROFONDEUR;
+        filtre->initialise = 255;
+        return v;
+    }
+
+#if FILTRE_MEDIANE == 3
+    filtre->echantillons[filtre->position] = v;
+    if (++filtre->position >= FILTRE_MEDIANE) {
+        filtre->position = 0;
+    }
+    v = mediane(filtre->echantillons[0], filtre->echantillons[1], filtre->echantillons[2]);
+#endif
+
+#if FILTRE_PROFONDEUR > 0
+    filtre->accumulateur -= filtre->accumulateur >> FILTRE_PROFONDEUR;
+    filtre->accumulateur += v;
+    v = (unsigned char) ((filtre->accumulateur + (1 << (FILTRE_PROFONDEUR - 1))) >> FILTRE_PROFONDEUR);
+#endif
+
+    return v;
+}
+
+#ifdef TEST
+
+#include "energie.h"
+
+static unsigned char echantillons(unsigned char canal, unsigned char v, unsigned char n) {
+    unsigned char resultat = 0;
+    while (n-- > 0) {
+        resultat = filtreEchantillon(canal, v);
+    }
+    return resultat;
+}
+
+static void elimine_une_pointe_isolee() {
+    filtreInitialise();
+    echantillons(0, 100, 10);
+    verifieEgalite("FLTPO01", filtreEchantillon(0, 250), 100);
+    verifieEgalite("FLTPO02", filtreEchantillon(0, 100), 100);
+    verifieEgalite("FLTPO03", filtreEchantillon(0, 0), 100);
+    verifieEgalite("FLTPO04", filtreEchantillon(0, 100), 100);
+}
+
+static void suit_un_changement_durable() {
+    filtreInitialise();
+    echantillons(1, 100, 10);
+    verifieEgalite("FLTCH01", echantillons(1, 200, 20), 200);
+}
+
+static void les_canaux_sont_independants() {
+    filtreInitialise();
+    echantillons(0, 10, 10);
+    echantillons(1, 20, 10);
+    echantillons(2, 30, 10);
+    verifieEgalite("FLTIN01", filtreEchantillon(0, 10), 10);
+    verifieEgalite("FLTIN02", filtreEchantillon(1, 20), 20);
+    verifieEgalite("FLTIN03", filtreEchantillon(2, 30), 30);
+}
+
+static void une_pointe_du_boost_n_arrete_pas_le_raspberry() {
+    initialiseEnergie();
+    filtreInitialise();
+    mesureAccumulateur(100);
+    mesureAlimentation(150);
+    echantillons(1, 200, 10);
+    verifieEgalite("FLTBO01", mesureBoost(filtreEchantillon(1, 250))->solliciterAccumulateur, 1);
+    verifieEgalite("FLTBO02", mesureBoost(filtreEchantillon(1, 200))->solliciterAccumulateur, 1);
+    verifieEgalite("FLTBO03", mesureBoost(echantillons(1, 250, 10))->solliciterAccumulateur, 0);
+}
+
+static void mesure_le_cout_du_filtre() {
+    unsigned int cycles;
+    
+    filtreInitialise();
+    echantillons(2, 100, 10);
+    chronometreDemarre();
+    filtreEchantillon(2, 101);
+    cycles = chronometreLit();
+    verifieInferieur("FLTCY01", cycles, FILTRE_CYCLES_MAXIMUM);
+}
+
+void testeFiltre() {
+    elimine_une_pointe_isolee();
+    suit_un_changement_durable();
+    les_canaux_sont_independants();
+    une_pointe_du_boost_n_arrete_pas_le_raspberry();
+    mesure_le_cout_du_filtre();
+}
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef FILTRE_H
+#define	FILTRE_H
+
+/** Nombre de canaux filtrés (ALIMENTATION, BOOST, ACCUMULATEUR, THERMISTANCE). */
+#define FILTRE_NOMBRE_CANAUX 4
+
+/**
+ * Longueur de la fenêtre médiane, qui élimine les pointes isolées.
+ * 3: élimine une pointe d'un échantillon. 1: pas de filtre médian.
+ */
+#ifndef FILTRE_MEDIANE
+#define FILTRE_MEDIANE 3
+#endif
+
+/**
+ * Profondeur du filtre passe-bas qui suit le filtre médian: chaque 
+ * échantillon contribue pour 1 / 2^FILTRE_PROFONDEUR.
+ * 0: pas de filtre passe-bas.
+ */
+#ifndef FILTRE_PROFONDEUR
+#define FILTRE_PROFONDEUR 2
+#endif
+
+/**
+ * Coût maximum du filtre par échantillon, en cycles d'instruction.
+ */
+#define FILTRE_CYCLES_MAXIMUM 200
+
+/**
+ * Réinitialise les filtres. Le prochain échantillon de chaque canal 
+ * initialisera son filtre.
+ */
+void filtreInitialise();
+
+/**
+ * Filtre un échantillon.
+ * @param canal Le canal analogique, entre 0 et FILTRE_NOMBRE_CANAUX - 1.
+ * @param v La conversion.
+ * @return La conversion filtrée.
+ */
+unsigned char filtreEchantillon(unsigned char canal, unsigned char v);
+
+#ifdef TEST
+void testeFiltre();
+#endif
+
+#endif
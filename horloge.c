@@ -0,0 +1,243 @@
+#include "horloge.h"
+#include "i2c.h"
+#include "test.h"
+
+/** Heure, en secondes. */
+static unsigned long heure = 0;
+
+/** Fraction de seconde accumulée pendant le sommeil, en ms. */
+static unsigned int millisecondes = 0;
+
+/** Heure du réveil, ou 0 si aucun réveil n'est programmé. */
+static unsigned long reveil = 0;
+
+/** Valeur en cours d'écriture par le raspberry. */
+static unsigned long proposition = 0;
+
+/** Durée corrigée d'une période de sommeil, en ms. */
+static unsigned int periodeVeille = HORLOGE_PERIODE_VEILLE_NOMINALE;
+
+/** Nombre de périodes de sommeil depuis le dernier réglage de l'heure. */
+static unsigned int periodesVeille = 0;
+
+/** Indique si l'heure a été réglée depuis l'initialisation. */
+static unsigned char reglee = 0;
+
+/**
+ * Expose l'heure sur les registres I2C.
+ */
+static void exposeHeure() {
+    i2cExposeRegistre16(REGISTRE_HORLOGE, (unsigned int) heure);
+    i2cExposeRegistre16(REGISTRE_HORLOGE + 2, (unsigned int) (heure >> 16));
+}
+
+/**
+ * Expose l'heure du réveil sur les registres I2C.
+ */
+static void exposeReveil() {
+    i2cExposeRegistre16(REGISTRE_REVEIL, (unsigned int) reveil);
+    i2cExposeRegistre16(REGISTRE_REVEIL + 2, (unsigned int) (reveil >> 16));
+}
+
+void horlogeInitialise() {
+    heure = 0;
+    millisecondes = 0;
+    reveil = 0;
+    proposition = 0;
+    periodeVeille = HORLOGE_PERIODE_VEILLE_NOMINALE;
+    periodesVeille = 0;
+    reglee = 0;
+    exposeHeure();
+    exposeReveil();
+    i2cExposeRegistre16(REGISTRE_PERIODE_VEILLE, periodeVeille);
+}
+
+/**
+ * Vérifie si l'heure du réveil est atteinte, et annule le réveil.
+ * @return 255 si l'heure du réveil est atteinte.
+ */
+static unsigned char reveilAtteint() {
+    exposeHeure();
+    if (reveil && (heure >= reveil)) {
+        reveil = 0;
+        exposeReveil();
+        return 255;
+    }
+    return 0;
+}
+
+unsigned char horlogeSeconde() {
+    heure++;
+    return reveilAtteint();
+}
+
+unsigned char horlogeVeille() {
+    millisecondes += periodeVeille;
+    while (millisecondes >= 1000) {
+        millisecondes -= 1000;
+        heure++;
+    }
+    if (periodesVeille < 0xFFFF) {
+        periodesVeille++;
+    }
+    return reveilAtteint();
+}
+
+/**
+ * Corrige la période de sommeil selon l'écart entre l'heure estimée et
+ * l'heure réglée par le raspberry. L'écart est attribué aux périodes de
+ * sommeil: le temporisateur 0 est bien plus précis que LFINTOSC.
+ * Ceci n'arrive qu'à chaque réglage; les divisions sont permises.
+ * @param nouvelle L'heure réglée.
+ */
+static void corrigePeriode(unsigned long nouvelle) {
+    long correction;
+
+    if (!reglee || (periodesVeille < HORLOGE_PERIODES_CALIBRATION)) {
+        return;
+    }
+    correction = (long) (nouvelle - heure) * 1000 / (long) periodesVeille;
+    correction += (long) periodeVeille - HORLOGE_PERIODE_VEILLE_NOMINALE;
+    if ((correction > HORLOGE_CORRECTION_MAXIMUM) || (correction < -HORLOGE_CORRECTION_MAXIMUM)) {
+        return;
+    }
+    periodeVeille = (unsigned int) (HORLOGE_PERIODE_VEILLE_NOMINALE + correction);
+    i2cExposeRegistre16(REGISTRE_PERIODE_VEILLE, periodeVeille);
+}
+
+void horlogeEcrit(unsigned char position, unsigned char valeur) {
+    ((unsigned char *) &proposition)[position & 3] = valeur;
+    switch (position) {
+        case 3:
+            corrigePeriode(proposition);
+            heure = proposition;
+            millisecondes = 0;
+            periodesVeille = 0;
+            reglee = 255;
+            exposeHeure();
+            break;
+        case 7:
+            reveil = proposition;
+            exposeReveil();
+            break;
+    }
+}
+
+unsigned char horlogeReveilProgramme() {
+    if (reveil) {
+        return 255;
+    }
+    return 0;
+}
+
+unsigned long horlogeHeure() {
+    return heure;
+}
+
+unsigned int horlogePeriodeVeille() {
+    return periodeVeille;
+}
+
+#ifdef TEST
+
+static void ecrit(unsigned char position, unsigned long valeur) {
+    unsigned char n;
+    for (n = 0; n < 4; n++) {
+        horlogeEcrit(position + n, (unsigned char) (valeur >> (8 * n)));
+    }
+}
+
+static void dort(unsigned int periodes) {
+    while (periodes-- > 0) {
+        horlogeVeille();
+    }
+}
+
+static void compte_les_secondes_et_les_periodes_de_sommeil() {
+    horlogeInitialise();
+    ecrit(0, 1700000000UL);
+    verifieEgalite("HORSE01", horlogeHeure() == 1700000000UL, 1);
+    horlogeSeconde();
+    verifieEgalite("HORSE02", (int) (horlogeHeure() - 1700000000UL), 1);
+    horlogeVeille();
+    verifieEgalite("HORSE03", (int) (horlogeHeure() - 1700000000UL), 5);
+    dort(124);
+    verifieEgalite("HORSE04", (int) (horlogeHeure() - 1700000000UL), 513);
+}
+
+static void l_ecriture_prend_effet_au_dernier_octet() {
+    horlogeInitialise();
+    horlogeEcrit(0, 0x10);
+    horlogeEcrit(1, 0x20);
+    verifieEgalite("HORER01", (int) horlogeHeure(), 0);
+    horlogeEcrit(2, 0x30);
+    horlogeEcrit(3, 0x40);
+    verifieEgalite("HORER02", horlogeHeure() == 0x40302010UL, 1);
+    horlogeEcrit(4, 0x01);
+    verifieEgalite("HORER03", horlogeReveilProgramme(), 0);
+    horlogeEcrit(5, 0);
+    horlogeEcrit(6, 0);
+    horlogeEcrit(7, 0);
+    verifieEgalite("HORER04", horlogeReveilProgramme(), 255);
+}
+
+static void le_reveil_sonne_une_seule_fois() {
+    horlogeInitialise();
+    ecrit(0, 1000);
+    ecrit(4, 1003);
+    verifieEgalite("HORRV01", horlogeSeconde(), 0);
+    verifieEgalite("HORRV02", horlogeSeconde(), 0);
+    verifieEgalite("HORRV03", horlogeSeconde(), 255);
+    verifieEgalite("HORRV04", horlogeReveilProgramme(), 0);
+    verifieEgalite("HORRV05", horlogeSeconde(), 0);
+
+    ecrit(4, 1010);
+    verifieEgalite("HORRV06", horlogeVeille(), 0);
+    verifieEgalite("HORRV07", horlogeVeille(), 255);
+    verifieEgalite("HORRV08", (int) horlogeHeure(), 1012);
+
+    ecrit(4, 1);
+    ecrit(4, 0);
+    verifieEgalite("HORRV09", horlogeReveilProgramme(), 0);
+    verifieEgalite("HORRV10", horlogeSeconde(), 0);
+}
+
+static void corrige_la_periode_de_sommeil() {
+    horlogeInitialise();
+
+    // Pas de correction au premier réglage, ni après un sommeil court:
+    dort(HORLOGE_PERIODES_CALIBRATION);
+    ecrit(0, 1700000000UL);
+    verifieEgalite("HORCA01", horlogePeriodeVeille(), HORLOGE_PERIODE_VEILLE_NOMINALE);
+    dort(HORLOGE_PERIODES_CALIBRATION - 1);
+    ecrit(0, horlogeHeure() + 300);
+    verifieEgalite("HORCA02", horlogePeriodeVeille(), HORLOGE_PERIODE_VEILLE_NOMINALE);
+
+    // LFINTOSC 10% plus lent: 1000 périodes durent 4505s au lieu de 4096s.
+    dort(1000);
+    ecrit(0, horlogeHeure() + 409);
+    verifieEgalite("HORCA03", horlogePeriodeVeille(), 4505);
+    dort(1000);
+    ecrit(0, horlogeHeure());
+    verifieEgalite("HORCA04", horlogePeriodeVeille(), 4505);
+
+    // Un changement d'heure n'est pas une dérive:
+    dort(1000);
+    ecrit(0, horlogeHeure() + 3600);
+    verifieEgalite("HORCA05", horlogePeriodeVeille(), 4505);
+
+    // LFINTOSC plus rapide:
+    dort(1000);
+    ecrit(0, horlogeHeure() - 819);
+    verifieEgalite("HORCA06", horlogePeriodeVeille(), 3686);
+}
+
+void testeHorloge() {
+    compte_les_secondes_et_les_periodes_de_sommeil();
+    l_ecriture_prend_effet_au_dernier_octet();
+    le_reveil_sonne_une_seule_fois();
+    corrige_la_periode_de_sommeil();
+    horlogeInitialise();
+}
+
+#endif
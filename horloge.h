@@ -0,0 +1,78 @@
+#ifndef HORLOGE_H
+#define	HORLOGE_H
+
+/**
+ * Horloge temps réel et réveil programmé du raspberry.
+ *
+ * L'heure est un nombre de secondes sur 32 bits, dont l'origine est
+ * choisie par le raspberry (par exemple l'heure Unix). Le circuit n'a pas
+ * de quartz de 32kHz (RC0 et RC1 pilotent les DEL): l'horloge compte
+ * les secondes du temporisateur 0 quand le micro-contrôleur est éveillé,
+ * et les périodes du chien de garde (LFINTOSC) quand il est en sommeil.
+ * Chaque fois que le raspberry règle l'heure après un sommeil assez long,
+ * l'écart constaté corrige la durée d'une période de sommeil.
+ */
+
+/** Période nominale du chien de garde, en ms (WDTPS = 1024). */
+#define HORLOGE_PERIODE_VEILLE_NOMINALE 4096
+
+/**
+ * Écart maximum entre la période corrigée et la période nominale, en ms.
+ * Un écart plus grand est un changement d'heure, pas une dérive.
+ */
+#define HORLOGE_CORRECTION_MAXIMUM 1024
+
+/**
+ * Nombre de périodes de sommeil nécessaires pour corriger la période
+ * (une heure): l'erreur de réglage du raspberry y est négligeable.
+ */
+#define HORLOGE_PERIODES_CALIBRATION 880
+
+/**
+ * Initialise l'horloge: heure 0, pas de réveil, période nominale.
+ */
+void horlogeInitialise();
+
+/**
+ * Avance l'horloge d'une seconde.
+ * @return 255 / -1 si l'heure du réveil est atteinte. Le réveil est
+ * alors annulé.
+ */
+unsigned char horlogeSeconde();
+
+/**
+ * Avance l'horloge d'une période de sommeil.
+ * @return 255 / -1 si l'heure du réveil est atteinte. Le réveil est
+ * alors annulé.
+ */
+unsigned char horlogeVeille();
+
+/**
+ * Écrit un octet de l'heure ou du réveil, octet le moins signifiant en
+ * premier. La valeur prend effet à l'écriture de l'octet le plus
+ * signifiant.
+ * @param position 0 à 3 pour l'heure, 4 à 7 pour le réveil.
+ * @param valeur La valeur de l'octet.
+ */
+void horlogeEcrit(unsigned char position, unsigned char valeur);
+
+/**
+ * @return 255 / -1 si un réveil est programmé.
+ */
+unsigned char horlogeReveilProgramme();
+
+/**
+ * @return L'heure, en secondes.
+ */
+unsigned long horlogeHeure();
+
+/**
+ * @return La durée corrigée d'une période de sommeil, en ms.
+ */
+unsigned int horlogePeriodeVeille();
+
+#ifdef TEST
+void testeHorloge();
+#endif
+
+#endif
@@ -80,6 +80,21 @@ void i2cRappelCommande(I2cRappelCommande r) {
     rappelCommande = r;
 }
 
+/** 
+ * Adresse de la fonction à appeler lorsque le maître écrit 
+ * un registre de l'adresse REGISTRES.
+ */
+static I2cRappelCommande rappelRegistre = faitRienDuTout;
+
+/**
+ * Établit la fonction à appeler lorsque le maître écrit un registre.
+ * La fonction reçoit le numéro de registre et la valeur écrite.
+ * @param r La fonction à appeler.
+ */
+void i2cRappelRegistre(I2cRappelCommande r) {
+    rappelRegistre = r;
+}
+
 void i2cMaitre() {
     static unsigned char adresse; // Adresse associée à la commande en cours.
     
@@ -155,48 +170,433 @@ void i2cExposeValeur(unsigned char adresse, unsigned char valeur) {
     i2cValeursExposees[adresse & I2C_MASQUE_ADRESSES_LOCALES] = valeur;
 }
 
+/** Registres exposés par l'esclave I2C à l'adresse REGISTRES. */
+unsigned char i2cRegistres[I2C_NOMBRE_REGISTRES];
+
+/** Numéro du prochain registre à lire. */
+static unsigned char registreCourant;
+
+/** Copie des registres figés, prise au début de chaque lecture. */
+static unsigned char registresFiges[I2C_NOMBRE_REGISTRES_FIGES];
+
 /**
- * Automate esclave I2C.
- * @param valeursLecture Liste de valeurs à rendre en cas d'opération
- * de lecture.
+ * Copie les registres figés, pour la lecture qui commence.
  */
-void i2cEsclave() {
-    static unsigned char adresse;
-    
+static void i2cFigeRegistres() {
+    unsigned char n;
+    for (n = 0; n < I2C_NOMBRE_REGISTRES_FIGES; n++) {
+        registresFiges[n] = i2cRegistres[I2C_PREMIER_REGISTRE_FIGE + n];
+    }
+}
+
+/**
+ * L'esclave rendra la valeur indiquée à la prochaine lecture du 
+ * registre indiqué.
+ * @param registre Numéro de registre, voir I2cRegistre.
+ * @param valeur La valeur.
+ */
+void i2cExposeRegistre(unsigned char registre, unsigned char valeur) {
+    i2cRegistres[registre] = valeur;
+}
+
+/**
+ * Expose une valeur de 16 bits sur deux registres consécutifs, 
+ * octet le moins signifiant en premier.
+ * Appelée hors de l'interruption, elle la masque entre les deux octets:
+ * une lecture ne rend jamais la moitié de l'ancienne valeur.
+ * @param registre Numéro du premier registre, voir I2cRegistre.
+ * @param valeur La valeur.
+ */
+void i2cExposeRegistre16(unsigned char registre, unsigned int valeur) {
+    unsigned char giel;
+
+    giel = INTCONbits.GIEL;
+    INTCONbits.GIEL = 0;
+    i2cRegistres[registre] = (unsigned char) valeur;
+    i2cRegistres[registre + 1] = (unsigned char) (valeur >> 8);
+    INTCONbits.GIEL = giel;
+}
+
+/** Fonctions rendant les octets des adresses lues en rafale. */
+static I2cRappelFlux flux[I2C_MASQUE_ADRESSES_LOCALES + 1];
+
+/**
+ * Lors des lectures de l'adresse indiquée, l'esclave rendra les octets
+ * successifs produits par la fonction indiquée.
+ * @param adresse Adresse locale.
+ * @param f La fonction, qui reçoit 255 / -1 pour le premier octet
+ * d'une lecture.
+ */
+void i2cExposeFlux(unsigned char adresse, I2cRappelFlux f) {
+    flux[adresse & I2C_MASQUE_ADRESSES_LOCALES] = f;
+}
+
+/** Fonctions appelées à la fin d'une lecture en rafale. */
+static I2cRappelFinFlux finsFlux[I2C_MASQUE_ADRESSES_LOCALES + 1];
+
+/** Valeur de fluxEnLecture lorsqu'aucun flux n'est en cours de lecture. */
+#define I2C_AUCUN_FLUX 0xFF
+
+/** Adresse locale du flux en cours de lecture. */
+static unsigned char fluxEnLecture = I2C_AUCUN_FLUX;
+
+/**
+ * À la fin de chaque lecture de l'adresse indiquée (STOP, ou nouvelle
+ * transaction), complète ou interrompue, l'esclave appellera la fonction
+ * indiquée.
+ * @param adresse Adresse locale.
+ * @param f La fonction.
+ */
+void i2cExposeFinFlux(unsigned char adresse, I2cRappelFinFlux f) {
+    finsFlux[adresse & I2C_MASQUE_ADRESSES_LOCALES] = f;
+}
+
+/**
+ * Termine la lecture du flux en cours, s'il y en a une.
+ */
+static void i2cTermineFlux() {
+    if (fluxEnLecture != I2C_AUCUN_FLUX) {
+        if (finsFlux[fluxEnLecture]) {
+            finsFlux[fluxEnLecture]();
+        }
+        fluxEnLecture = I2C_AUCUN_FLUX;
+    }
+}
+
+/**
+ * Rend la valeur à émettre pour une opération de lecture.
+ * À l'adresse REGISTRES, rend le registre courant et passe au suivant.
+ * @param adresse Adresse locale.
+ * @param premier 255 / -1 pour le premier octet de la lecture.
+ * @return La valeur à émettre.
+ */
+static unsigned char i2cValeurPourEmission(unsigned char adresse, unsigned char premier) {
+    unsigned char valeur;
+    if (flux[adresse]) {
+        return flux[adresse](premier);
+    }
+    if (adresse == (REGISTRES & I2C_MASQUE_ADRESSES_LOCALES)) {
+        if ((unsigned char) (registreCourant - I2C_PREMIER_REGISTRE_FIGE) < I2C_NOMBRE_REGISTRES_FIGES) {
+            valeur = registresFiges[registreCourant - I2C_PREMIER_REGISTRE_FIGE];
+        } else {
+            valeur = i2cRegistres[registreCourant];
+        }
+        registreCourant++;
+        if (registreCourant >= I2C_NOMBRE_REGISTRES) {
+            registreCourant = 0;
+        }
+        return valeur;
+    }
+    return i2cValeursExposees[adresse];
+}
+
+/**
+ * Table du CRC-8 du PEC SMBus (polynôme x^8 + x^2 + x + 1): chaque 
+ * octet ne coûte qu'une lecture de la table.
+ */
+static const unsigned char crc8[256] = {
+    0x00, 0x07, 0x0E, 0x09, 0x1C, 0x1B, 0x12, 0x15, 0x38, 0x3F, 0x36, 0x31, 0x24, 0x23, 0x2A, 0x2D,
+    0x70, 0x77, 0x7E, 0x79, 0x6C, 0x6B, 0x62, 0x65, 0x48, 0x4F, 0x46, 0x41, 0x54, 0x53, 0x5A, 0x5D,
+    0xE0, 0xE7, 0xEE, 0xE9, 0xFC, 0xFB, 0xF2, 0xF5, 0xD8, 0xDF, 0xD6, 0xD1, 0xC4, 0xC3, 0xCA, 0xCD,
+    0x90, 0x97, 0x9E, 0x99, 0x8C, 0x8B, 0x82, 0x85, 0xA8, 0xAF, 0xA6, 0xA1, 0xB4, 0xB3, 0xBA, 0xBD,
+    0xC7, 0xC0, 0xC9, 0xCE, 0xDB, 0xDC, 0xD5, 0xD2, 0xFF, 0xF8, 0xF1, 0xF6, 0xE3, 0xE4, 0xED, 0xEA,
+    0xB7, 0xB0, 0xB9, 0xBE, 0xAB, 0xAC, 0xA5, 0xA2, 0x8F, 0x88, 0x81, 0x86, 0x93, 0x94, 0x9D, 0x9A,
+    0x27, 0x20, 0x29, 0x2E, 0x3B, 0x3C, 0x35, 0x32, 0x1F, 0x18, 0x11, 0x16, 0x03, 0x04, 0x0D, 0x0A,
+    0x57, 0x50, 0x59, 0x5E, 0x4B, 0x4C, 0x45, 0x42, 0x6F, 0x68, 0x61, 0x66, 0x73, 0x74, 0x7D, 0x7A,
+    0x89, 0x8E, 0x87, 0x80, 0x95, 0x92, 0x9B, 0x9C, 0xB1, 0xB6, 0xBF, 0xB8, 0xAD, 0xAA, 0xA3, 0xA4,
+    0xF9, 0xFE, 0xF7, 0xF0, 0xE5, 0xE2, 0xEB, 0xEC, 0xC1, 0xC6, 0xCF, 0xC8, 0xDD, 0xDA, 0xD3, 0xD4,
+    0x69, 0x6E, 0x67, 0x60, 0x75, 0x72, 0x7B, 0x7C, 0x51, 0x56, 0x5F, 0x58, 0x4D, 0x4A, 0x43, 0x44,
+    0x19, 0x1E, 0x17, 0x10, 0x05, 0x02, 0x0B, 0x0C, 0x21, 0x26, 0x2F, 0x28, 0x3D, 0x3A, 0x33, 0x34,
+    0x4E, 0x49, 0x40, 0x47, 0x52, 0x55, 0x5C, 0x5B, 0x76, 0x71, 0x78, 0x7F, 0x6A, 0x6D, 0x64, 0x63,
+    0x3E, 0x39, 0x30, 0x37, 0x22, 0x25, 0x2C, 0x2B, 0x06, 0x01, 0x08, 0x0F, 0x1A, 0x1D, 0x14, 0x13,
+    0xAE, 0xA9, 0xA0, 0xA7, 0xB2, 0xB5, 0xBC, 0xBB, 0x96, 0x91, 0x98, 0x9F, 0x8A, 0x8D, 0x84, 0x83,
+    0xDE, 0xD9, 0xD0, 0xD7, 0xC2, 0xC5, 0xCC, 0xCB, 0xE6, 0xE1, 0xE8, 0xEF, 0xFA, 0xFD, 0xF4, 0xF3
+};
+
+/** 255 si le mode PEC est actif. */
+static unsigned char pec = 0;
+
+/** PEC de la transaction en cours, calculé octet par octet. */
+static unsigned char crc;
+
+/** 255 si la transaction a commencé par une écriture, sans STOP depuis. */
+static unsigned char suiteEcriture;
+
+/** 
+ * En lecture, nombre d'octets de données avant le PEC, ou 
+ * I2C_PEC_EMIS une fois le PEC émis.
+ */
+static unsigned char avantPec;
+#define I2C_PEC_EMIS 255
+
+/** En écriture, valeur reçue qui attend son PEC. */
+static unsigned char valeurEnAttente;
+
+/** 255 si valeurEnAttente attend son PEC. */
+static unsigned char attentePec;
+
+/**
+ * 255 si le mode PEC vient d'être activé par la transaction en cours:
+ * l'octet suivant est le PEC de cette écriture, que le maître envoie
+ * s'il est déjà en mode PEC. Il n'est ni appliqué, ni compté en erreur.
+ */
+static unsigned char pecDeLActivation;
+
+/** Nombre d'écritures rejetées à cause du PEC. */
+static unsigned int erreursPec;
+
+/** Nombre de débordements de réception. */
+static unsigned int erreursBus;
+
+/**
+ * Calcule le PEC d'une suite d'octets, comme l'esclave le fait 
+ * au fil de la transaction.
+ * @param crc Le PEC des octets précédents (0 pour le premier).
+ * @param octet L'octet suivant.
+ * @return Le PEC, octet compris.
+ */
+unsigned char i2cPec(unsigned char crc, unsigned char octet) {
+    return crc8[crc ^ octet];
+}
+
+static void comptePec() {
+    i2cExposeRegistre16(REGISTRE_ERREURS_PEC, ++erreursPec);
+}
+
+static void compteErreurBus() {
+    i2cExposeRegistre16(REGISTRE_ERREURS_BUS, ++erreursBus);
+}
+
+/**
+ * Début d'une écriture.
+ * @param octet L'octet d'adresse, R/W compris.
+ */
+static void i2cDebutEcriture(unsigned char octet) {
+    i2cTermineFlux();
+    crc = crc8[octet];
+    suiteEcriture = 255;
+    attentePec = 0;
+    pecDeLActivation = 0;
+}
+
+/**
+ * Début d'une lecture. Après une écriture sans STOP (START répété), le 
+ * PEC couvre aussi l'écriture.
+ * @param adresse Adresse locale.
+ * @param octet L'octet d'adresse, R/W compris.
+ */
+static void i2cDebutLecture(unsigned char adresse, unsigned char octet) {
+    if (!suiteEcriture) {
+        crc = 0;
+    }
+    crc = crc8[crc ^ octet];
+    suiteEcriture = 0;
+    i2cTermineFlux();
+    if (flux[adresse]) {
+        fluxEnLecture = adresse;
+        avantPec = I2C_PEC_EMIS;
+    } else if (adresse == (REGISTRES & I2C_MASQUE_ADRESSES_LOCALES)) {
+        i2cFigeRegistres();
+        avantPec = 2;
+    } else {
+        avantPec = 1;
+    }
+}
+
+/**
+ * Fin d'une transaction (STOP). Une valeur sans PEC est rejetée.
+ */
+static void i2cFinTransaction() {
+    if (attentePec) {
+        attentePec = 0;
+        comptePec();
+    }
+    suiteEcriture = 0;
+    pecDeLActivation = 0;
+    i2cTermineFlux();
+}
+
+/**
+ * Rend l'octet à émettre pour une opération de lecture: une valeur, ou
+ * en mode PEC, le PEC après les données.
+ * @param adresse Adresse locale.
+ * @param premier 255 / -1 pour le premier octet de la lecture.
+ * @return L'octet à émettre.
+ */
+static unsigned char i2cOctetPourEmission(unsigned char adresse, unsigned char premier) {
+    unsigned char valeur;
+
+    if (!pec) {
+        return i2cValeurPourEmission(adresse, premier);
+    }
+    if (avantPec == 0) {
+        avantPec = I2C_PEC_EMIS;
+        return crc;
+    }
+    valeur = i2cValeurPourEmission(adresse, premier);
+    if (avantPec != I2C_PEC_EMIS) {
+        avantPec--;
+        crc = crc8[crc ^ valeur];
+    }
+    return valeur;
+}
+
+/**
+ * Écrit un registre. Le mode PEC est géré ici; les autres registres
+ * sont confiés à la fonction de rappel.
+ * @param registre Numéro de registre, voir I2cRegistre.
+ * @param valeur La valeur.
+ */
+static void i2cEcritRegistre(unsigned char registre, unsigned char valeur) {
+    if (registre == REGISTRE_PEC) {
+        if (valeur && !pec) {
+            pecDeLActivation = 255;
+        }
+        pec = valeur ? 255 : 0;
+        i2cExposeRegistre(REGISTRE_PEC, valeur ? 1 : 0);
+    } else {
+        rappelRegistre(registre, valeur);
+    }
+}
+
+/**
+ * Applique une valeur reçue.
+ * @param adresse Adresse locale.
+ * @param valeur La valeur.
+ */
+static void i2cAppliqueValeur(unsigned char adresse, unsigned char valeur) {
+    if (adresse == (REGISTRES & I2C_MASQUE_ADRESSES_LOCALES)) {
+        i2cEcritRegistre(registreCourant++, valeur);
+        if (registreCourant >= I2C_NOMBRE_REGISTRES) {
+            registreCourant = 0;
+        }
+    } else {
+        // L'esclave doit traiter la donnée reçue:
+        rappelCommande(adresse, valeur);
+    }
+}
+
+/**
+ * Traite un octet de données reçu.
+ * À l'adresse REGISTRES, la première donnée est le numéro de registre.
+ * Les données suivantes sont écrites dans les registres successifs.
+ * En mode PEC, chaque valeur n'est appliquée que si l'octet suivant
+ * est le bon PEC.
+ * @param adresse Adresse locale.
+ * @param octet L'octet reçu.
+ * @param premier 255 / -1 pour le premier octet de l'écriture.
+ */
+static void i2cDonneeRecue(unsigned char adresse, unsigned char octet, unsigned char premier) {
+    if (premier && (adresse == (REGISTRES & I2C_MASQUE_ADRESSES_LOCALES))) {
+        crc = crc8[crc ^ octet];
+        registreCourant = octet;
+        if (registreCourant >= I2C_NOMBRE_REGISTRES) {
+            registreCourant = 0;
+        }
+    } else if (!pec) {
+        i2cAppliqueValeur(adresse, octet);
+    } else if (pecDeLActivation) {
+        pecDeLActivation = 0;
+    } else if (!attentePec) {
+        crc = crc8[crc ^ octet];
+        valeurEnAttente = octet;
+        attentePec = 255;
+    } else {
+        attentePec = 0;
+        if (octet == crc) {
+            i2cAppliqueValeur(adresse, valeurEnAttente);
+        } else {
+            comptePec();
+        }
+        crc = crc8[crc ^ octet];
+    }
+}
+
+/** Bits de SSP1STAT utilisés par l'automate. */
+#define STATUT_BF 0x01
+#define STATUT_RW 0x04
+#define STATUT_S 0x08
+#define STATUT_P 0x10
+#define STATUT_DA 0x20
+
+/** Adresse locale de la transaction en cours. */
+static unsigned char adresseCourante;
+
+/** 255 / -1 jusqu'à la première donnée d'une écriture. */
+static unsigned char premiereDonnee;
+
+/**
+ * Automate esclave I2C. Ne dépend pas du MSSP, pour être testé.
+ * Seules les interruptions qui apportent un octet (BF allumé) ou qui en
+ * demandent un (horloge retenue en lecture) sont traitées: une 
+ * interruption de START ou de START répété, ou le NACK du maître en fin
+ * de lecture, ne relit jamais l'ancien contenu de SSP1BUF.
+ * @param statut La valeur de SSP1STAT.
+ * @param octet L'octet lu dans SSP1BUF, si BF est allumé.
+ * @param horlogeRetenue 255 / -1 si le MSSP retient l'horloge (CKP éteint).
+ * @param emission Reçoit l'octet à émettre.
+ * @return 255 / -1 si un octet doit être émis.
+ */
+static unsigned char i2cAutomate(unsigned char statut, unsigned char octet, 
+        unsigned char horlogeRetenue, unsigned char *emission) {
     // Machine à état extraite de Microchip AN00734b - Appendice B
-    if (SSP1STATbits.S) {
-        if (SSP1STATbits.RW) {
+    if (statut & STATUT_S) {
+        if (statut & STATUT_RW) {
             // État 4 - Opération de lecture, dernier octet transmis est une donnée:
-            // Jamais utilisé si les commandes ont un seul octet associé.
-            if (SSP1STATbits.DA) {
-                SSP1BUF = i2cValeursExposees[adresse];
-                SSP1CON1bits.CKP = 1;
+            if (statut & STATUT_DA) {
+                if (!horlogeRetenue) {
+                    return 0;
+                }
+                *emission = i2cOctetPourEmission(adresseCourante, 0);
+                return 255;
             } 
             // État 3 - Opération de lecture, dernier octet reçu est une adresse:
-            else {
-                adresse = convertitEnAdresseLocale(SSP1BUF);
-                SSP1BUF = i2cValeursExposees[adresse];
-                SSP1CON1bits.CKP = 1;
-                // Sur les PIC18 plus récents, BF s'allume en État 3.
-                // Il doit être lu et désactivé.
-                if (SSP1STATbits.BF) {
-                    SSP1STATbits.BF = 0;
-                }
+            if (statut & STATUT_BF) {
+                adresseCourante = convertitEnAdresseLocale(octet);
+                i2cDebutLecture(adresseCourante, octet);
+                *emission = i2cOctetPourEmission(adresseCourante, 255);
+                return 255;
             }
-        } else {
+        } else if (statut & STATUT_BF) {
             // État 2 - Opération d'écriture, dernier octet reçu est une donnée:
-            if (SSP1STATbits.DA) {
-                // L'esclave doit traiter la donnée reçue:
-                rappelCommande(adresse, SSP1BUF);
+            if (statut & STATUT_DA) {
+                i2cDonneeRecue(adresseCourante, octet, premiereDonnee);
+                premiereDonnee = 0;
             }
             // État 1 - Opération d'écriture, dernier octet reçu est une adresse:
             else {
-                adresse = convertitEnAdresseLocale(SSP1BUF);
-                if (SSP1CON1bits.SSPOV) {
-                    SSP1CON1bits.SSPOV = 0;
-                }
+                adresseCourante = convertitEnAdresseLocale(octet);
+                i2cDebutEcriture(octet);
+                premiereDonnee = 255;
             }
         }
+    } else if (statut & STATUT_P) {
+        // État 5 - STOP: fin de la transaction.
+        i2cFinTransaction();
+    }
+    return 0;
+}
+
+/**
+ * Interruption du MSSP1 en esclave I2C.
+ */
+void i2cEsclave() {
+    unsigned char statut = SSP1STAT;
+    unsigned char octet = 0;
+    unsigned char emission;
+
+    // Lire SSP1BUF éteint BF; sur les PIC18 plus récents, BF s'allume
+    // aussi en État 3:
+    if (statut & STATUT_BF) {
+        octet = SSP1BUF;
+    }
+    if (i2cAutomate(statut, octet, SSP1CON1bits.CKP ? 0 : 255, &emission)) {
+        SSP1BUF = emission;
+        SSP1CON1bits.CKP = 1;
+    }
+    if (SSP1CON1bits.SSPOV) {
+        SSP1CON1bits.SSPOV = 0;
+        compteErreurBus();
     }
     PIR1bits.SSP1IF = 0;
 }
@@ -207,4 +607,305 @@ void i2cEsclave() {
 void i2cReinitialise() {
     etatMaitre = I2C_MASTER_EMISSION_ADRESSE;
     fileReinitialise(&fileEmission);
-}
\ No newline at end of file
+}
+
+#ifdef TEST
+
+#define ADRESSE_LOCALE_REGISTRES (REGISTRES & I2C_MASQUE_ADRESSES_LOCALES)
+
+/**
+ * Octet d'adresse émis par le maître (en écriture) pour une adresse 
+ * locale: le bus voit les adresses 0x08 à 0x0F, comme dans ups-etat.h.
+ */
+#define OCTET_ADRESSE(a) ((0x08 | ((a) & I2C_MASQUE_ADRESSES_LOCALES)) << 1)
+
+static unsigned char fluxDeTest(unsigned char premier) {
+    static unsigned char n;
+    if (premier) {
+        n = 0;
+    }
+    return n++;
+}
+
+static void lit_les_registres_successifs() {
+    i2cExposeRegistre(I2C_NOMBRE_REGISTRES - 1, 10);
+    i2cExposeRegistre(0, 11);
+    registreCourant = I2C_NOMBRE_REGISTRES - 1;
+    verifieEgalite("I2CRE01", i2cValeurPourEmission(ADRESSE_LOCALE_REGISTRES, 255), 10);
+    verifieEgalite("I2CRE02", i2cValeurPourEmission(ADRESSE_LOCALE_REGISTRES, 0), 11);
+}
+
+static void lit_une_heure_coherente() {
+    i2cExposeRegistre16(REGISTRE_HORLOGE, 0xFFFF);
+    i2cExposeRegistre16(REGISTRE_HORLOGE + 2, 0x0000);
+    registreCourant = REGISTRE_HORLOGE;
+    i2cDebutLecture(ADRESSE_LOCALE_REGISTRES, OCTET_ADRESSE(REGISTRES) | 1);
+    verifieEgalite("I2CFG01", i2cValeurPourEmission(ADRESSE_LOCALE_REGISTRES, 255), 0xFF);
+    verifieEgalite("I2CFG02", i2cValeurPourEmission(ADRESSE_LOCALE_REGISTRES, 0), 0xFF);
+
+    // L'horloge avance pendant la lecture:
+    i2cExposeRegistre16(REGISTRE_HORLOGE, 0x0000);
+    i2cExposeRegistre16(REGISTRE_HORLOGE + 2, 0x0001);
+    verifieEgalite("I2CFG03", i2cValeurPourEmission(ADRESSE_LOCALE_REGISTRES, 0), 0x00);
+    verifieEgalite("I2CFG04", i2cValeurPourEmission(ADRESSE_LOCALE_REGISTRES, 0), 0x00);
+    i2cFinTransaction();
+
+    // La lecture suivante rend la nouvelle heure:
+    registreCourant = REGISTRE_HORLOGE + 2;
+    i2cDebutLecture(ADRESSE_LOCALE_REGISTRES, OCTET_ADRESSE(REGISTRES) | 1);
+    verifieEgalite("I2CFG05", i2cValeurPourEmission(ADRESSE_LOCALE_REGISTRES, 255), 0x01);
+    i2cFinTransaction();
+}
+
+static void lit_les_flux() {
+    i2cExposeFlux(LECTURE_PROFILAGE, fluxDeTest);
+    verifieEgalite("I2CFL01", i2cValeurPourEmission(LECTURE_PROFILAGE & I2C_MASQUE_ADRESSES_LOCALES, 255), 0);
+    verifieEgalite("I2CFL02", i2cValeurPourEmission(LECTURE_PROFILAGE & I2C_MASQUE_ADRESSES_LOCALES, 0), 1);
+    i2cExposeFlux(LECTURE_PROFILAGE, 0);
+}
+
+static void mesure_le_cout_de_l_emission() {
+    unsigned int cycles;
+    
+    chronometreDemarre();
+    i2cValeurPourEmission(ADRESSE_LOCALE_REGISTRES, 0);
+    cycles = chronometreLit();
+    verifieCycles("I2CCY01", cycles, I2C_CYCLES_MAXIMUM);
+
+    chronometreDemarre();
+    i2cValeurPourEmission(LECTURE_ACCUMULATEUR & I2C_MASQUE_ADRESSES_LOCALES, 0);
+    cycles = chronometreLit();
+    verifieCycles("I2CCY02", cycles, I2C_CYCLES_MAXIMUM);
+}
+
+/** Octets d'adresse de REGISTRES (adresse 0x08 sur le bus), en écriture et en lecture. */
+#define ECRITURE_REGISTRES OCTET_ADRESSE(REGISTRES)
+#define LECTURE_REGISTRES (OCTET_ADRESSE(REGISTRES) | 1)
+
+static unsigned char registreEcrit;
+static unsigned char valeurEcrite;
+
+static void ecritRegistreDeTest(unsigned char registre, unsigned char valeur) {
+    registreEcrit = registre;
+    valeurEcrite = valeur;
+}
+
+static unsigned char pecDe(unsigned char *octets, unsigned char n) {
+    unsigned char c = 0;
+    while (n--) {
+        c = i2cPec(c, *octets++);
+    }
+    return c;
+}
+
+static void calcule_le_pec_smbus() {
+    unsigned char reference[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+    verifieEgalite("I2CPE01", pecDe(reference, sizeof(reference)), 0xF4);
+}
+
+static void ajoute_le_pec_apres_un_mot() {
+    unsigned char transaction[] = {ECRITURE_REGISTRES, 3, LECTURE_REGISTRES, 0x34, 0x12};
+
+    i2cExposeRegistre16(3, 0x1234);
+    i2cEcritRegistre(REGISTRE_PEC, 1);
+    i2cDebutEcriture(ECRITURE_REGISTRES);
+    i2cDonneeRecue(ADRESSE_LOCALE_REGISTRES, 3, 255);
+    i2cDebutLecture(ADRESSE_LOCALE_REGISTRES, LECTURE_REGISTRES);
+    verifieEgalite("I2CPE02", i2cOctetPourEmission(ADRESSE_LOCALE_REGISTRES, 255), 0x34);
+    verifieEgalite("I2CPE03", i2cOctetPourEmission(ADRESSE_LOCALE_REGISTRES, 0), 0x12);
+    verifieEgalite("I2CPE04", i2cOctetPourEmission(ADRESSE_LOCALE_REGISTRES, 0), pecDe(transaction, 5));
+    i2cFinTransaction();
+    i2cEcritRegistre(REGISTRE_PEC, 0);
+}
+
+static void ajoute_le_pec_apres_une_valeur() {
+    unsigned char adresse = OCTET_ADRESSE(LECTURE_BOOST) | 1;
+    unsigned char transaction[] = {adresse, 200};
+
+    i2cExposeValeur(LECTURE_BOOST, 200);
+    i2cEcritRegistre(REGISTRE_PEC, 1);
+    i2cDebutLecture(LECTURE_BOOST & I2C_MASQUE_ADRESSES_LOCALES, adresse);
+    verifieEgalite("I2CPE05", i2cOctetPourEmission(LECTURE_BOOST & I2C_MASQUE_ADRESSES_LOCALES, 255), 200);
+    verifieEgalite("I2CPE06", i2cOctetPourEmission(LECTURE_BOOST & I2C_MASQUE_ADRESSES_LOCALES, 0), pecDe(transaction, 2));
+    i2cFinTransaction();
+    i2cEcritRegistre(REGISTRE_PEC, 0);
+}
+
+/**
+ * Écrit un registre en mode PEC.
+ * @param correct 0 pour transmettre un PEC faux, 255 pour l'omettre.
+ */
+static void ecritAvecPec(unsigned char registre, unsigned char valeur, unsigned char correct) {
+    unsigned char transaction[] = {ECRITURE_REGISTRES, registre, valeur};
+
+    i2cDebutEcriture(ECRITURE_REGISTRES);
+    i2cDonneeRecue(ADRESSE_LOCALE_REGISTRES, registre, 255);
+    i2cDonneeRecue(ADRESSE_LOCALE_REGISTRES, valeur, 0);
+    if (correct != 255) {
+        i2cDonneeRecue(ADRESSE_LOCALE_REGISTRES, pecDe(transaction, 3) ^ (correct ? 0 : 1), 0);
+    }
+    i2cFinTransaction();
+}
+
+static void verifie_le_pec_des_ecritures() {
+    unsigned int erreurs = erreursPec;
+
+    i2cRappelRegistre(ecritRegistreDeTest);
+    i2cEcritRegistre(REGISTRE_PEC, 1);
+    valeurEcrite = 0;
+    ecritAvecPec(REGISTRE_ARRET_ANNONCE, 30, 1);
+    verifieEgalite("I2CPV01", registreEcrit, REGISTRE_ARRET_ANNONCE);
+    verifieEgalite("I2CPV02", valeurEcrite, 30);
+
+    ecritAvecPec(REGISTRE_ARRET_ANNONCE, 40, 0);
+    verifieEgalite("I2CPV03", valeurEcrite, 30);
+    verifieEgalite("I2CPV04", erreursPec, erreurs + 1);
+
+    ecritAvecPec(REGISTRE_ARRET_ANNONCE, 50, 255);
+    verifieEgalite("I2CPV05", valeurEcrite, 30);
+    verifieEgalite("I2CPV06", erreursPec, erreurs + 2);
+    verifieEgalite("I2CPV07", i2cRegistres[REGISTRE_ERREURS_PEC], erreurs + 2);
+
+    ecritAvecPec(REGISTRE_PEC, 0, 1);
+    verifieEgalite("I2CPV08", pec, 0);
+    i2cRappelRegistre(faitRienDuTout);
+}
+
+/**
+ * Présente à l'automate une interruption sans horloge retenue.
+ */
+static void recoit(unsigned char statut, unsigned char octet) {
+    unsigned char emission;
+    i2cAutomate(statut, octet, 0, &emission);
+}
+
+/**
+ * Présente à l'automate une interruption de lecture, horloge retenue.
+ * @return L'octet émis.
+ */
+static unsigned char emet(unsigned char statut, unsigned char octet) {
+    unsigned char emission = 0;
+    i2cAutomate(statut, octet, 255, &emission);
+    return emission;
+}
+
+static void lit_un_registre_apres_un_start_repete() {
+    i2cRappelRegistre(ecritRegistreDeTest);
+    registreEcrit = 0xFF;
+    i2cExposeRegistre16(5, 0x1234);
+
+    recoit(STATUT_S, 0);
+    recoit(STATUT_S | STATUT_BF, ECRITURE_REGISTRES);
+    recoit(STATUT_S | STATUT_DA | STATUT_BF, 5);
+    // START répété: SSP1BUF contient encore le numéro de registre.
+    recoit(STATUT_S | STATUT_DA, 5);
+    verifieEgalite("I2CAU01", registreEcrit, 0xFF);
+    verifieEgalite("I2CAU02", registreCourant, 5);
+
+    verifieEgalite("I2CAU03", emet(STATUT_S | STATUT_RW | STATUT_BF, LECTURE_REGISTRES), 0x34);
+    verifieEgalite("I2CAU04", emet(STATUT_S | STATUT_RW | STATUT_DA, 0), 0x12);
+    // NACK du maître, puis START répété après la lecture:
+    recoit(STATUT_S | STATUT_DA, 0x12);
+    recoit(STATUT_S | STATUT_RW | STATUT_DA, 0);
+    recoit(STATUT_P, 0);
+    verifieEgalite("I2CAU05", registreEcrit, 0xFF);
+    verifieEgalite("I2CAU06", registreCourant, 7);
+    i2cRappelRegistre(faitRienDuTout);
+}
+
+static unsigned char finsDeTest;
+
+static void finDeTest() {
+    finsDeTest++;
+}
+
+static void signale_la_fin_d_une_lecture_en_rafale() {
+    unsigned char adresse = OCTET_ADRESSE(LECTURE_PROFILAGE) | 1;
+
+    i2cExposeFlux(LECTURE_PROFILAGE, fluxDeTest);
+    i2cExposeFinFlux(LECTURE_PROFILAGE, finDeTest);
+    finsDeTest = 0;
+
+    // Lecture interrompue après un octet:
+    recoit(STATUT_S, 0);
+    verifieEgalite("I2CFF01", emet(STATUT_S | STATUT_RW | STATUT_BF, adresse), 0);
+    verifieEgalite("I2CFF02", finsDeTest, 0);
+    recoit(STATUT_P, 0);
+    verifieEgalite("I2CFF03", finsDeTest, 1);
+
+    // Une autre transaction n'appelle pas la fin du flux:
+    recoit(STATUT_S | STATUT_BF, ECRITURE_REGISTRES);
+    recoit(STATUT_P, 0);
+    verifieEgalite("I2CFF04", finsDeTest, 1);
+
+    // Une transaction sans STOP termine aussi la lecture:
+    emet(STATUT_S | STATUT_RW | STATUT_BF, adresse);
+    recoit(STATUT_S | STATUT_BF, ECRITURE_REGISTRES);
+    verifieEgalite("I2CFF05", finsDeTest, 2);
+    recoit(STATUT_P, 0);
+
+    i2cExposeFinFlux(LECTURE_PROFILAGE, 0);
+    i2cExposeFlux(LECTURE_PROFILAGE, 0);
+}
+
+static void lit_un_mot_avec_pec_apres_un_start_repete() {
+    unsigned char activation[] = {ECRITURE_REGISTRES, REGISTRE_PEC, 1};
+    unsigned char transaction[] = {ECRITURE_REGISTRES, 3, LECTURE_REGISTRES, 0x78, 0x56};
+    unsigned int erreurs = erreursPec;
+
+    // Le maître active le mode PEC avec le PEC de l'activation:
+    recoit(STATUT_S, 0);
+    recoit(STATUT_S | STATUT_BF, ECRITURE_REGISTRES);
+    recoit(STATUT_S | STATUT_DA | STATUT_BF, REGISTRE_PEC);
+    recoit(STATUT_S | STATUT_DA | STATUT_BF, 1);
+    recoit(STATUT_S | STATUT_DA | STATUT_BF, pecDe(activation, 3));
+    recoit(STATUT_P, 0);
+    verifieEgalite("I2CPA01", pec, 255);
+    verifieEgalite("I2CPA02", erreursPec, erreurs);
+
+    // SMBus Read Word:
+    i2cExposeRegistre16(3, 0x5678);
+    recoit(STATUT_S, 0);
+    recoit(STATUT_S | STATUT_BF, ECRITURE_REGISTRES);
+    recoit(STATUT_S | STATUT_DA | STATUT_BF, 3);
+    recoit(STATUT_S | STATUT_DA, 3);
+    verifieEgalite("I2CPA03", emet(STATUT_S | STATUT_RW | STATUT_BF, LECTURE_REGISTRES), 0x78);
+    verifieEgalite("I2CPA04", emet(STATUT_S | STATUT_RW | STATUT_DA, 0), 0x56);
+    verifieEgalite("I2CPA05", emet(STATUT_S | STATUT_RW | STATUT_DA, 0), pecDe(transaction, 5));
+    recoit(STATUT_S | STATUT_DA, 0);
+    recoit(STATUT_P, 0);
+    verifieEgalite("I2CPA06", erreursPec, erreurs);
+
+    ecritAvecPec(REGISTRE_PEC, 0, 1);
+    verifieEgalite("I2CPA07", pec, 0);
+}
+
+static void mesure_le_cout_du_pec() {
+    unsigned int cycles;
+
+    i2cEcritRegistre(REGISTRE_PEC, 1);
+    i2cDebutLecture(ADRESSE_LOCALE_REGISTRES, LECTURE_REGISTRES);
+    chronometreDemarre();
+    i2cOctetPourEmission(ADRESSE_LOCALE_REGISTRES, 0);
+    cycles = chronometreLit();
+    verifieCycles("I2CCY03", cycles, I2C_CYCLES_MAXIMUM + I2C_PEC_CYCLES_MAXIMUM);
+    i2cFinTransaction();
+    i2cEcritRegistre(REGISTRE_PEC, 0);
+}
+
+void testI2c() {
+    lit_les_registres_successifs();
+    lit_une_heure_coherente();
+    lit_les_flux();
+    mesure_le_cout_de_l_emission();
+    calcule_le_pec_smbus();
+    ajoute_le_pec_apres_un_mot();
+    ajoute_le_pec_apres_une_valeur();
+    verifie_le_pec_des_ecritures();
+    mesure_le_cout_du_pec();
+    lit_un_registre_apres_un_start_repete();
+    lit_un_mot_avec_pec_apres_un_start_repete();
+    signale_la_fin_d_une_lecture_en_rafale();
+}
+
+#endif
@@ -1,24 +1,176 @@
 #ifndef I2C__H
 #define I2C__H
 
-#define  I2C_MASQUE_ADRESSES_LOCALES 0b00000011
-#define I2C_MASQUE_ADRESSES_ESCLAVES 0b11111000
+#define  I2C_MASQUE_ADRESSES_LOCALES 0b00000111
+#define I2C_MASQUE_ADRESSES_ESCLAVES 0b11110000
 
 typedef enum {
-    LECTURE_ALIMENTATION  = 0b00011000,
-    LECTURE_BOOST         = 0b00011001,
-    LECTURE_ACCUMULATEUR  = 0b00011010,
-    LECTURE_ERREUR        = 0b00011011
+    REGISTRES             = 0b00011000,
+    LECTURE_JOURNAL       = 0b00011001,
+    LECTURE_PROFILAGE     = 0b00011010,
+    LECTURE_CAPTURE       = 0b00011011,
+    LECTURE_ALIMENTATION  = 0b00011100,
+    LECTURE_BOOST         = 0b00011101,
+    LECTURE_ACCUMULATEUR  = 0b00011110,
+    LECTURE_ERREUR        = 0b00011111
 } I2cAdresse;
 
+/**
+ * Registres accessibles à l'adresse REGISTRES.
+ * Le premier octet écrit par le maître établit le numéro de registre,
+ * puis chaque octet lu fait avancer le numéro de registre.
+ * Les valeurs de 16 bits sont exposées octet le moins signifiant en premier.
+ */
+typedef enum {
+    /** État de charge de l'accumulateur, en pourcent. */
+    REGISTRE_ETAT_CHARGE = 0,
+    /** Charge restante dans l'accumulateur, en mAh (16 bits). */
+    REGISTRE_CHARGE_RESTANTE = 1,
+    /** Courant moyen de l'accumulateur, en mA, négatif en décharge (16 bits). */
+    REGISTRE_COURANT_MOYEN = 3,
+    /** Temps avant que l'accumulateur soit vide, en minutes (16 bits). */
+    REGISTRE_MINUTES_AVANT_DECHARGE = 5,
+    /** Temps avant que l'accumulateur soit plein, en minutes (16 bits). */
+    REGISTRE_MINUTES_AVANT_CHARGE = 7,
+    /** Résistance interne de l'accumulateur, en mΩ (16 bits). */
+    REGISTRE_RESISTANCE_INTERNE = 9,
+    /** Santé de l'accumulateur, en pourcent, ou 255 si inconnue. */
+    REGISTRE_SANTE = 11,
+    /** 
+     * Écriture: le raspberry s'arrête, couper l'alimentation dans le nombre 
+     * de secondes indiqué (0 annule). Lecture: secondes restantes. 
+     */
+    REGISTRE_ARRET_ANNONCE = 12,
+    /** Politique si l'alimentation revient pendant un arrêt annoncé. */
+    REGISTRE_POLITIQUE_RETOUR = 13,
+    /** Calibration proposée (14 octets, voir Calibration). */
+    REGISTRE_CALIBRATION = 14,
+    /** 
+     * Écriture: commande de calibration (voir CalibrationCommande). 
+     * Lecture: état de la calibration (voir CalibrationEtat).
+     */
+    REGISTRE_CALIBRATION_COMMANDE = 28,
+    /** Tension de l'alimentation, en mV (16 bits). */
+    REGISTRE_MILLIVOLTS_ALIMENTATION = 29,
+    /** Tension de sortie du convertisseur Boost, en mV (16 bits). */
+    REGISTRE_MILLIVOLTS_BOOST = 31,
+    /** Tension de l'accumulateur, en mV (16 bits). */
+    REGISTRE_MILLIVOLTS_ACCUMULATEUR = 33,
+    /** Tension d'alimentation du micro-contrôleur, en mV (16 bits). */
+    REGISTRE_MILLIVOLTS_VDD = 35,
+    /** Température de l'accumulateur, en °C (signé). */
+    REGISTRE_TEMPERATURE = 37,
+    /** 1 si la charge est suspendue à cause de la température. */
+    REGISTRE_CHARGE_SUSPENDUE = 38,
+    /** Raison de la fin de la dernière charge (voir ChargeFin, profils -ΔV). */
+    REGISTRE_FIN_CHARGE = 39,
+    /** Nombre de fois où l'accumulateur est devenu disponible (16 bits). */
+    REGISTRE_TRANSITIONS_DISPONIBLE = 40,
+    /** Nombre de charges commencées (16 bits). */
+    REGISTRE_TRANSITIONS_CHARGE = 42,
+    /** Nombre de sollicitations de l'accumulateur (16 bits). */
+    REGISTRE_TRANSITIONS_SOLLICITATION = 44,
+    /** Nombre d'isolations de l'accumulateur (16 bits). */
+    REGISTRE_TRANSITIONS_ISOLATION = 46,
+    /** Mode PEC: 1 pour l'activer, 0 pour le désactiver (voir i2cPec). */
+    REGISTRE_PEC = 48,
+    /** Nombre d'écritures rejetées car leur PEC est faux ou absent (16 bits). */
+    REGISTRE_ERREURS_PEC = 49,
+    /** Nombre de débordements de réception (16 bits). */
+    REGISTRE_ERREURS_BUS = 51,
+    /** 
+     * Écrire DEMARREUR_DEMANDE pour redémarrer dans le démarreur et 
+     * recevoir une nouvelle version du micrologiciel (voir demarreur.h).
+     */
+    REGISTRE_MISE_A_JOUR = 53,
+    /** 
+     * Heure, en secondes (32 bits, voir horloge.h). L'écriture prend effet
+     * à l'octet le plus signifiant. Une lecture de bloc rend une heure 
+     * exacte (voir I2C_PREMIER_REGISTRE_FIGE).
+     */
+    REGISTRE_HORLOGE = 54,
+    /** 
+     * Heure du réveil du raspberry, en secondes (32 bits), ou 0. Le 
+     * réveil est annulé lorsqu'il sonne.
+     */
+    REGISTRE_REVEIL = 58,
+    /** Durée corrigée d'une période de sommeil, en ms (16 bits). */
+    REGISTRE_PERIODE_VEILLE = 62,
+    /**
+     * Compteurs cumulés (voir compteurs.h), lisibles en une seule lecture
+     * de bloc de 20 octets. Secondes avec l'alimentation présente (32 bits).
+     */
+    REGISTRE_SECONDES_SECTEUR = 64,
+    /** Secondes à alimenter le raspberry depuis l'accumulateur (32 bits). */
+    REGISTRE_SECONDES_ACCUMULATEUR = 68,
+    /** Secondes de charge de l'accumulateur (32 bits). */
+    REGISTRE_SECONDES_CHARGE = 72,
+    /** Charge fournie par l'accumulateur, en mAh (32 bits). */
+    REGISTRE_MAH_FOURNIS = 76,
+    /** Nombre de défaillances de l'alimentation (16 bits). */
+    REGISTRE_DEFAILLANCES = 80,
+    /** Nombre de cycles de charge équivalents (16 bits). */
+    REGISTRE_CYCLES = 82,
+    /** 
+     * 1 si la thermistance est absente ou défaillante: la température 
+     * vaut alors -128, et la charge n'est pas suspendue.
+     */
+    REGISTRE_SONDE_DEFAILLANTE = 84,
+    I2C_NOMBRE_REGISTRES = 85
+} I2cRegistre;
+
+/**
+ * Les registres de l'horloge et des compteurs sont copiés au début de
+ * chaque lecture de l'adresse REGISTRES, et la lecture est servie depuis
+ * cette copie: les valeurs de 32 bits lues dans une même lecture de
+ * bloc ne sont jamais déchirées par une mise à jour.
+ */
+#define I2C_PREMIER_REGISTRE_FIGE REGISTRE_HORLOGE
+#define I2C_NOMBRE_REGISTRES_FIGES (REGISTRE_SONDE_DEFAILLANTE - REGISTRE_HORLOGE)
+
+/**
+ * Mode PEC (SMBus Packet Error Code, CRC-8 de toute la transaction, 
+ * adresses comprises). Désactivé à la mise sous tension.
+ * En lecture, le PEC suit les données:
+ * - Aux adresses LECTURE_ALIMENTATION à LECTURE_ERREUR: 1 octet puis le
+ *   PEC (SMBus Receive Byte).
+ * - À l'adresse REGISTRES: 2 registres puis le PEC (SMBus Read Word).
+ *   Chaque Read Word copie à nouveau les registres figés: une valeur de
+ *   32 bits est lue en deux mots, à relire jusqu'à ce que le mot de
+ *   poids fort soit stable (voir raspberry/upsd.c).
+ * - Les flux (journal, profilage, capture) n'ont pas de PEC.
+ * En écriture, chaque valeur doit être suivie de son PEC (SMBus Write 
+ * Byte): sinon elle est ignorée et comptée dans REGISTRE_ERREURS_PEC.
+ * i2cPec calcule le PEC, octet par octet.
+ */
+unsigned char i2cPec(unsigned char crc, unsigned char octet);
+
+/**
+ * Coût maximum de la préparation d'un octet à émettre, en cycles 
+ * d'instruction. Estimation à confirmer sur la cible.
+ */
+#define I2C_CYCLES_MAXIMUM 60
+
+/**
+ * Coût supplémentaire du PEC par octet émis, en cycles d'instruction.
+ */
+#define I2C_PEC_CYCLES_MAXIMUM 20
+
 typedef struct {
     I2cAdresse adresse;
     unsigned char valeur;
 } I2cCommande;
 
 typedef void (*I2cRappelCommande)(unsigned char, unsigned char);
+typedef unsigned char (*I2cRappelFlux)(unsigned char);
+typedef void (*I2cRappelFinFlux)(void);
 void i2cRappelCommande(I2cRappelCommande r);
+void i2cRappelRegistre(I2cRappelCommande r);
 void i2cExposeValeur(unsigned char adresse, unsigned char valeur);
+void i2cExposeRegistre(unsigned char registre, unsigned char valeur);
+void i2cExposeRegistre16(unsigned char registre, unsigned int valeur);
+void i2cExposeFlux(unsigned char adresse, I2cRappelFlux flux);
+void i2cExposeFinFlux(unsigned char adresse, I2cRappelFinFlux fin);
 void i2cPrepareCommandePourEmission(I2cAdresse adresse, unsigned char valeur);
 unsigned char i2cDonneesDisponiblesPourEmission();
 unsigned char i2cRecupereCaracterePourEmission();
@@ -0,0 +1,634 @@
+#include "jauge.h"
+#include "i2c.h"
+#include "test.h"
+
+/** Charge de l'accumulateur plein, en mA·s. */
+#define CHARGE_MAXIMALE (JAUGE_CAPACITE_MAH * 3600UL)
+
+/** Charge correspondant à 1% de l'accumulateur, en mA·s. */
+#define CHARGE_POURCENT (CHARGE_MAXIMALE / 100)
+
+/** Baisse minimum de la charge selon la tension, pour estimer le courant. */
+#define CHARGE_PENTE_MINIMUM (JAUGE_PENTE_MINIMUM_POURCENT * CHARGE_POURCENT)
+
+/** Courant de décharge maximum accepté de l'estimation, en mA. */
+#define COURANT_DECHARGE_MAXIMUM (2 * JAUGE_COURANT_DECHARGE_MA)
+
+/**
+ * Point de la courbe de tension à vide en fonction de l'état de charge.
+ */
+typedef struct {
+    /** Tension à vide, numérisée sur 8 bits après le diviseur 1/2. */
+    unsigned char tension;
+    /** État de charge correspondant, en pourcent. */
+    unsigned char pourcent;
+} PointTensionAVide;
+
+/**
+ * Courbe de tension à vide de l'accumulateur, selon le profil.
+ */
+static const PointTensionAVide courbeTensionAVide[] = PROFIL_COURBE_TENSION_A_VIDE;
+
+#define NOMBRE_POINTS_TENSION_A_VIDE (sizeof(courbeTensionAVide) / sizeof(PointTensionAVide))
+
+/** Dernière tension mesurée de l'accumulateur. */
+static unsigned char vAccumulateur = 0;
+
+/** Charge estimée de l'accumulateur, en mA·s. */
+static unsigned long charge = 0;
+
+/** Indique si la charge a été établie depuis l'initialisation. */
+static unsigned char chargeEtablie = 0;
+
+/** Dernier état de charge calculé, en pourcent. */
+static unsigned char etatCharge = 0;
+
+/** Dernière charge restante calculée, en mAh. */
+static unsigned int chargeRestante = 0;
+
+/** Charge lors de la seconde précédente, en mA·s. */
+static unsigned long chargePrecedente = 0;
+
+/** 
+ * Courant moyen, en 1/256 de mA. Positif lorsque l'accumulateur se
+ * charge, négatif lorsqu'il se décharge.
+ */
+static long courantFiltre = 0;
+
+/**
+ * Courant moyen arrondi, en mA.
+ */
+static int courantMoyen = 0;
+
+/** Courant estimé de la décharge, en mA. Gardé d'une décharge à l'autre. */
+static unsigned int courantDecharge = JAUGE_COURANT_DECHARGE_MA;
+
+/** Somme et nombre des tensions de la fenêtre en cours. */
+static unsigned long sommeTensions = 0;
+static unsigned int nombreTensions = 0;
+
+/**
+ * Vaut 255 pendant jaugeSeconde, qui est interruptible: la charge, les
+ * prédictions et la fenêtre changent, et jaugeMesureAccumulateur ne
+ * doit pas y toucher.
+ */
+static volatile unsigned char calculEnCours = 0;
+
+/** Secondes écoulées dans la fenêtre en cours. */
+static unsigned char secondesFenetre = 0;
+
+/** Charge au début de la décharge, en mA·s. */
+static unsigned long chargeReference = 0;
+
+/**
+ * Chute de tension sous charge, due à la résistance interne: écart entre
+ * la tension à vide au début de la décharge et la moyenne de la première
+ * fenêtre, en 1/256 de pas de conversion.
+ */
+static unsigned int chuteTension = 0;
+
+/** Indique si la première fenêtre de la décharge est terminée. */
+static unsigned char referenceEtablie = 0;
+
+/** Secondes écoulées depuis la fin de la première fenêtre. */
+static unsigned int secondesDepuisReference = 0;
+
+/**
+ * Prédiction d'une durée en minutes, ajustée d'une minute à chaque
+ * échantillon, dans l'interruption, pour éviter les divisions.
+ */
+typedef struct {
+    /** Durée prédite, en minutes. */
+    unsigned int minutes;
+    /** Charge échangée pendant la durée prédite, en mA·s. */
+    unsigned long charge;
+    /** Charge échangée par minute au courant moyen, en mA·s. */
+    unsigned long chargeParMinute;
+} Prediction;
+
+/** Prédiction du temps avant que l'accumulateur soit vide. */
+static Prediction avantDecharge;
+
+/** Prédiction du temps avant que l'accumulateur soit plein. */
+static Prediction avantCharge;
+
+/**
+ * Réinitialise une prédiction.
+ * @param prediction La prédiction.
+ */
+static void predictionInitialise(Prediction *prediction) {
+    prediction->minutes = JAUGE_DUREE_INCONNUE;
+    prediction->charge = 0;
+    prediction->chargeParMinute = 0;
+}
+
+void jaugeInitialise() {
+    vAccumulateur = 0;
+    charge = 0;
+    chargeEtablie = 0;
+    etatCharge = 0;
+    chargeRestante = 0;
+    chargePrecedente = 0;
+    courantFiltre = 0;
+    courantMoyen = 0;
+    courantDecharge = JAUGE_COURANT_DECHARGE_MA;
+    sommeTensions = 0;
+    nombreTensions = 0;
+    secondesFenetre = 0;
+    referenceEtablie = 0;
+    calculEnCours = 0;
+    predictionInitialise(&avantDecharge);
+    predictionInitialise(&avantCharge);
+}
+
+/**
+ * Estime l'état de charge à partir de la tension à vide, en interpolant
+ * linéairement la courbe de décharge.
+ * @param v Tension de l'accumulateur.
+ * @return L'état de charge, en pourcent.
+ */
+static unsigned char etatChargeSelonTension(unsigned char v) {
+    unsigned char n;
+    const PointTensionAVide *a, *b;
+
+    if (v <= courbeTensionAVide[0].tension) {
+        return courbeTensionAVide[0].pourcent;
+    }
+    for (n = 1; n < NOMBRE_POINTS_TENSION_A_VIDE; n++) {
+        b = &courbeTensionAVide[n];
+        if (v <= b->tension) {
+            a = &courbeTensionAVide[n - 1];
+            return a->pourcent + 
+                    ((v - a->tension) * (b->pourcent - a->pourcent)) / (b->tension - a->tension);
+        }
+    }
+    return 100;
+}
+
+/**
+ * Estime la charge à partir d'une tension moyenne, plus finement que
+ * etatChargeSelonTension.
+ * @param t Tension de l'accumulateur, en 1/256 de pas de conversion.
+ * @return La charge, en mA·s.
+ */
+static unsigned long chargeSelonTension(unsigned int t) {
+    unsigned char n;
+    const PointTensionAVide *a, *b;
+    unsigned long pourcent;
+
+    if (t <= (unsigned int) courbeTensionAVide[0].tension << 8) {
+        return courbeTensionAVide[0].pourcent * CHARGE_POURCENT;
+    }
+    for (n = 1; n < NOMBRE_POINTS_TENSION_A_VIDE; n++) {
+        b = &courbeTensionAVide[n];
+        if (t <= (unsigned int) b->tension << 8) {
+            a = &courbeTensionAVide[n - 1];
+            // En 1/256 de pourcent:
+            pourcent = ((unsigned long) a->pourcent << 8)
+                    + ((unsigned long) (t - ((unsigned int) a->tension << 8)) * (b->pourcent - a->pourcent))
+                    / (b->tension - a->tension);
+            return (pourcent * CHARGE_POURCENT) >> 8;
+        }
+    }
+    return CHARGE_MAXIMALE;
+}
+
+/**
+ * Inverse de chargeSelonTension.
+ * @param c La charge, en mA·s.
+ * @return La tension à vide, en 1/256 de pas de conversion.
+ */
+static unsigned int tensionSelonCharge(unsigned long c) {
+    unsigned char n;
+    const PointTensionAVide *a, *b;
+    unsigned int pourcent;
+
+    // En 1/256 de pourcent:
+    pourcent = (unsigned int) ((c << 8) / CHARGE_POURCENT);
+    if (pourcent <= (unsigned int) courbeTensionAVide[0].pourcent << 8) {
+        return (unsigned int) courbeTensionAVide[0].tension << 8;
+    }
+    for (n = 1; n < NOMBRE_POINTS_TENSION_A_VIDE; n++) {
+        b = &courbeTensionAVide[n];
+        if (pourcent <= (unsigned int) b->pourcent << 8) {
+            a = &courbeTensionAVide[n - 1];
+            return ((unsigned int) a->tension << 8)
+                    + (unsigned int) (((unsigned long) (pourcent - ((unsigned int) a->pourcent << 8))
+                        * (b->tension - a->tension)) / (b->pourcent - a->pourcent));
+        }
+    }
+    return (unsigned int) courbeTensionAVide[NOMBRE_POINTS_TENSION_A_VIDE - 1].tension << 8;
+}
+
+/**
+ * Recommence la moyenne de la tension.
+ */
+static void fenetreInitialise() {
+    sommeTensions = 0;
+    nombreTensions = 0;
+    secondesFenetre = 0;
+}
+
+/**
+ * Termine une seconde de décharge. La première fenêtre mesure la chute de
+ * tension sous charge, par rapport à la tension à vide correspondant à la
+ * charge au début de la décharge. À la fin de chaque fenêtre suivante,
+ * la tension moyenne, chute comprise, donne la charge selon la courbe de
+ * tension à vide: le courant de décharge est estimé à partir de sa
+ * baisse, si elle est suffisante pour être mesurée.
+ */
+static void estimeCourantDecharge() {
+    unsigned long chargeSousCharge;
+    unsigned long courant;
+    unsigned int moyenne, tensionAVide;
+
+    if (!referenceEtablie && (secondesFenetre == 0)) {
+        chargeReference = charge;
+    }
+    if (secondesDepuisReference < 0xFFFF) {
+        secondesDepuisReference++;
+    }
+    if (++secondesFenetre < JAUGE_FENETRE_SECONDES) {
+        return;
+    }
+    if (nombreTensions == 0) {
+        fenetreInitialise();
+        return;
+    }
+    moyenne = (unsigned int) ((sommeTensions << 8) / nombreTensions);
+    fenetreInitialise();
+
+    if (!referenceEtablie) {
+        tensionAVide = tensionSelonCharge(chargeReference);
+        chuteTension = tensionAVide > moyenne ? tensionAVide - moyenne : 0;
+        secondesDepuisReference = 0;
+        referenceEtablie = 255;
+        return;
+    }
+    chargeSousCharge = chargeSelonTension(moyenne + chuteTension);
+    if (chargeReference >= chargeSousCharge + CHARGE_PENTE_MINIMUM) {
+        courant = (chargeReference - chargeSousCharge) / secondesDepuisReference;
+        if (courant < JAUGE_COURANT_MINIMUM_MA) {
+            courant = JAUGE_COURANT_MINIMUM_MA;
+        } else if (courant > COURANT_DECHARGE_MAXIMUM) {
+            courant = COURANT_DECHARGE_MAXIMUM;
+        }
+        courantDecharge = (unsigned int) courant;
+    }
+}
+
+/**
+ * Établit le courant de la prédiction. La seule multiplication est
+ * faite ici, une fois par seconde.
+ * @param prediction La prédiction.
+ * @param courant Le courant, en mA, ou 0 si il ne va pas dans le sens
+ * de la prédiction.
+ */
+static void predictionEtablitCourant(Prediction *prediction, unsigned int courant) {
+    if (courant < JAUGE_COURANT_MINIMUM_MA) {
+        predictionInitialise(prediction);
+    } else {
+        if (prediction->minutes == JAUGE_DUREE_INCONNUE) {
+            prediction->minutes = 0;
+        }
+        prediction->chargeParMinute = courant * 60UL;
+        prediction->charge = prediction->minutes * prediction->chargeParMinute;
+    }
+}
+
+/**
+ * Rapproche la prédiction d'une minute de la charge à échanger.
+ * Ne fait que des additions et des comparaisons.
+ * @param prediction La prédiction.
+ * @param reserve La charge à échanger, en mA·s.
+ */
+static void predictionAjuste(Prediction *prediction, unsigned long reserve) {
+    if (prediction->minutes == JAUGE_DUREE_INCONNUE) {
+        return;
+    }
+    if (prediction->charge > reserve) {
+        if (prediction->minutes > 0) {
+            prediction->minutes--;
+            prediction->charge -= prediction->chargeParMinute;
+        }
+    } else if (prediction->charge + prediction->chargeParMinute <= reserve) {
+        if (prediction->minutes < JAUGE_DUREE_INCONNUE - 1) {
+            prediction->minutes++;
+            prediction->charge += prediction->chargeParMinute;
+        }
+    }
+}
+
+void jaugeMesureAccumulateur(unsigned char v) {
+    vAccumulateur = v;
+    if (calculEnCours) {
+        return;
+    }
+    sommeTensions += v;
+    nombreTensions++;
+
+    predictionAjuste(&avantDecharge, charge);
+    predictionAjuste(&avantCharge, CHARGE_MAXIMALE - charge);
+    i2cExposeRegistre16(REGISTRE_MINUTES_AVANT_DECHARGE, avantDecharge.minutes);
+    i2cExposeRegistre16(REGISTRE_MINUTES_AVANT_CHARGE, avantCharge.minutes);
+}
+
+void jaugeSeconde(Energie *energie) {
+    unsigned long chargeAVide;
+
+    calculEnCours = 255;
+
+    // Établit la charge initiale à partir de la tension à vide:
+    if (!chargeEtablie) {
+        charge = etatChargeSelonTension(vAccumulateur) * CHARGE_POURCENT;
+        chargePrecedente = charge;
+        chargeEtablie = 255;
+    }
+    // Décharge:
+    else if (energie->solliciterAccumulateur) {
+        estimeCourantDecharge();
+        if (charge > courantDecharge) {
+            charge -= courantDecharge;
+        } else {
+            charge = 0;
+        }
+    }
+    // Charge:
+    else if (energie->chargerAccumulateur) {
+        charge += JAUGE_COURANT_CHARGE_MA;
+        if (charge > CHARGE_MAXIMALE) {
+            charge = CHARGE_MAXIMALE;
+        }
+    }
+    // Au repos, la tension à vide est fiable; la charge converge 
+    // lentement vers elle pour compenser la dérive de l'intégration:
+    else if (energie->accumulateurDisponible) {
+        chargeAVide = etatChargeSelonTension(vAccumulateur) * CHARGE_POURCENT;
+        if (chargeAVide > charge) {
+            charge += (chargeAVide - charge) >> 6;
+        } else {
+            charge -= (charge - chargeAVide) >> 6;
+        }
+    }
+    // L'accumulateur est absent: il faudra rétablir sa charge.
+    else {
+        charge = 0;
+        chargeEtablie = 0;
+    }
+
+    // La pente de la tension se mesure sur une décharge ininterrompue:
+    if (!energie->solliciterAccumulateur) {
+        fenetreInitialise();
+        referenceEtablie = 0;
+    }
+
+    // Lisse le courant, qui est la variation de charge en une seconde:
+    if (chargeEtablie) {
+        courantFiltre += (((long) charge - (long) chargePrecedente) * 256 - courantFiltre) >> 4;
+    } else {
+        courantFiltre = 0;
+    }
+    courantMoyen = (int) ((courantFiltre + 128) >> 8);
+    chargePrecedente = charge;
+    if (courantMoyen < 0) {
+        predictionEtablitCourant(&avantDecharge, (unsigned int) -courantMoyen);
+        predictionEtablitCourant(&avantCharge, 0);
+    } else {
+        predictionEtablitCourant(&avantDecharge, 0);
+        predictionEtablitCourant(&avantCharge, (unsigned int) courantMoyen);
+    }
+
+    calculEnCours = 0;
+
+    etatCharge = (unsigned char) (charge / CHARGE_POURCENT);
+    chargeRestante = (unsigned int) (charge / 3600);
+    i2cExposeRegistre(REGISTRE_ETAT_CHARGE, etatCharge);
+    i2cExposeRegistre16(REGISTRE_CHARGE_RESTANTE, chargeRestante);
+    i2cExposeRegistre16(REGISTRE_COURANT_MOYEN, (unsigned int) courantMoyen);
+}
+
+unsigned char jaugeEtatCharge() {
+    return etatCharge;
+}
+
+unsigned int jaugeChargeRestante() {
+    return chargeRestante;
+}
+
+int jaugeCourantMoyen() {
+    return courantMoyen;
+}
+
+unsigned int jaugeCourantDecharge() {
+    return courantDecharge;
+}
+
+unsigned int jaugeMinutesAvantDecharge() {
+    return avantDecharge.minutes;
+}
+
+unsigned int jaugeMinutesAvantCharge() {
+    return avantCharge.minutes;
+}
+
+#ifdef TEST
+
+static Energie auRepos = {1, 0, 0, 0};
+static Energie enCharge = {0, 1, 0, 0};
+static Energie enDecharge = {1, 0, 1, 0};
+
+/** Points de la courbe de tension à vide du profil. */
+#define POINT_VIDE (courbeTensionAVide[0])
+#define POINT_PLEIN (courbeTensionAVide[NOMBRE_POINTS_TENSION_A_VIDE - 1])
+#define POINT_PLATEAU (courbeTensionAVide[4])
+
+/** Tension à mi-chemin entre deux points de la courbe, et sa charge. */
+#define TENSION_INTERPOLEE ((courbeTensionAVide[3].tension + courbeTensionAVide[4].tension) / 2)
+#define POURCENT_INTERPOLE (courbeTensionAVide[3].pourcent \
+    + ((TENSION_INTERPOLEE - courbeTensionAVide[3].tension) \
+        * (courbeTensionAVide[4].pourcent - courbeTensionAVide[3].pourcent)) \
+    / (courbeTensionAVide[4].tension - courbeTensionAVide[3].tension))
+
+static void secondes(Energie *energie, unsigned int n) {
+    while (n-- > 0) {
+        jaugeSeconde(energie);
+    }
+}
+
+static void echantillons(unsigned char v, unsigned int n) {
+    while (n-- > 0) {
+        jaugeMesureAccumulateur(v);
+    }
+}
+
+static void etablit_la_charge_selon_la_tension_a_vide() {
+    jaugeInitialise();
+    jaugeMesureAccumulateur(POINT_PLEIN.tension);
+    jaugeSeconde(&auRepos);
+    verifieEgalite("JGOCV01", jaugeEtatCharge(), 100);
+    verifieEgalite("JGOCV02", jaugeChargeRestante(), JAUGE_CAPACITE_MAH);
+
+    jaugeInitialise();
+    jaugeMesureAccumulateur(TENSION_INTERPOLEE);
+    jaugeSeconde(&auRepos);
+    verifieEgalite("JGOCV03", jaugeEtatCharge(), POURCENT_INTERPOLE);
+
+    jaugeInitialise();
+    jaugeMesureAccumulateur(60);
+    jaugeSeconde(&auRepos);
+    verifieEgalite("JGOCV04", jaugeEtatCharge(), 0);
+}
+
+static void integre_le_courant_de_decharge() {
+    jaugeInitialise();
+    jaugeMesureAccumulateur(POINT_PLEIN.tension);
+    jaugeSeconde(&auRepos);
+    
+    // La tension sous charge ne perturbe pas l'intégration:
+    jaugeMesureAccumulateur(POINT_PLATEAU.tension);
+    secondes(&enDecharge, 60);
+    verifieEgalite("JGDEC01", jaugeChargeRestante(), 
+            JAUGE_CAPACITE_MAH - (JAUGE_COURANT_DECHARGE_MA * 60UL) / 3600);
+
+    secondes(&enDecharge, 10000);
+    verifieEgalite("JGDEC02", jaugeChargeRestante(), 0);
+    verifieEgalite("JGDEC03", jaugeEtatCharge(), 0);
+}
+
+static void integre_le_courant_de_charge_sans_depasser_la_capacite() {
+    jaugeInitialise();
+    jaugeMesureAccumulateur(POINT_VIDE.tension);
+    jaugeSeconde(&auRepos);
+    secondes(&enCharge, 3600);
+    verifieEgalite("JGCHA01", jaugeChargeRestante(), JAUGE_COURANT_CHARGE_MA);
+
+    secondes(&enCharge, 30000);
+    verifieEgalite("JGCHA02", jaugeEtatCharge(), 100);
+}
+
+static void converge_vers_la_tension_a_vide_au_repos() {
+    jaugeInitialise();
+    jaugeMesureAccumulateur(POINT_PLEIN.tension);
+    jaugeSeconde(&auRepos);
+    jaugeMesureAccumulateur(POINT_PLATEAU.tension);
+    secondes(&auRepos, 1000);
+    verifieEgalite("JGREP01", jaugeEtatCharge(), POINT_PLATEAU.pourcent);
+}
+
+/** Minutes restantes après n secondes de décharge depuis la pleine charge. */
+#define MINUTES_AVANT_DECHARGE(n) \
+    ((CHARGE_MAXIMALE - JAUGE_COURANT_DECHARGE_MA * (n##UL)) / (JAUGE_COURANT_DECHARGE_MA * 60UL))
+
+/** Minutes manquantes après n secondes de charge depuis le vide. */
+#define MINUTES_AVANT_CHARGE(n) \
+    ((CHARGE_MAXIMALE - JAUGE_COURANT_CHARGE_MA * (n##UL)) / (JAUGE_COURANT_CHARGE_MA * 60UL))
+
+static void predit_le_temps_avant_decharge() {
+    jaugeInitialise();
+    jaugeMesureAccumulateur(POINT_PLEIN.tension);
+    jaugeSeconde(&auRepos);
+    verifieEgalite("JGTTE01", jaugeMinutesAvantDecharge(), JAUGE_DUREE_INCONNUE);
+
+    // 200 secondes à 1800mA: avec 2600mAh, il reste 2500mAh, soit 83 minutes.
+    secondes(&enDecharge, 200);
+    verifieEgalite("JGTTE02", jaugeCourantMoyen(), -JAUGE_COURANT_DECHARGE_MA);
+    echantillons(POINT_PLATEAU.tension, 200);
+    verifieEgalite("JGTTE03", jaugeMinutesAvantDecharge(), MINUTES_AVANT_DECHARGE(200));
+    verifieEgalite("JGTTE04", jaugeMinutesAvantCharge(), JAUGE_DUREE_INCONNUE);
+
+    // La prédiction suit la décharge, d'une minute par échantillon:
+    secondes(&enDecharge, 600);
+    echantillons(POINT_PLATEAU.tension, 1);
+    verifieEgalite("JGTTE05", jaugeMinutesAvantDecharge(), MINUTES_AVANT_DECHARGE(200) - 1);
+    echantillons(POINT_PLATEAU.tension, 20);
+    verifieEgalite("JGTTE06", jaugeMinutesAvantDecharge(), MINUTES_AVANT_DECHARGE(800));
+}
+
+static void predit_le_temps_avant_charge() {
+    jaugeInitialise();
+    jaugeMesureAccumulateur(POINT_VIDE.tension);
+    jaugeSeconde(&auRepos);
+
+    // 200 secondes à 500mA: avec 2600mAh, il manque 2573mAh, soit 308 minutes.
+    secondes(&enCharge, 200);
+    echantillons(80, 400);
+    verifieEgalite("JGTTF01", jaugeMinutesAvantCharge(), MINUTES_AVANT_CHARGE(200));
+    verifieEgalite("JGTTF02", jaugeMinutesAvantDecharge(), JAUGE_DUREE_INCONNUE);
+}
+
+/** Courant de la décharge simulée par la baisse de la tension, en mA. */
+#define COURANT_PENTE_MA 1000
+
+/** Chute de tension simulée sous charge, en pas de conversion. */
+#define CHUTE_PENTE 1
+
+/** Conversions simulées par seconde. */
+#define CONVERSIONS_PAR_SECONDE 400
+
+/** Secondes pour passer de courbe[4] à courbe[3] à COURANT_PENTE_MA. */
+#define SECONDES_PENTE ((courbeTensionAVide[4].pourcent - courbeTensionAVide[3].pourcent) \
+    * CHARGE_POURCENT / COURANT_PENTE_MA)
+
+/**
+ * Simule des secondes de décharge, pendant lesquelles la tension à vide
+ * baisse linéairement de courbe[4] vers courbe[3], moins la chute sous
+ * charge. Chaque seconde, la moyenne des conversions est exacte:
+ * la somme de (t + n) / 400 pour n de 0 à 399 vaut t.
+ * @param debut Première seconde depuis le début de la décharge.
+ * @param n Nombre de secondes.
+ */
+static void penteSousCharge(unsigned long debut, unsigned int n) {
+    unsigned long t;
+    unsigned int c;
+
+    while (n-- > 0) {
+        t = (courbeTensionAVide[4].tension - CHUTE_PENTE) * (unsigned long) CONVERSIONS_PAR_SECONDE
+                - ((courbeTensionAVide[4].tension - courbeTensionAVide[3].tension)
+                    * (unsigned long) CONVERSIONS_PAR_SECONDE * debut) / SECONDES_PENTE;
+        for (c = 0; c < CONVERSIONS_PAR_SECONDE; c++) {
+            jaugeMesureAccumulateur((unsigned char) ((t + c) / CONVERSIONS_PAR_SECONDE));
+        }
+        jaugeSeconde(&enDecharge);
+        debut++;
+    }
+}
+
+/** Écart absolu entre deux courants. */
+#define ECART(a, b) ((a) > (b) ? (a) - (b) : (b) - (a))
+
+static void estime_le_courant_selon_la_pente_de_la_tension() {
+    unsigned long fenetres = SECONDES_PENTE / JAUGE_FENETRE_SECONDES;
+
+    jaugeInitialise();
+    jaugeMesureAccumulateur(courbeTensionAVide[4].tension);
+    jaugeSeconde(&auRepos);
+
+    // Tant que la baisse est trop faible, le courant par défaut s'applique:
+    penteSousCharge(0, 2 * JAUGE_FENETRE_SECONDES);
+    verifieEgalite("JGPEN01", jaugeCourantDecharge(), JAUGE_COURANT_DECHARGE_MA);
+
+    // La chute sous charge ne fausse pas la pente:
+    penteSousCharge(2 * JAUGE_FENETRE_SECONDES, (unsigned int) ((fenetres - 3) * JAUGE_FENETRE_SECONDES));
+    verifieInferieur("JGPEN02", ECART(jaugeCourantDecharge(), COURANT_PENTE_MA), 10);
+
+    // Le courant moyen et les prédictions suivent l'estimation:
+    penteSousCharge((fenetres - 1) * JAUGE_FENETRE_SECONDES, JAUGE_FENETRE_SECONDES);
+    verifieInferieur("JGPEN03", ECART(jaugeCourantMoyen(), -COURANT_PENTE_MA), 20);
+
+    // L'estimation est gardée pour la décharge suivante:
+    secondes(&auRepos, 10);
+    secondes(&enDecharge, 100);
+    verifieInferieur("JGPEN04", ECART(jaugeCourantMoyen(), -COURANT_PENTE_MA), 20);
+}
+
+void testeJauge() {
+    etablit_la_charge_selon_la_tension_a_vide();
+    integre_le_courant_de_decharge();
+    integre_le_courant_de_charge_sans_depasser_la_capacite();
+    converge_vers_la_tension_a_vide_au_repos();
+    predit_le_temps_avant_decharge();
+    predit_le_temps_avant_charge();
+    estime_le_courant_selon_la_pente_de_la_tension();
+}
+
+#endif
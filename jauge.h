@@ -0,0 +1,125 @@
+#ifndef JAUGE_H
+#define	JAUGE_H
+
+#include "energie.h"
+#include "profil.h"
+
+/**
+ * Capacité nominale de l'accumulateur, en mAh, selon le profil.
+ */
+#ifndef JAUGE_CAPACITE_MAH
+#define JAUGE_CAPACITE_MAH PROFIL_CAPACITE_MAH
+#endif
+
+/**
+ * Courant estimé puisé dans l'accumulateur lorsqu'il est sollicité, en mA,
+ * tant que la pente de la tension ne permet pas de l'estimer.
+ * Le circuit n'a pas de capteur de courant: le raspberry consomme
+ * environ 700mA, que le convertisseur Boost puise sous 3.7V.
+ */
+#ifndef JAUGE_COURANT_DECHARGE_MA
+#define JAUGE_COURANT_DECHARGE_MA 1800
+#endif
+
+/**
+ * Courant estimé fourni par le chargeur à l'accumulateur, en mA,
+ * selon le profil.
+ */
+#ifndef JAUGE_COURANT_CHARGE_MA
+#define JAUGE_COURANT_CHARGE_MA PROFIL_COURANT_CHARGE_MA
+#endif
+
+/**
+ * Durée de chaque moyenne de la tension sous charge, pour estimer le
+ * courant de décharge, en secondes.
+ */
+#define JAUGE_FENETRE_SECONDES 64
+
+/**
+ * Baisse minimum de la charge selon la tension sous charge, depuis la
+ * première moyenne de la décharge, pour estimer le courant, en pourcent.
+ */
+#define JAUGE_PENTE_MINIMUM_POURCENT 10
+
+/**
+ * Courant moyen en dessous duquel il n'y a pas de prédiction de durée, en mA.
+ */
+#define JAUGE_COURANT_MINIMUM_MA 10
+
+/**
+ * Durée rendue lorsqu'elle ne peut pas être prédite.
+ */
+#define JAUGE_DUREE_INCONNUE 0xFFFF
+
+/**
+ * Initialise la jauge. L'état de charge sera établi à partir de
+ * la tension à vide lors de la prochaine seconde.
+ */
+void jaugeInitialise();
+
+/**
+ * Prend note de la tension de l'accumulateur, l'ajoute à la moyenne de
+ * la fenêtre, et ajuste d'une minute les prédictions de temps avant
+ * décharge et avant charge complète.
+ * Cette fonction ne fait aucune division ni multiplication. Pendant
+ * jaugeSeconde, qu'elle interrompt, elle ne retient que la tension.
+ * @param vAccumulateur Tension de l'accumulateur, obtenue au travers d'un 
+ * diviseur de tension 1/2, puis numérisée sur 8 bits.
+ */
+void jaugeMesureAccumulateur(unsigned char vAccumulateur);
+
+/**
+ * Intègre le courant de charge ou de décharge pendant une seconde, lisse
+ * le courant moyen, puis expose l'état de charge et la charge restante 
+ * sur les registres I2C.
+ * Le courant de décharge est estimé par la pente de la tension sous
+ * charge: la baisse de la charge correspondant à la tension moyenne de
+ * chaque fenêtre, depuis la première fenêtre de la décharge, divisée par
+ * le temps écoulé. La chute de tension due à la résistance interne se
+ * retrouve dans les deux moyennes, et s'annule. La pente suit aussi la
+ * capacité réelle: un accumulateur usé se vide plus vite.
+ * Fait les divisions de 32 bits de la jauge (état de charge, charge
+ * restante, pente): à appeler une fois par seconde depuis la boucle
+ * principale, jamais depuis l'interruption, qui peut l'interrompre.
+ * @param energie L'état actuel de l'administration d'énergie.
+ */
+void jaugeSeconde(Energie *energie);
+
+/**
+ * @return L'état de charge, en pourcent.
+ */
+unsigned char jaugeEtatCharge();
+
+/**
+ * @return La charge restante, en mAh.
+ */
+unsigned int jaugeChargeRestante();
+
+/**
+ * @return Le courant moyen, en mA. Positif pendant la charge, négatif
+ * pendant la décharge.
+ */
+int jaugeCourantMoyen();
+
+/**
+ * @return Le courant estimé de la décharge, en mA.
+ */
+unsigned int jaugeCourantDecharge();
+
+/**
+ * @return Le temps prédit avant que l'accumulateur soit vide, en minutes, 
+ * ou JAUGE_DUREE_INCONNUE si l'accumulateur ne se décharge pas.
+ */
+unsigned int jaugeMinutesAvantDecharge();
+
+/**
+ * @return Le temps prédit avant que l'accumulateur soit plein, en minutes,
+ * ou JAUGE_DUREE_INCONNUE si l'accumulateur ne se charge pas.
+ */
+unsigned int jaugeMinutesAvantCharge();
+
+#ifdef TEST
+void testeJauge();
+#endif
+
+#endif
@@ -0,0 +1,287 @@
+#include "journal.h"
+#include "eeprom.h"
+#include "test.h"
+
+/** Copie en mémoire du journal. */
+static unsigned char journal[EEPROM_JOURNAL_TAILLE];
+
+/** Position de la prochaine entrée à enregistrer. */
+static volatile unsigned char entree = 0;
+
+/** Position du prochain octet à écrire en EEPROM. */
+static volatile unsigned char ecrit = 0;
+
+/** Indique si le journal a fait le tour de l'anneau. */
+static unsigned char plein = 0;
+
+/** Numéro de séquence de la prochaine entrée. */
+static unsigned char sequence = 0;
+
+/** Horodatage, en minutes depuis la mise sous tension. */
+static unsigned int minutes = 0;
+
+/** Secondes écoulées dans la minute en cours. */
+static unsigned char secondes = 0;
+
+/** Position du prochain octet à rendre par journalLecture. */
+static unsigned char lecture = 0;
+
+/** Nombre d'octets restant à rendre par journalLecture. */
+static unsigned char restant = 0;
+
+void journalInitialise() {
+    unsigned char n;
+    
+    for (n = 0; n < EEPROM_JOURNAL_TAILLE; n++) {
+        journal[n] = eepromLit(EEPROM_JOURNAL_DEBUT + n);
+    }
+
+    // Cherche la première entrée vide, ou la rupture de séquence:
+    entree = 0;
+    plein = 255;
+    for (n = 0; n < EEPROM_JOURNAL_TAILLE; n += JOURNAL_TAILLE_ENTREE) {
+        if (journal[n + 1] == JOURNAL_VIDE) {
+            entree = n;
+            plein = 0;
+            break;
+        }
+        if ((n > 0) && (journal[n] != (unsigned char) (journal[n - JOURNAL_TAILLE_ENTREE] + 1))) {
+            entree = n;
+            break;
+        }
+    }
+
+    // Le numéro de séquence suit celui de la dernière entrée:
+    if (entree > 0) {
+        sequence = journal[entree - JOURNAL_TAILLE_ENTREE] + 1;
+    } else if (plein) {
+        sequence = journal[EEPROM_JOURNAL_TAILLE - JOURNAL_TAILLE_ENTREE] + 1;
+    } else {
+        sequence = 0;
+    }
+
+    ecrit = entree;
+    minutes = 0;
+    secondes = 0;
+    restant = 0;
+}
+
+/**
+ * @return Le nombre d'octets en attente d'écriture en EEPROM.
+ */
+static unsigned char enAttente() {
+    if (entree >= ecrit) {
+        return entree - ecrit;
+    }
+    return entree + EEPROM_JOURNAL_TAILLE - ecrit;
+}
+
+void journalEnregistre(JournalEvenement evenement) {
+    unsigned char attente = enAttente();
+
+    // L'anneau ne se remplit jamais: entree == ecrit signifie qu'il est
+    // entièrement écrit. La dernière entrée libre signale la perte:
+    if (attente + 2 * JOURNAL_TAILLE_ENTREE >= EEPROM_JOURNAL_TAILLE) {
+        if (attente + JOURNAL_TAILLE_ENTREE >= EEPROM_JOURNAL_TAILLE) {
+            return;
+        }
+        evenement = JOURNAL_EVENEMENTS_PERDUS;
+    }
+
+    journal[entree]     = sequence++;
+    journal[entree + 1] = evenement;
+    journal[entree + 2] = (unsigned char) minutes;
+    journal[entree + 3] = (unsigned char) (minutes >> 8);
+    
+    entree += JOURNAL_TAILLE_ENTREE;
+    if (entree >= EEPROM_JOURNAL_TAILLE) {
+        entree = 0;
+        plein = 255;
+    }
+}
+
+void journalSeconde() {
+    if (++secondes >= 60) {
+        secondes = 0;
+        minutes++;
+    }
+}
+
+void journalEcrit() {
+    if (ecrit != entree) {
+        if (eepromEcrit(EEPROM_JOURNAL_DEBUT + ecrit, journal[ecrit])) {
+            if (++ecrit >= EEPROM_JOURNAL_TAILLE) {
+                ecrit = 0;
+            }
+        }
+    }
+}
+
+unsigned char journalEstEcrit() {
+    if ((ecrit == entree) && !eepromOccupee()) {
+        return 255;
+    }
+    return 0;
+}
+
+unsigned char journalLecture(unsigned char premier) {
+    unsigned char valeur;
+    
+    if (premier) {
+        if (plein) {
+            lecture = entree;
+            restant = EEPROM_JOURNAL_TAILLE;
+        } else {
+            lecture = 0;
+            restant = entree;
+        }
+    }
+    if (restant == 0) {
+        return JOURNAL_VIDE;
+    }
+    valeur = journal[lecture];
+    if (++lecture >= EEPROM_JOURNAL_TAILLE) {
+        lecture = 0;
+    }
+    restant--;
+    return valeur;
+}
+
+#ifdef TEST
+
+static void ecritTout() {
+    while (!journalEstEcrit()) {
+        journalEcrit();
+    }
+}
+
+static void effaceJournal() {
+    unsigned char n;
+    for (n = 0; n < EEPROM_JOURNAL_TAILLE; n++) {
+        while (!eepromEcrit(EEPROM_JOURNAL_DEBUT + n, JOURNAL_VIDE));
+    }
+    while (eepromOccupee());
+}
+
+static void enregistre_et_relit_les_evenements() {
+    effaceJournal();
+    journalInitialise();
+    verifieEgalite("JRNEV01", journalLecture(255), JOURNAL_VIDE);
+
+    journalEnregistre(JOURNAL_MISE_SOUS_TENSION);
+    journalEnregistre(JOURNAL_DEFAILLANCE_ALIMENTATION);
+    verifieEgalite("JRNEV02", journalLecture(255), 0);
+    verifieEgalite("JRNEV03", journalLecture(0), JOURNAL_MISE_SOUS_TENSION);
+    verifieEgalite("JRNEV04", journalLecture(0), 0);
+    verifieEgalite("JRNEV05", journalLecture(0), 0);
+    verifieEgalite("JRNEV06", journalLecture(0), 1);
+    verifieEgalite("JRNEV07", journalLecture(0), JOURNAL_DEFAILLANCE_ALIMENTATION);
+    journalLecture(0);
+    journalLecture(0);
+    verifieEgalite("JRNEV08", journalLecture(0), JOURNAL_VIDE);
+}
+
+static void horodate_les_evenements_en_minutes() {
+    unsigned char n;
+    
+    effaceJournal();
+    journalInitialise();
+    for (n = 0; n < 150; n++) {
+        journalSeconde();
+    }
+    journalEnregistre(JOURNAL_RETOUR_ALIMENTATION);
+    journalLecture(255);
+    journalLecture(0);
+    verifieEgalite("JRNHO01", journalLecture(0), 2);
+    verifieEgalite("JRNHO02", journalLecture(0), 0);
+}
+
+static void retrouve_le_journal_apres_une_coupure() {
+    effaceJournal();
+    journalInitialise();
+    journalEnregistre(JOURNAL_MISE_SOUS_TENSION);
+    journalEnregistre(JOURNAL_ISOLATION_ACCUMULATEUR);
+    verifieEgalite("JRNCO01", journalEstEcrit(), 0);
+    ecritTout();
+
+    journalInitialise();
+    journalEnregistre(JOURNAL_MISE_SOUS_TENSION);
+    journalLecture(255);
+    verifieEgalite("JRNCO02", journalLecture(0), JOURNAL_MISE_SOUS_TENSION);
+    journalLecture(0);
+    journalLecture(0);
+    journalLecture(0);
+    verifieEgalite("JRNCO03", journalLecture(0), JOURNAL_ISOLATION_ACCUMULATEUR);
+    journalLecture(0);
+    journalLecture(0);
+    verifieEgalite("JRNCO04", journalLecture(0), 2);
+}
+
+static void fait_le_tour_de_l_anneau() {
+    unsigned char n;
+    
+    effaceJournal();
+    journalInitialise();
+    for (n = 0; n < JOURNAL_NOMBRE_ENTREES + 2; n++) {
+        journalEnregistre(JOURNAL_CHARGE_COMPLETE);
+        ecritTout();
+    }
+    
+    // Les deux plus anciennes entrées ont été remplacées:
+    journalInitialise();
+    verifieEgalite("JRNAN01", journalLecture(255), 2);
+    for (n = 1; n < EEPROM_JOURNAL_TAILLE - JOURNAL_TAILLE_ENTREE; n++) {
+        journalLecture(0);
+    }
+    verifieEgalite("JRNAN02", journalLecture(0), JOURNAL_NOMBRE_ENTREES + 1);
+    journalLecture(0);
+    journalLecture(0);
+    journalLecture(0);
+    verifieEgalite("JRNAN03", journalLecture(0), JOURNAL_VIDE);
+    
+    journalEnregistre(JOURNAL_CHARGE_COMPLETE);
+    verifieEgalite("JRNAN04", journalLecture(255), 3);
+}
+
+static void signale_les_evenements_perdus() {
+    unsigned char n;
+
+    effaceJournal();
+    journalInitialise();
+    for (n = 0; n < JOURNAL_NOMBRE_ENTREES + 2; n++) {
+        journalEnregistre(JOURNAL_CHARGE_COMPLETE);
+    }
+
+    // Les entrées en attente sont gardées, et la perte est signalée:
+    verifieEgalite("JRNPE01", journalLecture(255), 0);
+    verifieEgalite("JRNPE02", journalLecture(0), JOURNAL_CHARGE_COMPLETE);
+    for (n = 2; n < EEPROM_JOURNAL_TAILLE - 2 * JOURNAL_TAILLE_ENTREE; n++) {
+        journalLecture(0);
+    }
+    verifieEgalite("JRNPE03", journalLecture(0), JOURNAL_NOMBRE_ENTREES - 2);
+    verifieEgalite("JRNPE04", journalLecture(0), JOURNAL_EVENEMENTS_PERDUS);
+    journalLecture(0);
+    journalLecture(0);
+    verifieEgalite("JRNPE05", journalLecture(0), JOURNAL_VIDE);
+
+    // Une fois écrites, les entrées libèrent l'anneau:
+    ecritTout();
+    journalEnregistre(JOURNAL_REVEIL);
+    ecritTout();
+    journalInitialise();
+    journalLecture(255);
+    for (n = 1; n < EEPROM_JOURNAL_TAILLE - JOURNAL_TAILLE_ENTREE + 1; n++) {
+        journalLecture(0);
+    }
+    verifieEgalite("JRNPE06", journalLecture(0), JOURNAL_REVEIL);
+}
+
+void testeJournal() {
+    enregistre_et_relit_les_evenements();
+    horodate_les_evenements_en_minutes();
+    retrouve_le_journal_apres_une_coupure();
+    fait_le_tour_de_l_anneau();
+    signale_les_evenements_perdus();
+}
+
+#endif
@@ -0,0 +1,92 @@
+#ifndef JOURNAL_H
+#define	JOURNAL_H
+
+#include "eeprom.h"
+
+/**
+ * Taille d'une entrée du journal, en octets:
+ * - Numéro de séquence.
+ * - Événement (voir JournalEvenement).
+ * - Horodatage en minutes depuis la mise sous tension (16 bits, octet le
+ *   moins signifiant en premier).
+ * Le journal est un anneau: chaque octet de l'EEPROM est écrit une fois
+ * tous les JOURNAL_NOMBRE_ENTREES événements. La prochaine entrée à écrire
+ * est retrouvée grâce à la rupture des numéros de séquence.
+ */
+#define JOURNAL_TAILLE_ENTREE 4
+
+/** Nombre d'entrées dans le journal. */
+#define JOURNAL_NOMBRE_ENTREES (EEPROM_JOURNAL_TAILLE / JOURNAL_TAILLE_ENTREE)
+
+/**
+ * Énumère les événements enregistrés dans le journal.
+ */
+typedef enum {
+    /** Le micro-contrôleur vient d'être mis sous tension. */
+    JOURNAL_MISE_SOUS_TENSION = 1,
+    /** L'alimentation a fait défaut. */
+    JOURNAL_DEFAILLANCE_ALIMENTATION = 2,
+    /** L'alimentation est de retour. */
+    JOURNAL_RETOUR_ALIMENTATION = 3,
+    /** L'accumulateur va être isolé. */
+    JOURNAL_ISOLATION_ACCUMULATEUR = 4,
+    /** La charge de l'accumulateur est terminée. */
+    JOURNAL_CHARGE_COMPLETE = 5,
+    /** Le raspberry est réveillé à l'heure programmée. */
+    JOURNAL_REVEIL = 6,
+    /** 
+     * Des événements ont été perdus: les entrées en attente d'écriture
+     * en EEPROM occupaient tout l'anneau.
+     */
+    JOURNAL_EVENEMENTS_PERDUS = 7,
+    /** Entrée vide. */
+    JOURNAL_VIDE = 0xFF
+} JournalEvenement;
+
+/**
+ * Charge le journal depuis l'EEPROM et retrouve la prochaine entrée à
+ * écrire. Bloque pendant la lecture de l'EEPROM.
+ */
+void journalInitialise();
+
+/**
+ * Ajoute un événement au journal. L'entrée est immédiatement lisible par
+ * I2C; elle sera écrite en EEPROM par journalEcrit.
+ * Une entrée en attente d'écriture n'est jamais remplacée: quand il ne
+ * reste qu'une entrée libre, elle reçoit JOURNAL_EVENEMENTS_PERDUS, et
+ * les événements suivants sont ignorés jusqu'à ce que journalEcrit en
+ * libère d'autres.
+ * Peut être appelée depuis une interruption.
+ * @param evenement L'événement.
+ */
+void journalEnregistre(JournalEvenement evenement);
+
+/**
+ * Avance l'horodatage du journal d'une seconde.
+ */
+void journalSeconde();
+
+/**
+ * Écrit en EEPROM le prochain octet en attente, si l'EEPROM n'est pas 
+ * occupée. À appeler depuis la boucle principale.
+ */
+void journalEcrit();
+
+/**
+ * @return 255 / -1 si toutes les entrées du journal sont écrites en EEPROM.
+ */
+unsigned char journalEstEcrit();
+
+/**
+ * Rend les octets du journal, de l'entrée la plus ancienne à la plus
+ * récente, pour une lecture en rafale sur le bus I2C.
+ * @param premier 255 / -1 pour le premier octet d'une lecture.
+ * @return L'octet suivant, ou JOURNAL_VIDE après la dernière entrée.
+ */
+unsigned char journalLecture(unsigned char premier);
+
+#ifdef TEST
+void testeJournal();
+#endif
+
+#endif
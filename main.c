@@ -2,6 +2,20 @@
 #include "i2c.h"
 #include "file.h"
 #include "energie.h"
+#include "jauge.h"
+#include "sante.h"
+#include "journal.h"
+#include "calibration.h"
+#include "reference.h"
+#include "filtre.h"
+#include "temperature.h"
+#include "charge.h"
+#include "capture.h"
+#include "eeprom.h"
+#include "demarreur.h"
+#include "horloge.h"
+#include "compteurs.h"
+#include "profilage.h"
 #include "test.h"
 
 /**
@@ -13,11 +27,10 @@
 
 // Nécessaires pour ICSP / ICD:
 #pragma config MCLRE = EXTMCLR  // RE3 est actif comme master reset.
-#pragma config WDTEN = OFF      // Watchdog inactif.
+#pragma config WDTEN = SWON     // Watchdog inactif, sauf pendant la veille.
+#pragma config WDTPS = 1024     // Réveille la veille toutes les 4s (voir horloge.h).
 #pragma config LVP = OFF        // Single Supply Enable bits off.
 
-#ifndef TEST
-
 /**
  * Maintient l'alimentation en gardant ouvert le transistor
  * d'entrée.
@@ -36,10 +49,10 @@ void coupeAlimentation() {
 }
 
 /**
- * Configure le circuit selon l'état de l'accumulateur.
- * @param accumulateur L'état de l'accumulateur.
+ * Configure les sorties selon l'état de l'accumulateur.
+ * @param energie L'état de l'accumulateur.
  */
-void configureCircuit(Energie *energie) {
+static void configureSorties(Energie *energie) {
 
     // JAUNE: Si l'accumulateur n'est pas disponible, ou si il est en charge:
     if ( (!energie->accumulateurDisponible) || (energie->chargerAccumulateur)) {
@@ -57,10 +70,84 @@ void configureCircuit(Energie *energie) {
     
     // Convertisseur BOOST: pour solliciter l'accumulateur:
     TRISCbits.RC2 = ~energie->solliciterAccumulateur;
+}
+
+/** Vaut 255 quand l'accumulateur est isolé en attendant un réveil. */
+static volatile unsigned char veilleDemandee = 0;
+
+/** Vaut 255 quand le raspberry arrêté doit être démarré. */
+static volatile unsigned char reveilDemande = 0;
+
+/**
+ * Configure le circuit selon l'état de l'accumulateur.
+ * @param energie L'état de l'accumulateur.
+ */
+void configureCircuit(Energie *energie) {
+
+    // Les sorties ne sont modifiées que si l'état a changé:
+    if (energieModifiee()) {
+        configureSorties(energie);
+    }
     
-    // Isoler l'accumulateur:
+    // Isoler l'accumulateur, une fois le journal et les compteurs écrits
+    // en EEPROM. Si un réveil est programmé, le micro-contrôleur reste 
+    // alimenté et dort tant que l'accumulateur est disponible:
     if (energie->isolerAccumulateur) {
-        coupeAlimentation();
+        compteursEnregistre();
+        if (journalEstEcrit() && compteursEstEcrit()) {
+            if (horlogeReveilProgramme() && energie->accumulateurDisponible) {
+                veilleDemandee = 255;
+            } else {
+                coupeAlimentation();
+            }
+        }
+    }
+}
+
+/**
+ * L'heure du réveil est atteinte.
+ */
+static void reveille() {
+    if (energieReveille()) {
+        reveilDemande = 255;
+    }
+}
+
+/** Vaut 255 quand le raspberry a demandé une mise à jour. */
+static unsigned char miseAJourDemandee = 0;
+
+/**
+ * Exécute l'écriture d'un registre par le raspberry.
+ * @param registre Le numéro de registre, voir I2cRegistre.
+ * @param valeur La valeur écrite.
+ */
+void ecritRegistre(unsigned char registre, unsigned char valeur) {
+    switch (registre) {
+        case REGISTRE_ARRET_ANNONCE:
+            energieAnnonceArret(valeur);
+            break;
+            
+        case REGISTRE_POLITIQUE_RETOUR:
+            energieEtablitPolitiqueRetour(valeur);
+            break;
+
+        case REGISTRE_CALIBRATION_COMMANDE:
+            calibrationCommande(valeur);
+            break;
+
+        case REGISTRE_MISE_A_JOUR:
+            if (valeur == DEMARREUR_DEMANDE) {
+                miseAJourDemandee = 255;
+            }
+            break;
+
+        default:
+            if ((registre >= REGISTRE_CALIBRATION) && (registre < REGISTRE_CALIBRATION_COMMANDE)) {
+                calibrationPropose(registre - REGISTRE_CALIBRATION, valeur);
+            } else if ((registre >= REGISTRE_HORLOGE) && (registre < REGISTRE_PERIODE_VEILLE)) {
+                horlogeEcrit(registre - REGISTRE_HORLOGE, valeur);
+            }
+            break;
     }
 }
 
@@ -71,50 +158,275 @@ void configureCircuit(Energie *energie) {
 typedef enum {
     ALIMENTATION = 0,
     BOOST = 1,
-    ACCUMULATEUR = 2
+    ACCUMULATEUR = 2,
+    /** Thermistance de l'accumulateur, sur RA3. */
+    THERMISTANCE = 3,
+    /** Tampon 2 de la référence fixe (FVR BUF2). */
+    TENSION_REFERENCE = 31
 } SourceAD;
 
+/**
+ * Filtre, compense et calibre la conversion d'un canal.
+ * @param source Le canal.
+ * @return La conversion corrigée.
+ */
+static unsigned char corrigeConversion(SourceAD source) {
+    return calibrationCorrige(source, referenceCompense(filtreEchantillon(source, ADRESH)));
+}
+
+/**
+ * Traite une conversion de la tension d'alimentation.
+ */
+static Energie *traiteAlimentation() {
+    unsigned char conversion = corrigeConversion(ALIMENTATION);
+    i2cExposeRegistre16(REGISTRE_MILLIVOLTS_ALIMENTATION, referenceMillivolts(conversion));
+    i2cExposeValeur(LECTURE_ALIMENTATION, conversion);
+    captureMesure(ALIMENTATION, ADRESH);
+    return mesureAlimentation(conversion);
+}
+
+/**
+ * Traite une conversion de la tension de sortie du convertisseur Boost.
+ */
+static Energie *traiteBoost() {
+    unsigned char conversion = corrigeConversion(BOOST);
+    i2cExposeRegistre16(REGISTRE_MILLIVOLTS_BOOST, referenceMillivolts(conversion));
+    i2cExposeValeur(LECTURE_BOOST, conversion);
+    captureMesure(BOOST, ADRESH);
+    return mesureBoost(conversion);
+}
+
+/**
+ * Traite une conversion de la tension de l'accumulateur.
+ */
+static Energie *traiteAccumulateur() {
+    unsigned char conversion = corrigeConversion(ACCUMULATEUR);
+    i2cExposeRegistre16(REGISTRE_MILLIVOLTS_ACCUMULATEUR, referenceMillivolts(conversion));
+    i2cExposeValeur(LECTURE_ACCUMULATEUR, conversion);
+    captureMesure(ACCUMULATEUR, ADRESH);
+    jaugeMesureAccumulateur(conversion);
+    santeMesureAccumulateur(conversion, energieActuelle());
+    return mesureAccumulateur(conversion);
+}
+
+/**
+ * Traite une conversion de la thermistance de l'accumulateur.
+ * La mesure est ratiométrique: elle n'est ni compensée ni calibrée.
+ */
+static Energie *traiteTemperature() {
+    signed char degres = temperatureDegres(filtreEchantillon(THERMISTANCE, ADRESH));
+    captureMesure(THERMISTANCE, ADRESH);
+    return mesureTemperature(degres);
+}
+
+/**
+ * Traite une conversion de la référence fixe.
+ */
+static Energie *traiteTensionReference() {
+    captureMesure(CAPTURE_CANAL_REFERENCE, ADRESH);
+    referenceMesure(((unsigned int) ADRESH << 2) | (ADRESL >> 6));
+    return energieActuelle();
+}
+
+/**
+ * Traite le résultat d'une conversion.
+ * @return L'état à propager sur le circuit.
+ */
+typedef Energie *(*TraitementAD)();
+
+/**
+ * Étape de la séquence de conversions.
+ */
+typedef struct {
+    /** Le canal à convertir. */
+    SourceAD source;
+    /** Le traitement du résultat de la conversion. */
+    TraitementAD traitement;
+} EtapeAD;
+
+/**
+ * Séquence des conversions Analogique / Digital.
+ * La défaillance de l'alimentation est l'événement le plus urgent: elle
+ * reçoit une conversion sur deux. La tension de l'accumulateur change en
+ * quelques minutes, et la température et la référence fixe encore 
+ * plus lentement.
+ * Pour ajouter une source, il suffit de l'ajouter à cette séquence.
+ */
+static const EtapeAD sequenceAD[] = {
+    {ALIMENTATION,      traiteAlimentation},
+    {ACCUMULATEUR,      traiteAccumulateur},
+    {ALIMENTATION,      traiteAlimentation},
+    {BOOST,             traiteBoost},
+    {ALIMENTATION,      traiteAlimentation},
+    {ACCUMULATEUR,      traiteAccumulateur},
+    {ALIMENTATION,      traiteAlimentation},
+    {TENSION_REFERENCE, traiteTensionReference},
+    {ALIMENTATION,      traiteAlimentation},
+    {THERMISTANCE,      traiteTemperature}
+};
+
+#define NOMBRE_ETAPES_AD (sizeof(sequenceAD) / sizeof(EtapeAD))
+
+#ifdef PROFILAGE
+/**
+ * @param source Une source de conversion.
+ * @return La sonde de profilage de son traitement.
+ */
+static unsigned char sondeConversion(SourceAD source) {
+    switch (source) {
+        case ALIMENTATION:
+            return PROFILAGE_CONVERSION_ALIMENTATION;
+        case BOOST:
+            return PROFILAGE_CONVERSION_BOOST;
+        case ACCUMULATEUR:
+            return PROFILAGE_CONVERSION_ACCUMULATEUR;
+        case THERMISTANCE:
+            return PROFILAGE_CONVERSION_THERMISTANCE;
+        default:
+            return PROFILAGE_CONVERSION_REFERENCE;
+    }
+}
+#endif
+
+/** Secondes avant de confirmer le démarrage au démarreur. */
+static unsigned char secondesAvantConfirmation = DEMARREUR_CONFIRMATION_SECONDES;
+
+/**
+ * Tâches de chaque seconde qui partagent l'état de l'énergie, du journal,
+ * des compteurs et de l'horloge avec l'interruption. Elles ne font que
+ * des additions et des comparaisons, et s'exécutent interruptions
+ * masquées.
+ */
+static void traiteSecondeMasquee() {
+    journalSeconde();
+    compteursSeconde(energieActuelle());
+    if (horlogeSeconde()) {
+        reveille();
+    }
+    configureCircuit(energieSeconde());
+}
+
+/**
+ * Tâches à réaliser une fois par seconde, depuis la boucle principale.
+ * Les divisions de la référence et de la jauge restent interruptibles;
+ * le reste masque les interruptions de basse priorité.
+ */
+static void traiteSeconde() {
+    Energie energie;
+    unsigned char giel;
+
+    if (secondesAvantConfirmation) {
+        secondesAvantConfirmation--;
+    }
+    giel = INTCONbits.GIEL;
+    INTCONbits.GIEL = 0;
+    energie = *energieActuelle();
+    INTCONbits.GIEL = giel;
+
+    referenceSeconde();
+    jaugeSeconde(&energie);
+
+    INTCONbits.GIEL = 0;
+    traiteSecondeMasquee();
+    INTCONbits.GIEL = giel;
+}
+
+/** Période d'interruption du temporisateur 0, en cycles d'instruction. */
+#define TEMPORISATEUR0_PERIODE 1000
+
+/**
+ * Cycles que le temporisateur 0 ne compte pas pendant sa recharge: ceux
+ * qui séparent la lecture de TMR0L de son écriture, plus les 2 cycles
+ * pendant lesquels l'écriture de TMR0L bloque le comptage. Estimé
+ * d'après la séquence d'instructions; le test TMR0P01 le vérifie.
+ */
+#define TEMPORISATEUR0_CORRECTION 12
+
+/**
+ * Recharge le temporisateur 0 pour la prochaine période. La recharge est
+ * ajoutée au compte actuel au lieu de le remplacer: les cycles écoulés
+ * depuis le débordement, jusqu'à l'entrée dans l'interruption, sont
+ * conservés et l'horloge ne dérive pas.
+ */
+static void rechargeTemporisateur0() {
+    unsigned int compte;
+
+    compte = TMR0L;
+    compte |= (unsigned int) TMR0H << 8;
+    compte += (unsigned int) (TEMPORISATEUR0_CORRECTION - TEMPORISATEUR0_PERIODE);
+    TMR0H = compte >> 8;
+    TMR0L = (unsigned char) compte;
+}
+
+#ifndef TEST
+
+/** Nombre d'interruptions du temporisateur 0 par seconde. */
+#define TEMPORISATEUR0_PAR_SECONDE 2000
+
+/** Nombre de séquences de conversions complètes, pour la veille. */
+static volatile unsigned char sequencesAD = 0;
+
+/** Secondes comptées par l'interruption, et celles déjà traitées. */
+static volatile unsigned char secondesEcoulees = 0;
+static unsigned char secondesTraitees = 0;
+
+/**
+ * Traite les secondes écoulées depuis le dernier appel. Si la boucle
+ * principale a été retardée, aucune n'est perdue.
+ */
+static void traiteSecondesEcoulees() {
+    while (secondesTraitees != secondesEcoulees) {
+        secondesTraitees++;
+        traiteSeconde();
+    }
+}
+
 /**
  * Gère les interruptions de basse priorité.
  */
 void interrupt low_priority bassePriorite() {
-    static SourceAD sourceAD = ACCUMULATEUR;
+    static unsigned char etapeAD = 0;
+    static unsigned int temporisateur0 = 0;
     Energie *energie;
-    unsigned char conversion;
+#ifdef PROFILAGE
+    unsigned int debut = profilageInstant();
+    unsigned int debutConversion;
+    unsigned char chemin = 0;
+#endif
 
     // Lance une conversion Analogique / Digitale:
     if (INTCONbits.T0IF) {
+#ifdef PROFILAGE
+        chemin |= PROFILAGE_CHEMIN_TEMPORISATEUR;
+#endif
         INTCONbits.T0IF = 0;
-        TMR0H = 0xFC;
-        TMR0L = 0x18;
-        ADCON0bits.CHS = sourceAD;
+        rechargeTemporisateur0();
+        ADCON0bits.CHS = sequenceAD[etapeAD].source;
         ADCON0bits.GODONE = 1;
+
+        // Signale la seconde à la boucle principale:
+        if (++temporisateur0 >= TEMPORISATEUR0_PAR_SECONDE) {
+            temporisateur0 = 0;
+            secondesEcoulees++;
+        }
     }
     
     // Reçoit le résultat de la conversion Analogique / Digitale.
     if (PIR1bits.ADIF) {
         PIR1bits.ADIF = 0;
         if (!ADCON0bits.GODONE) {
-            conversion = ADRESH;
-            switch (sourceAD) {
-                case ACCUMULATEUR:
-                    i2cExposeValeur(LECTURE_ACCUMULATEUR, conversion);
-                    energie = mesureAccumulateur(conversion);
-                    sourceAD = BOOST;
-                    break;
-
-                case BOOST:
-                    i2cExposeValeur(LECTURE_BOOST, conversion);
-                    energie = mesureBoost(conversion);
-                    sourceAD = ALIMENTATION;
-                    break;
-
-                case ALIMENTATION:
-                default:
-                    i2cExposeValeur(LECTURE_ALIMENTATION, conversion);
-                    energie = mesureAlimentation(conversion);
-                    sourceAD = ACCUMULATEUR;
-                    break;
+#ifdef PROFILAGE
+            chemin |= PROFILAGE_CHEMIN_CONVERSION;
+            debutConversion = profilageInstant();
+#endif
+            energie = sequenceAD[etapeAD].traitement();
+#ifdef PROFILAGE
+            profilageEnregistre(sondeConversion(sequenceAD[etapeAD].source), debutConversion);
+#endif
+            if (++etapeAD >= NOMBRE_ETAPES_AD) {
+                etapeAD = 0;
+                captureSequence();
+                sequencesAD++;
             }
             configureCircuit(energie);
         } else {
@@ -124,10 +436,17 @@ void interrupt low_priority bassePriorite() {
 
     // Interruptions I2C
     if (PIR1bits.SSP1IF) {
+#ifdef PROFILAGE
+        chemin |= PROFILAGE_CHEMIN_I2C;
+#endif
         i2cEsclave();
         PIR1bits.SSP1IF = 0;
     }
 
+#ifdef PROFILAGE
+    profilageEnregistre(chemin, debut);
+#endif
+
 }
 
 /**
@@ -138,7 +457,7 @@ static void hardwareInitialise() {
     OSCCONbits.IRCF = 6;    // 6 ==> 8MHz
     
     // Entrées analogiques:
-    ANSELA = 0b00000111;
+    ANSELA = 0b00001111;
     ANSELB = 0;
     ANSELC = 0;
     
@@ -148,6 +467,10 @@ static void hardwareInitialise() {
     ADCON2bits.ACQT = 5;    // Conversion: 12 TAD.
     ADCON0bits.ADON = 1;    // Active le convertisseur.
     
+    // Référence fixe à 2.048V, pour compenser les variations de VDD:
+    VREFCON0bits.FVRS = 2;
+    VREFCON0bits.FVREN = 1;
+
     PIE1bits.ADIE = 1;      // Interruptions du module A/D
     IPR1bits.ADIP = 0;      // Basse priorité.
 
@@ -170,7 +493,7 @@ static void hardwareInitialise() {
     T2CONbits.TMR2ON = 1;
     
     // Active le temporisateur 0 pour surveiller les entrées analogiques:
-    // Période d'interruption: 100uS
+    // Période d'interruption: 500uS (TEMPORISATEUR0_PERIODE)
     T0CONbits.T08BIT = 0;
     T0CONbits.T0CS = 0;
     T0CONbits.PSA = 1;
@@ -185,6 +508,7 @@ static void hardwareInitialise() {
     SSP1ADD = LECTURE_ALIMENTATION;     // 1ère Adresse de l'esclave.
     SSP1MSK = I2C_MASQUE_ADRESSES_ESCLAVES;
     SSP1CON1bits.SSPM = 0b1110;         // SSP1 en mode esclave I2C avec adresse de 7 bits et interruptions STOP et START.
+    SSP1CON2 = 0;                       // Pas d'étirement de l'horloge en réception (SEN); en émission, i2cEsclave relâche CKP après chaque octet.
         
     SSP1CON3bits.PCIE = 1;              // Désactive l'interruption en cas STOP.
     SSP1CON3bits.SCIE = 1;              // Désactive l'interruption en cas de START.
@@ -200,21 +524,362 @@ static void hardwareInitialise() {
     INTCONbits.GIEL = 1;
 }
 
+/**
+ * Nombre de séquences de conversions après chaque période de sommeil: 
+ * le temps que les filtres retrouvent les tensions actuelles.
+ */
+#define SEQUENCES_AD_PAR_EVEIL 3
+
+/** Voyants VERT (RC0), JAUNE (RC1) et ROUGE (RC5), éteints pendant le sommeil. */
+#define VEILLE_SORTIES_C 0b00100011
+
+/** Commande de la charge (RA6), coupée pendant le sommeil. */
+#define VEILLE_SORTIES_A 0b01000000
+
+/**
+ * Met le micro-contrôleur en sommeil en attendant le réveil programmé.
+ * Le chien de garde le réveille à chaque période: l'horloge avance, puis
+ * les conversions reprennent le temps de quelques séquences. La veille
+ * se termine à l'heure du réveil, au retour de l'alimentation, ou pour
+ * écrire le journal. Les voyants et la commande de charge sont éteints
+ * pendant le sommeil, et rétablis à chaque réveil. Si l'accumulateur s'épuise, configureCircuit coupe
+ * l'alimentation.
+ */
+static void veille() {
+    unsigned char sequences;
+    unsigned char sortiesA, sortiesC;
+
+    while (energieActuelle()->isolerAccumulateur && journalEstEcrit() && compteursEstEcrit()) {
+        INTCONbits.GIEL = 0;
+        ADCON0bits.ADON = 0;
+        VREFCON0bits.FVREN = 0;
+        sortiesA = LATA & VEILLE_SORTIES_A;
+        sortiesC = LATC & VEILLE_SORTIES_C;
+        LATA &= ~VEILLE_SORTIES_A;
+        LATC &= ~VEILLE_SORTIES_C;
+        WDTCONbits.SWDTEN = 1;
+        SLEEP();
+        NOP();
+        WDTCONbits.SWDTEN = 0;
+        LATA |= sortiesA;
+        LATC |= sortiesC;
+        if (horlogeVeille()) {
+            reveille();
+        }
+        VREFCON0bits.FVREN = 1;
+        ADCON0bits.ADON = 1;
+        filtreInitialise();
+        while (!VREFCON0bits.FVRST);
+        sequences = sequencesAD;
+        INTCONbits.GIEL = 1;
+        while ((unsigned char) (sequencesAD - sequences) < SEQUENCES_AD_PAR_EVEIL) {
+            traiteSecondesEcoulees();
+        }
+    }
+    veilleDemandee = 0;
+}
+
+/** Fréquence de l'oscillateur, pour __delay_ms (voir hardwareInitialise). */
+#define _XTAL_FREQ 8000000
+
+/** Durée de l'impulsion sur SCL qui démarre le raspberry, en ms. */
+#define IMPULSION_REVEIL_MS 200
+
+/**
+ * Démarre le raspberry arrêté (halt) en tenant SCL (GPIO3) au niveau
+ * bas. Un raspberry qui n'était pas alimenté démarre de lui-même dès que
+ * l'accumulateur est sollicité.
+ */
+static void reveilleRaspberry() {
+    unsigned char n;
+
+    reveilDemande = 0;
+    SSP1CON1bits.SSPEN = 0;
+    PORTCbits.RC3 = 0;
+    TRISCbits.RC3 = 0;
+    for (n = 0; n < IMPULSION_REVEIL_MS; n++) {
+        __delay_ms(1);
+    }
+    TRISCbits.RC3 = 1;
+    SSP1CON1bits.SSPEN = 1;
+}
+
+/**
+ * Redémarre dans le démarreur, après avoir retenu la demande de mise à
+ * jour dans l'EEPROM. Les compteurs sont enregistrés. Les écritures du
+ * journal et de la calibration en cours sont terminées, les suivantes 
+ * sont abandonnées.
+ */
+static void redemarreDansLeDemarreur() {
+    compteursEnregistre();
+    while (!compteursEstEcrit()) {
+        compteursEcrit();
+    }
+    while (!eepromEcrit(EEPROM_DEMARREUR, DEMARREUR_DEMANDE));
+    while (eepromOccupee());
+    RESET();
+}
+
+/**
+ * Confirme le démarrage au démarreur: si cette version a été démarrée à
+ * l'essai, arrête le chien de garde et efface DEMARREUR_LANCE, pour que
+ * le démarreur ne rétablisse pas l'ancienne version.
+ * @return 255 si le démarrage est confirmé, 0 si l'EEPROM est occupée.
+ */
+static unsigned char confirmeDemarrage() {
+    if (eepromOccupee()) {
+        return 0;
+    }
+    if (eepromLit(EEPROM_DEMARREUR) == DEMARREUR_LANCE) {
+        if (!eepromEcrit(EEPROM_DEMARREUR, 0xFF)) {
+            return 0;
+        }
+    }
+    WDTCONbits.SWDTEN = 0;
+    return 255;
+}
+
 /**
  * Point d'entrée pour l'émetteur de radio contrôle.
  */
 void main(void) {
+    unsigned char demarrageConfirme = 0;
+
     maintientAlimentation();
+    calibrationInitialise();
+    referenceInitialise();
+    filtreInitialise();
+    jaugeInitialise();
+    santeInitialise();
+    journalInitialise();
+    journalEnregistre(JOURNAL_MISE_SOUS_TENSION);
+    horlogeInitialise();
+    compteursInitialise();
+    i2cRappelRegistre(ecritRegistre);
+    i2cExposeFlux(LECTURE_JOURNAL, journalLecture);
+    captureInitialise();
+    i2cExposeFlux(LECTURE_CAPTURE, captureLecture);
+    i2cExposeFinFlux(LECTURE_CAPTURE, captureFinLecture);
+#ifdef PROFILAGE
+    profilageInitialise();
+    i2cExposeFlux(LECTURE_PROFILAGE, profilageLecture);
+    i2cExposeFinFlux(LECTURE_PROFILAGE, profilageFinLecture);
+#endif
     hardwareInitialise();
-    while(1);
+    while(1) {
+        traiteSecondesEcoulees();
+        journalEcrit();
+        calibrationEcrit();
+        compteursEcrit();
+        if (veilleDemandee) {
+            veille();
+        }
+        if (reveilDemande) {
+            reveilleRaspberry();
+        }
+        if (miseAJourDemandee) {
+            redemarreDansLeDemarreur();
+        }
+        if (!demarrageConfirme && !secondesAvantConfirmation) {
+            demarrageConfirme = confirmeDemarrage();
+        }
+    }
 }
 #endif
 
 #ifdef TEST
+
+/*
+ * Coût maximum du traitement de chaque conversion, configureCircuit
+ * compris, en cycles d'instruction: le coût de chaque chemin, changements
+ * d'état compris, plus une marge de 10%. Le temporisateur 0 interrompt
+ * tous les 1000 cycles; l'entrée dans l'interruption, la sauvegarde du
+ * contexte et i2cEsclave ne sont pas mesurés.
+ * Ces budgets sont estimés d'après le code C, pas mesurés: les tests BNC
+ * affichent les cycles comptés par le temporisateur 3, qui servent à les
+ * ajuster à la première exécution sur la cible.
+ */
+#define CYCLES_ALIMENTATION_MAXIMUM 550
+#define CYCLES_BOOST_MAXIMUM 480
+#define CYCLES_ACCUMULATEUR_MAXIMUM 770
+#define CYCLES_THERMISTANCE_MAXIMUM 400
+#define CYCLES_REFERENCE_MAXIMUM 140
+
+/**
+ * Coût maximum des tâches de chaque seconde, en cycles d'instruction,
+ * plus une marge de 10%. Elles s'exécutent dans la boucle principale.
+ */
+#define CYCLES_SECONDE_MAXIMUM 3620
+
+/**
+ * Coût maximum de la partie masquée des tâches de chaque seconde. Elle
+ * retarde l'interruption, qui doit encore recharger le temporisateur 0
+ * avant la fin de sa période.
+ */
+#define CYCLES_SECONDE_MASQUEE_MAXIMUM 900
+
+/** Identifiants des mesures de chaque étape de la séquence. */
+static const char *identifiantsEtapes[] = {
+    "BNCAD00", "BNCAD01", "BNCAD02", "BNCAD03", "BNCAD04",
+    "BNCAD05", "BNCAD06", "BNCAD07", "BNCAD08", "BNCAD09"
+};
+
+/**
+ * @param source Une source de conversion.
+ * @return Le coût maximum du traitement de sa conversion.
+ */
+static unsigned int cyclesMaximum(SourceAD source) {
+    switch (source) {
+        case ALIMENTATION:
+            return CYCLES_ALIMENTATION_MAXIMUM;
+        case BOOST:
+            return CYCLES_BOOST_MAXIMUM;
+        case ACCUMULATEUR:
+            return CYCLES_ACCUMULATEUR_MAXIMUM;
+        case THERMISTANCE:
+            return CYCLES_THERMISTANCE_MAXIMUM;
+        default:
+            return CYCLES_REFERENCE_MAXIMUM;
+    }
+}
+
+/**
+ * Rend la conversion scriptée pour une source.
+ * @param source La source.
+ * @param defaillance Si l'alimentation doit faire défaut.
+ */
+static void injecteConversion(SourceAD source, unsigned char defaillance) {
+    ADRESL = 0;
+    switch (source) {
+        case ALIMENTATION:
+            ADRESH = defaillance ? 150 : 200;
+            break;
+        case BOOST:
+            ADRESH = 230;
+            break;
+        case ACCUMULATEUR:
+            ADRESH = 100;
+            break;
+        case THERMISTANCE:
+            ADRESH = 141;
+            break;
+        default:
+            // 2.048V sur 10 bits, justifiés à gauche, avec VDD à 5V:
+            ADRESH = (REFERENCE_FVR_NOMINALE / 4) >> 2;
+            ADRESL = ((REFERENCE_FVR_NOMINALE / 4) & 3) << 6;
+            break;
+    }
+}
+
+/**
+ * Mesure le coût de chaque étape de la séquence de conversions, telle
+ * qu'exécutée par l'interruption, puis celui des tâches de chaque seconde.
+ * @param defaillance Si l'alimentation doit faire défaut, pour 
+ * mesurer aussi les changements d'état.
+ */
+static void mesure_le_cout_des_interruptions(unsigned char defaillance) {
+    unsigned char n;
+    unsigned int cycles;
+
+    for (n = 0; n < NOMBRE_ETAPES_AD; n++) {
+        injecteConversion(sequenceAD[n].source, defaillance);
+        chronometreDemarre();
+        configureCircuit(sequenceAD[n].traitement());
+        cycles = chronometreLit();
+        verifieCycles(identifiantsEtapes[n], cycles, cyclesMaximum(sequenceAD[n].source));
+    }
+
+    chronometreDemarre();
+    traiteSeconde();
+    cycles = chronometreLit();
+    verifieCycles("BNCSE01", cycles, CYCLES_SECONDE_MAXIMUM);
+
+    chronometreDemarre();
+    traiteSecondeMasquee();
+    cycles = chronometreLit();
+    verifieCycles("BNCSE02", cycles, CYCLES_SECONDE_MASQUEE_MAXIMUM);
+}
+
+/** Nombre de périodes du temporisateur 0 mesurées par le chronomètre. */
+#define PERIODES_TEMPORISATEUR0 50
+
+/**
+ * Le temporisateur 0 garde sa période quand l'interruption tarde:
+ * chaque débordement est traité après une attente qui varie, comme
+ * l'entrée dans l'interruption derrière i2cEsclave ou une conversion.
+ */
+static void le_temporisateur_0_garde_sa_periode() {
+    unsigned char n;
+    unsigned char attente;
+    unsigned int cycles;
+
+    T0CON = 0;
+    T0CONbits.T08BIT = 0;
+    T0CONbits.T0CS = 0;
+    T0CONbits.PSA = 1;
+    TMR0H = 0xFF;
+    TMR0L = 0xF0;
+    INTCONbits.TMR0IE = 0;
+    INTCONbits.T0IF = 0;
+    T0CONbits.TMR0ON = 1;
+    while (!INTCONbits.T0IF);
+    chronometreDemarre();
+    INTCONbits.T0IF = 0;
+    rechargeTemporisateur0();
+    for (n = 1; n < PERIODES_TEMPORISATEUR0; n++) {
+        while (!INTCONbits.T0IF);
+        INTCONbits.T0IF = 0;
+        for (attente = 0; attente < 4 * (n & 7); attente++) {
+            NOP();
+        }
+        rechargeTemporisateur0();
+    }
+    while (!INTCONbits.T0IF);
+    cycles = chronometreLit();
+    T0CONbits.TMR0ON = 0;
+
+    // Sans correction de la latence, l'écart dépasserait 1000 cycles:
+    cycles -= (unsigned int) PERIODES_TEMPORISATEUR0 * TEMPORISATEUR0_PERIODE;
+    if (cycles > 0x8000) {
+        cycles = -cycles;
+    }
+    verifieInferieur("TMR0P01", cycles, 40);
+}
+
+static void mesure_le_cout_des_chemins_de_l_interruption() {
+    initialiseEnergie();
+    filtreInitialise();
+    jaugeInitialise();
+    santeInitialise();
+    mesure_le_cout_des_interruptions(0);
+    mesure_le_cout_des_interruptions(1);
+    mesure_le_cout_des_interruptions(0);
+    initialiseEnergie();
+}
+
 void main(void) {
     initialiseTests();
     testeEnergie();
     testeFile();
+    testeJauge();
+    testeSante();
+    testeJournal();
+    testeCalibration();
+    testeReference();
+    testeFiltre();
+    testeTemperature();
+    testeCapture();
+    testeHorloge();
+    testeCompteurs();
+#ifdef PROFIL_CHARGE_DELTA_V
+    testeCharge();
+#endif
+#ifdef PROFILAGE
+    testeProfilage();
+#endif
+    testI2c();
+    le_temporisateur_0_garde_sa_periode();
+    mesure_le_cout_des_chemins_de_l_interruption();
     finaliseTests();
     while(1);
 }
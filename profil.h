@@ -0,0 +1,151 @@
+#ifndef PROFIL_H
+#define	PROFIL_H
+
+/**
+ * Profil de l'accumulateur, choisi à la compilation:
+ * - PROFIL_LIION (par défaut): une cellule 18650 Li-ion.
+ * - PROFIL_NIMH: trois cellules NiMH AA en série.
+ * Un profil ne contient que des constantes: les modules qui l'utilisent
+ * n'ont aucun aiguillage à l'exécution.
+ * Les tensions sont numérisées sur 8 bits après le diviseur 1/2, soit
+ * 39.2mV par pas.
+ */
+#if defined(PROFIL_LIION) && defined(PROFIL_NIMH)
+#error "Choisir un seul profil d'accumulateur: PROFIL_LIION ou PROFIL_NIMH"
+#endif
+
+#ifdef PROFIL_NIMH
+
+/** Identifiant du profil, mêlé au CRC de la calibration en EEPROM. */
+#define PROFIL_IDENTIFIANT 1
+
+/** Capacité nominale, en mAh: 3 x AA 2000mAh. */
+#define PROFIL_CAPACITE_MAH 2000
+
+/** Courant du chargeur, en mA: C/3 pour que le -ΔV soit marqué. */
+#define PROFIL_COURANT_CHARGE_MA 700
+
+/** L'accumulateur est absent en dessous de ce seuil (1.96V). */
+#define PROFIL_SEUIL_ABSENT 50
+/** L'accumulateur n'est pas utilisable jusqu'à ce seuil (2.98V, 0.99V par cellule). */
+#define PROFIL_SEUIL_PAS_UTILISABLE 76
+/** L'accumulateur est faible jusqu'à ce seuil (3.61V, 1.20V par cellule). */
+#define PROFIL_SEUIL_FAIBLE 92
+/** 
+ * L'accumulateur est chargé à partir de ce seuil (4.63V, 1.54V par cellule).
+ * La fin de charge est détectée par le -ΔV: ce seuil n'est qu'une sécurité.
+ */
+#define PROFIL_SEUIL_CHARGE 118
+/** L'accumulateur est absent au dessus de ce seuil (4.94V, 1.65V par cellule). */
+#define PROFIL_SEUIL_SURTENSION 126
+
+/** La fin de charge est détectée par le -ΔV (voir charge.h). */
+#define PROFIL_CHARGE_DELTA_V
+
+/** Chute de tension sous le pic qui termine la charge: 5mV par cellule. */
+#define PROFIL_DELTA_V_MILLIVOLTS 15
+
+/** 
+ * Élévation de température en 3 minutes qui termine la charge, en °C.
+ * À retirer si la thermistance n'est pas collée aux cellules.
+ */
+#define PROFIL_DELTA_T_DEGRES 3
+
+/** Résistance interne d'un accumulateur neuf, connectique comprise, en mΩ. */
+#define PROFIL_RESISTANCE_NEUVE 80
+/** Résistance interne d'un accumulateur à remplacer, en mΩ. */
+#define PROFIL_RESISTANCE_USEE 160
+
+/**
+ * Tension à vide en fonction de l'état de charge, pour 3 cellules NiMH.
+ * Le plateau autour de 1.2V par cellule rend l'estimation imprécise
+ * entre 20% et 80%: la jauge compte surtout sur l'intégration du courant.
+ */
+#define PROFIL_COURBE_TENSION_A_VIDE {                          \
+    { 77,   0},     /* 3.00V, 1.00V par cellule */              \
+    { 85,   5},     /* 3.33V, 1.11V par cellule */              \
+    { 89,  10},     /* 3.49V, 1.16V par cellule */              \
+    { 92,  20},     /* 3.61V, 1.20V par cellule */              \
+    { 94,  40},     /* 3.69V, 1.23V par cellule */              \
+    { 96,  60},     /* 3.76V, 1.25V par cellule */              \
+    { 98,  75},     /* 3.84V, 1.28V par cellule */              \
+    {101,  85},     /* 3.96V, 1.32V par cellule */              \
+    {104,  95},     /* 4.08V, 1.36V par cellule */              \
+    {107, 100}      /* 4.20V, 1.40V par cellule */              \
+}
+
+#ifdef TEST
+// Tensions caractéristiques x10, pour les tests:
+#define TENSION_MAXIMALE 49
+#define TENSION_PLEINE 47
+#define TENSION_PRESQUE_PLEINE 45
+#define TENSION_NOMINALE 40
+#define TENSION_INTERMEDIAIRE 37
+#define TENSION_FAIBLE 36
+#define TENSION_LIMITE 31
+#define TENSION_EPUISEE 29
+#endif
+
+#else
+
+#ifndef PROFIL_LIION
+#define PROFIL_LIION
+#endif
+
+/** Identifiant du profil, mêlé au CRC de la calibration en EEPROM. */
+#define PROFIL_IDENTIFIANT 0
+
+/** Capacité nominale, en mAh: Sony US18650VTC5A. */
+#define PROFIL_CAPACITE_MAH 2600
+
+/** Courant du chargeur, en mA. */
+#define PROFIL_COURANT_CHARGE_MA 500
+
+/** L'accumulateur est absent en dessous de ce seuil (1.96V). */
+#define PROFIL_SEUIL_ABSENT 50
+/** L'accumulateur n'est pas utilisable jusqu'à ce seuil (3.13V). */
+#define PROFIL_SEUIL_PAS_UTILISABLE 80
+/** L'accumulateur est faible jusqu'à ce seuil (3.53V). */
+#define PROFIL_SEUIL_FAIBLE 90
+/** L'accumulateur est chargé à partir de ce seuil (4.2V). */
+#define PROFIL_SEUIL_CHARGE 107
+/** L'accumulateur est absent au dessus de ce seuil (4.47V). */
+#define PROFIL_SEUIL_SURTENSION 114
+
+/** Résistance interne d'un accumulateur neuf, connectique comprise, en mΩ. */
+#define PROFIL_RESISTANCE_NEUVE 80
+/** Résistance interne d'un accumulateur à remplacer, en mΩ. */
+#define PROFIL_RESISTANCE_USEE 160
+
+/**
+ * Courbe de décharge à faible courant d'une cellule 18650 Li-ion
+ * (voir documentation/US18650VTC5A.jpg).
+ */
+#define PROFIL_COURBE_TENSION_A_VIDE {                          \
+    { 77,   0},     /* 3.00V */                                 \
+    { 84,   5},     /* 3.30V */                                 \
+    { 89,  10},     /* 3.50V */                                 \
+    { 92,  20},     /* 3.60V */                                 \
+    { 94,  40},     /* 3.70V */                                 \
+    { 97,  58},     /* 3.80V */                                 \
+    { 99,  70},     /* 3.90V */                                 \
+    {102,  82},     /* 4.00V */                                 \
+    {105,  92},     /* 4.10V */                                 \
+    {107, 100}      /* 4.20V */                                 \
+}
+
+#ifdef TEST
+// Tensions caractéristiques x10, pour les tests:
+#define TENSION_MAXIMALE 43
+#define TENSION_PLEINE 42
+#define TENSION_PRESQUE_PLEINE 41
+#define TENSION_NOMINALE 40
+#define TENSION_INTERMEDIAIRE 36
+#define TENSION_FAIBLE 35
+#define TENSION_LIMITE 32
+#define TENSION_EPUISEE 31
+#endif
+
+#endif
+
+#endif
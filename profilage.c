@@ -0,0 +1,184 @@
+#include <xc.h>
+#include "profilage.h"
+#include "test.h"
+
+#ifdef PROFILAGE
+
+/**
+ * Mesures d'une sonde.
+ */
+typedef struct {
+    /** Durée minimum, en cycles. */
+    unsigned int minimum;
+    /** Durée maximum, en cycles. */
+    unsigned int maximum;
+    /** Nombre de mesures dans chaque classe, saturé à 0xFFFF. */
+    unsigned int histogramme[PROFILAGE_CLASSES];
+} Sonde;
+
+static Sonde sondes[PROFILAGE_NOMBRE_SONDES];
+
+/** Position du prochain octet à rendre par profilageLecture. */
+static unsigned int lecture;
+
+/** Indique qu'une lecture est en cours: les mesures sont ignorées. */
+static unsigned char gele = 0;
+
+/**
+ * Réinitialise les mesures.
+ */
+static void reinitialise() {
+    unsigned char n, c;
+    
+    for (n = 0; n < PROFILAGE_NOMBRE_SONDES; n++) {
+        sondes[n].minimum = 0xFFFF;
+        sondes[n].maximum = 0;
+        for (c = 0; c < PROFILAGE_CLASSES; c++) {
+            sondes[n].histogramme[c] = 0;
+        }
+    }
+    gele = 0;
+}
+
+void profilageInitialise() {
+    T5CON = 0;              // Fosc/4, sans pré-diviseur, arrêté.
+    T5CONbits.T5RD16 = 1;   // Lecture de 16 bits en une opération.
+    TMR5H = 0;
+    TMR5L = 0;
+    T5CONbits.TMR5ON = 1;
+    reinitialise();
+}
+
+unsigned int profilageInstant() {
+    unsigned int instant;
+    instant = TMR5L;
+    instant |= (unsigned int) TMR5H << 8;
+    return instant;
+}
+
+void profilageMesure(unsigned char sonde, unsigned int duree) {
+    Sonde *s;
+    unsigned char classe;
+    
+    if (gele) {
+        return;
+    }
+    s = &sondes[sonde];
+    if (duree < s->minimum) {
+        s->minimum = duree;
+    }
+    if (duree > s->maximum) {
+        s->maximum = duree;
+    }
+    
+    classe = 0;
+    duree >>= 6;
+    while (duree && (classe < PROFILAGE_CLASSES - 1)) {
+        duree >>= 1;
+        classe++;
+    }
+    if (s->histogramme[classe] != 0xFFFF) {
+        s->histogramme[classe]++;
+    }
+}
+
+void profilageEnregistre(unsigned char sonde, unsigned int debut) {
+    profilageMesure(sonde, profilageInstant() - debut);
+}
+
+unsigned char profilageLecture(unsigned char premier) {
+    if (premier) {
+        lecture = 0;
+        gele = 255;
+    }
+    if (lecture >= sizeof(sondes)) {
+        gele = 0;
+        return 0;
+    }
+    if (lecture == sizeof(sondes) - 1) {
+        gele = 0;
+    }
+    return ((unsigned char *) sondes)[lecture++];
+}
+
+void profilageFinLecture() {
+    gele = 0;
+}
+
+#ifdef TEST
+
+static void enregistre_le_minimum_et_le_maximum() {
+    reinitialise();
+    profilageMesure(PROFILAGE_CONVERSION_BOOST, 300);
+    profilageMesure(PROFILAGE_CONVERSION_BOOST, 120);
+    profilageMesure(PROFILAGE_CONVERSION_BOOST, 200);
+    verifieEgalite("PRFMM01", sondes[PROFILAGE_CONVERSION_BOOST].minimum, 120);
+    verifieEgalite("PRFMM02", sondes[PROFILAGE_CONVERSION_BOOST].maximum, 300);
+    verifieEgalite("PRFMM03", sondes[PROFILAGE_CONVERSION_ALIMENTATION].maximum, 0);
+}
+
+static void classe_les_durees_par_puissances_de_deux() {
+    Sonde *s = &sondes[PROFILAGE_CHEMIN_CONVERSION];
+    
+    reinitialise();
+    profilageMesure(PROFILAGE_CHEMIN_CONVERSION, 0);
+    profilageMesure(PROFILAGE_CHEMIN_CONVERSION, 63);
+    profilageMesure(PROFILAGE_CHEMIN_CONVERSION, 64);
+    profilageMesure(PROFILAGE_CHEMIN_CONVERSION, 127);
+    profilageMesure(PROFILAGE_CHEMIN_CONVERSION, 128);
+    profilageMesure(PROFILAGE_CHEMIN_CONVERSION, 1000);
+    profilageMesure(PROFILAGE_CHEMIN_CONVERSION, 4095);
+    profilageMesure(PROFILAGE_CHEMIN_CONVERSION, 4096);
+    profilageMesure(PROFILAGE_CHEMIN_CONVERSION, 65535);
+    verifieEgalite("PRFCL01", s->histogramme[0], 2);
+    verifieEgalite("PRFCL02", s->histogramme[1], 2);
+    verifieEgalite("PRFCL03", s->histogramme[2], 1);
+    verifieEgalite("PRFCL04", s->histogramme[4], 1);
+    verifieEgalite("PRFCL05", s->histogramme[6], 1);
+    verifieEgalite("PRFCL06", s->histogramme[7], 2);
+}
+
+static void gele_les_mesures_pendant_la_lecture() {
+    unsigned int n;
+    
+    reinitialise();
+    profilageMesure(PROFILAGE_CHEMIN_TEMPORISATEUR, 0x1234);
+    verifieEgalite("PRFLE01", profilageLecture(255), 0xFF);
+    verifieEgalite("PRFLE02", profilageLecture(0), 0xFF);
+    for (n = 2; n < sizeof(Sonde); n++) {
+        profilageLecture(0);
+    }
+    verifieEgalite("PRFLE03", profilageLecture(0), 0x34);
+    verifieEgalite("PRFLE04", profilageLecture(0), 0x12);
+    
+    profilageMesure(PROFILAGE_CHEMIN_TEMPORISATEUR, 0x2000);
+    verifieEgalite("PRFLE05", sondes[PROFILAGE_CHEMIN_TEMPORISATEUR].minimum, 0x1234);
+    
+    for (n = sizeof(Sonde) + 2; n < sizeof(sondes); n++) {
+        profilageLecture(0);
+    }
+    profilageMesure(PROFILAGE_CHEMIN_TEMPORISATEUR, 0x1000);
+    verifieEgalite("PRFLE06", sondes[PROFILAGE_CHEMIN_TEMPORISATEUR].minimum, 0x1000);
+}
+
+static void reprend_apres_une_lecture_interrompue() {
+    reinitialise();
+    profilageLecture(255);
+    profilageLecture(0);
+    profilageMesure(PROFILAGE_CHEMIN_TEMPORISATEUR, 0x2000);
+    verifieEgalite("PRFIN01", sondes[PROFILAGE_CHEMIN_TEMPORISATEUR].maximum, 0);
+    profilageFinLecture();
+    profilageMesure(PROFILAGE_CHEMIN_TEMPORISATEUR, 0x2000);
+    verifieEgalite("PRFIN02", sondes[PROFILAGE_CHEMIN_TEMPORISATEUR].maximum, 0x2000);
+}
+
+void testeProfilage() {
+    enregistre_le_minimum_et_le_maximum();
+    classe_les_durees_par_puissances_de_deux();
+    gele_les_mesures_pendant_la_lecture();
+    reprend_apres_une_lecture_interrompue();
+}
+
+#endif
+
+#endif
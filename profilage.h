@@ -0,0 +1,85 @@
+#ifndef PROFILAGE_H
+#define	PROFILAGE_H
+
+/**
+ * Mesure la durée des interruptions, en cycles d'instruction, à l'aide
+ * du temporisateur 5 qui compte librement à Fosc/4.
+ * N'est compilé que si PROFILAGE est défini: les versions de 
+ * production n'en paient pas le coût.
+ * La durée mesurée ne comprend pas la latence d'entrée ni la sauvegarde
+ * du contexte par le compilateur.
+ */
+#ifdef PROFILAGE
+
+/**
+ * Énumère les sondes. Les huit premières correspondent aux chemins
+ * de l'interruption: une combinaison des sources traitées.
+ */
+typedef enum {
+    /** Le chemin est une combinaison de ces trois bits. */
+    PROFILAGE_CHEMIN_TEMPORISATEUR = 1,
+    PROFILAGE_CHEMIN_CONVERSION = 2,
+    PROFILAGE_CHEMIN_I2C = 4,
+    /** Traitement de chaque source de conversion. */
+    PROFILAGE_CONVERSION_ALIMENTATION = 8,
+    PROFILAGE_CONVERSION_BOOST = 9,
+    PROFILAGE_CONVERSION_ACCUMULATEUR = 10,
+    PROFILAGE_CONVERSION_THERMISTANCE = 11,
+    PROFILAGE_CONVERSION_REFERENCE = 12,
+    PROFILAGE_NOMBRE_SONDES = 13
+} ProfilageSonde;
+
+/**
+ * Nombre de classes de l'histogramme. La classe 0 compte les durées
+ * de moins de 64 cycles, chaque classe suivante double la limite, et
+ * la dernière compte les durées de 4096 cycles ou plus.
+ */
+#define PROFILAGE_CLASSES 8
+
+/**
+ * Démarre le temporisateur 5 et réinitialise les sondes.
+ */
+void profilageInitialise();
+
+/**
+ * @return L'instant actuel, en cycles d'instruction.
+ */
+unsigned int profilageInstant();
+
+/**
+ * Enregistre une durée mesurée par une sonde.
+ * @param sonde Voir ProfilageSonde.
+ * @param duree La durée, en cycles d'instruction.
+ */
+void profilageMesure(unsigned char sonde, unsigned int duree);
+
+/**
+ * Enregistre la durée écoulée depuis un instant.
+ * @param sonde Voir ProfilageSonde.
+ * @param debut L'instant du début, obtenu par profilageInstant.
+ */
+void profilageEnregistre(unsigned char sonde, unsigned int debut);
+
+/**
+ * Rend les mesures, octet par octet, pour la lecture I2C à l'adresse 
+ * LECTURE_PROFILAGE. Pour chaque sonde: minimum, maximum, puis les
+ * classes de l'histogramme, en 16 bits, octet le moins signifiant en premier.
+ * Les mesures sont gelées pendant la lecture, jusqu'à profilageFinLecture.
+ * @param premier Différent de 0 pour le premier octet de la lecture.
+ * @return L'octet suivant.
+ */
+unsigned char profilageLecture(unsigned char premier);
+
+/**
+ * La lecture I2C est terminée, complète ou interrompue: les mesures
+ * reprennent.
+ */
+void profilageFinLecture();
+
+#ifdef TEST
+void testeProfilage();
+#endif
+
+#endif
+
+#endif
@@ -0,0 +1,66 @@
+/**
+ * ups-etat: affiche l'état publié par upsd, une valeur par ligne,
+ * sous la forme nom=valeur, facile à exploiter dans un script.
+ * 
+ * Compilation:
+ *     gcc -O2 -Wall -o ups-etat ups-etat.c -lrt
+ * 
+ * Code de retour: 0 si l'UPS répond, 1 s'il est absent, 2 si upsd ne
+ * publie rien ou publie une autre version de UpsEtat.
+ */
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "ups-etat.h"
+
+int main() {
+    const volatile UpsEtat *publication;
+    UpsEtat etat;
+    int fd;
+
+    fd = shm_open(UPS_ETAT_NOM, O_RDONLY, 0);
+    if (fd < 0) {
+        perror(UPS_ETAT_NOM);
+        return 2;
+    }
+    publication = mmap(NULL, sizeof (UpsEtat), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (publication == MAP_FAILED) {
+        perror(UPS_ETAT_NOM);
+        return 2;
+    }
+    if (upsEtatLit(publication, &etat) < 0) {
+        fprintf(stderr, "%s: version %u inconnue\n", UPS_ETAT_NOM, etat.version);
+        return 2;
+    }
+
+    printf("present=%u\n", etat.present);
+    printf("horodatage=%llu\n", (unsigned long long) etat.horodatage);
+    printf("lectures=%u\n", etat.lectures);
+    printf("erreurs=%u\n", etat.erreurs);
+    printf("etat_charge=%u\n", etat.registres[REGISTRE_ETAT_CHARGE]);
+    printf("charge_restante=%u\n", upsRegistre16(&etat, REGISTRE_CHARGE_RESTANTE));
+    printf("courant_moyen=%d\n", (int16_t) upsRegistre16(&etat, REGISTRE_COURANT_MOYEN));
+    printf("minutes_avant_decharge=%u\n", upsRegistre16(&etat, REGISTRE_MINUTES_AVANT_DECHARGE));
+    printf("minutes_avant_charge=%u\n", upsRegistre16(&etat, REGISTRE_MINUTES_AVANT_CHARGE));
+    printf("sante=%u\n", etat.registres[REGISTRE_SANTE]);
+    printf("arret_annonce=%u\n", etat.registres[REGISTRE_ARRET_ANNONCE]);
+    printf("millivolts_alimentation=%u\n", upsRegistre16(&etat, REGISTRE_MILLIVOLTS_ALIMENTATION));
+    printf("millivolts_boost=%u\n", upsRegistre16(&etat, REGISTRE_MILLIVOLTS_BOOST));
+    printf("millivolts_accumulateur=%u\n", upsRegistre16(&etat, REGISTRE_MILLIVOLTS_ACCUMULATEUR));
+    printf("temperature=%d\n", (signed char) etat.registres[REGISTRE_TEMPERATURE]);
+    printf("sonde_defaillante=%u\n", etat.registres[REGISTRE_SONDE_DEFAILLANTE]);
+    printf("heure=%u\n", upsRegistre32(&etat, REGISTRE_HORLOGE));
+    printf("reveil=%u\n", upsRegistre32(&etat, REGISTRE_REVEIL));
+    printf("secondes_secteur=%u\n", upsRegistre32(&etat, REGISTRE_SECONDES_SECTEUR));
+    printf("secondes_accumulateur=%u\n", upsRegistre32(&etat, REGISTRE_SECONDES_ACCUMULATEUR));
+    printf("secondes_charge=%u\n", upsRegistre32(&etat, REGISTRE_SECONDES_CHARGE));
+    printf("mah_fournis=%u\n", upsRegistre32(&etat, REGISTRE_MAH_FOURNIS));
+    printf("defaillances=%u\n", upsRegistre16(&etat, REGISTRE_DEFAILLANCES));
+    printf("cycles=%u\n", upsRegistre16(&etat, REGISTRE_CYCLES));
+    printf("erreur=%u\n", etat.erreur);
+
+    return etat.present ? 0 : 1;
+}
@@ -0,0 +1,92 @@
+/**
+ * État de l'UPS publié par upsd dans une mémoire partagée.
+ * 
+ * upsd est le seul à interroger le bus I2C. Les autres programmes lisent
+ * cet état sans appel système, avec upsEtatLit. Le numéro de séquence
+ * est un verrou de séquence (seqlock): impair pendant une publication,
+ * il change à chaque publication. Un lecteur qui voit la séquence changer
+ * pendant sa copie recommence.
+ */
+#ifndef UPS_ETAT_H
+#define	UPS_ETAT_H
+
+#include <stdint.h>
+#include <string.h>
+#include "../i2c.h"
+
+/** Nom de la mémoire partagée (voir shm_open). */
+#define UPS_ETAT_NOM "/ups-etat"
+
+/** Version de la structure UpsEtat. Change si sa disposition change. */
+#define UPS_ETAT_VERSION 6
+
+/**
+ * Adresse I2C de 7 bits d'une adresse de l'esclave (voir I2cAdresse).
+ * L'esclave répond aux adresses 0x08 à 0x0F, selon l'adresse locale.
+ */
+#define UPS_ADRESSE(a) (0x08 | ((a) & I2C_MASQUE_ADRESSES_LOCALES))
+
+typedef struct {
+    /** Verrou de séquence. Impair pendant une publication. */
+    uint32_t sequence;
+    /** UPS_ETAT_VERSION. */
+    uint16_t version;
+    /** Taille de la structure, en octets. */
+    uint16_t taille;
+    /** Heure de la dernière lecture réussie, en ms depuis l'époque. */
+    uint64_t horodatage;
+    /** Nombre de lectures réussies. */
+    uint32_t lectures;
+    /** Nombre de lectures en erreur. */
+    uint32_t erreurs;
+    /** 1 si la dernière lecture a réussi. */
+    uint8_t present;
+    /** Dernières valeurs lues aux adresses LECTURE_ALIMENTATION à LECTURE_ERREUR. */
+    uint8_t alimentation;
+    uint8_t boost;
+    uint8_t accumulateur;
+    uint8_t erreur;
+    /** Copie des registres de l'adresse REGISTRES (voir I2cRegistre). */
+    uint8_t registres[I2C_NOMBRE_REGISTRES];
+} UpsEtat;
+
+/**
+ * @return La valeur de 16 bits d'un registre.
+ */
+static inline uint16_t upsRegistre16(const UpsEtat *etat, int registre) {
+    return (uint16_t) (etat->registres[registre] | (etat->registres[registre + 1] << 8));
+}
+
+/**
+ * @return La valeur de 32 bits d'un registre.
+ */
+static inline uint32_t upsRegistre32(const UpsEtat *etat, int registre) {
+    return upsRegistre16(etat, registre) | ((uint32_t) upsRegistre16(etat, registre + 2) << 16);
+}
+
+/**
+ * Copie l'état publié, de façon cohérente.
+ * @param publie L'état en mémoire partagée.
+ * @param copie La copie.
+ * @return 0 si la copie est cohérente, -1 si la version ne correspond pas.
+ */
+static inline int upsEtatLit(const volatile UpsEtat *publie, UpsEtat *copie) {
+    uint32_t avant, apres;
+    
+    do {
+        avant = __atomic_load_n(&publie->sequence, __ATOMIC_ACQUIRE);
+        if (avant & 1) {
+            continue;
+        }
+        memcpy(copie, (const void *) publie, sizeof(UpsEtat));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        apres = __atomic_load_n(&publie->sequence, __ATOMIC_RELAXED);
+    } while ((avant & 1) || (avant != apres));
+
+    if ((copie->version != UPS_ETAT_VERSION) || (copie->taille != sizeof(UpsEtat))) {
+        return -1;
+    }
+    return 0;
+}
+
+#endif
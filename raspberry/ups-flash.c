@@ -0,0 +1,547 @@
+/**
+ * ups-flash: met à jour le micrologiciel de l'UPS par I2C (voir
+ * demarreur.h).
+ *
+ * Le fichier est le .hex produit par MPLAB X pour les configurations
+ * default ou nimh, compilées pour l'emplacement A (décalage de 0x1000).
+ * Les bits de configuration et les données EEPROM qu'il contient sont
+ * ignorés: ceux du démarreur s'appliquent.
+ *
+ * ups-flash demande à l'UPS de redémarrer dans le démarreur, envoie le
+ * micrologiciel rangée par rangée dans l'emplacement B, demande au
+ * démarreur de le vérifier et de l'échanger avec l'emplacement A, puis
+ * de le démarrer à l'essai. Une rangée dont le CRC est faux est renvoyée.
+ * Si la mise à jour est interrompue, le démarreur garde l'ancien
+ * micrologiciel, ou reste en attente d'une nouvelle tentative. Si le
+ * nouveau micrologiciel ne confirme pas son démarrage, le démarreur
+ * rétablit l'ancien.
+ *
+ * upsd doit être arrêté pendant la mise à jour: il est le seul maître
+ * du bus. Le raspberry reste alimenté par l'UPS: le démarreur maintient
+ * l'alimentation.
+ *
+ * Compilation, sur le raspberry ou sur n'importe quel Linux:
+ *     gcc -O2 -Wall -o ups-flash ups-flash.c
+ *
+ * Essai sans UPS, avec le démarreur compilé pour le PC. Sans fichier,
+ * une image aléatoire est envoyée. Après l'envoi, un démarrage non
+ * confirmé, un échange interrompu et une rangée corrompue sont simulés:
+ *     gcc -O2 -Wall -DDEMARREUR_SIMULATION -o ups-flash-simulation ups-flash.c
+ *     ./ups-flash-simulation [fichier.hex]
+ *
+ * Utilisation: ups-flash [-b bus] [-n version] [-P] [-v] fichier.hex
+ *     -b bus        Bus I2C (défaut: /dev/i2c-1).
+ *     -n version    Version inscrite dans le descripteur (défaut: 0).
+ *     -P            L'UPS est en mode PEC: la demande de mise à jour est
+ *                   suivie de son PEC. Le démarreur n'utilise pas le PEC.
+ *     -v            Affiche chaque rangée envoyée.
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+
+#include "ups-etat.h"
+#include "../demarreur.h"
+
+/** Nombre d'envois d'une commande avant d'abandonner. */
+#define TENTATIVES 3
+
+/** Attente après une écriture de rangée: effacement et écriture. */
+#define PAUSE_ECRITURE_US 10000
+
+/** Attente après la validation: vérification et échange des emplacements. */
+#define PAUSE_VALIDATION_US 8000000
+
+/** Attente du redémarrage dans le démarreur. */
+#define PAUSE_REDEMARRAGE_US 1000000
+
+typedef struct {
+    const char *bus;
+    unsigned int version;
+    int pec;
+    int bavard;
+} Configuration;
+
+static Configuration configuration = {
+    "/dev/i2c-1", 0, 0, 0
+};
+
+/** Micrologiciel, depuis DEMARREUR_EMPLACEMENT_A. */
+static uint8_t micrologiciel[DEMARREUR_TAILLE_IMAGE];
+
+/** Taille du micrologiciel, arrondie à la rangée. */
+static unsigned int taille;
+
+static uint16_t crcOctet(uint16_t crc, uint8_t octet) {
+    int n;
+
+    crc ^= (uint16_t) octet << 8;
+    for (n = 0; n < 8; n++) {
+        crc = (crc & 0x8000) ? (uint16_t) ((crc << 1) ^ DEMARREUR_CRC_POLYNOME) : (uint16_t) (crc << 1);
+    }
+    return crc;
+}
+
+static int hexa(const char *texte, int chiffres) {
+    char tampon[5];
+    char *fin;
+    long valeur;
+
+    memcpy(tampon, texte, chiffres);
+    tampon[chiffres] = 0;
+    valeur = strtol(tampon, &fin, 16);
+    return *fin ? -1 : (int) valeur;
+}
+
+/**
+ * Lit un fichier Intel HEX. Seules les données de l'emplacement A sont
+ * retenues; les bits de configuration (0x300000) et l'EEPROM (0xF00000)
+ * sont ignorés.
+ * @return 0 si le fichier est lisible et compilé pour le démarreur.
+ */
+static int litHex(const char *nom) {
+    char ligne[600];
+    unsigned long base = 0, adresse;
+    int longueur, type, somme, octet, n, numero = 0;
+    FILE *fichier;
+
+    fichier = fopen(nom, "r");
+    if (fichier == NULL) {
+        perror(nom);
+        return -1;
+    }
+    memset(micrologiciel, 0xFF, sizeof (micrologiciel));
+    taille = 0;
+    while (fgets(ligne, sizeof (ligne), fichier) != NULL) {
+        numero++;
+        if (ligne[0] != ':' || strlen(ligne) < 11) {
+            continue;
+        }
+        longueur = hexa(ligne + 1, 2);
+        if (longueur < 0 || strlen(ligne) < (size_t) (11 + 2 * longueur)) {
+            break;
+        }
+        adresse = base + hexa(ligne + 3, 4);
+        type = hexa(ligne + 7, 2);
+        somme = longueur + hexa(ligne + 3, 2) + hexa(ligne + 5, 2) + type;
+        for (n = 0; n <= longueur; n++) {
+            octet = hexa(ligne + 9 + 2 * n, 2);
+            if (octet < 0) {
+                break;
+            }
+            somme += octet;
+            if (type == 0 && n < longueur && adresse + n < 0x300000) {
+                if (adresse + n < DEMARREUR_EMPLACEMENT_A
+                        || adresse + n >= DEMARREUR_EMPLACEMENT_A + DEMARREUR_TAILLE_IMAGE) {
+                    fprintf(stderr, "%s:%d: adresse 0x%lX hors de l'emplacement A "
+                            "(compiler avec un décalage de 0x%X)\n",
+                            nom, numero, adresse + n, DEMARREUR_APPLICATION);
+                    fclose(fichier);
+                    return -1;
+                }
+                micrologiciel[adresse + n - DEMARREUR_EMPLACEMENT_A] = octet;
+                if (adresse + n - DEMARREUR_EMPLACEMENT_A >= taille) {
+                    taille = adresse + n - DEMARREUR_EMPLACEMENT_A + 1;
+                }
+            }
+        }
+        if (n <= longueur || (somme & 0xFF)) {
+            fprintf(stderr, "%s:%d: ligne invalide\n", nom, numero);
+            fclose(fichier);
+            return -1;
+        }
+        if (type == 1) {
+            fclose(fichier);
+            taille = (taille + DEMARREUR_TAILLE_RANGEE - 1) / DEMARREUR_TAILLE_RANGEE * DEMARREUR_TAILLE_RANGEE;
+            if (taille == 0) {
+                fprintf(stderr, "%s: aucune donnée\n", nom);
+                return -1;
+            }
+            return 0;
+        }
+        if (type == 4) {
+            base = (unsigned long) hexa(ligne + 9, 4) << 16;
+        }
+    }
+    fprintf(stderr, "%s: fin de fichier absente\n", nom);
+    fclose(fichier);
+    return -1;
+}
+
+#ifndef DEMARREUR_SIMULATION
+
+static int fd;
+
+/**
+ * Transfert SMBus, comme i2c_smbus_access de i2c-tools.
+ */
+static int smbus(char lecture, uint8_t commande, int taille, union i2c_smbus_data *donnees) {
+    struct i2c_smbus_ioctl_data arguments;
+
+    arguments.read_write = lecture;
+    arguments.command = commande;
+    arguments.size = taille;
+    arguments.data = donnees;
+    return ioctl(fd, I2C_SMBUS, &arguments);
+}
+
+static int ouvreBus() {
+    fd = open(configuration.bus, O_RDWR);
+    if (fd < 0 || ioctl(fd, I2C_SLAVE, UPS_ADRESSE(REGISTRES)) < 0) {
+        perror(configuration.bus);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Demande au micrologiciel de redémarrer dans le démarreur.
+ */
+static int demandeMiseAJour() {
+    union i2c_smbus_data donnees;
+    int resultat;
+
+    if (configuration.pec && ioctl(fd, I2C_PEC, 1) < 0) {
+        return -1;
+    }
+    donnees.byte = DEMARREUR_DEMANDE;
+    resultat = smbus(I2C_SMBUS_WRITE, REGISTRE_MISE_A_JOUR, I2C_SMBUS_BYTE_DATA, &donnees);
+    ioctl(fd, I2C_PEC, 0);
+    return resultat;
+}
+
+static int envoie(const uint8_t *octets, int longueur) {
+    return write(fd, octets, longueur) == longueur ? 0 : -1;
+}
+
+/**
+ * Lit l'état du démarreur. Le démarreur étire l'horloge tant que la
+ * commande n'est pas terminée.
+ */
+static int recoit(uint8_t *reponse) {
+    return read(fd, reponse, 1) == 1 ? 0 : -1;
+}
+
+static void attends(useconds_t duree) {
+    usleep(duree);
+}
+
+#else
+
+#include "../demarreur/demarreur.c"
+
+/** EEPROM simulée. */
+static unsigned char eeprom[256];
+
+unsigned char eepromLit(unsigned char adresse) {
+    return eeprom[adresse];
+}
+
+unsigned char eepromEcrit(unsigned char adresse, unsigned char valeur) {
+    eeprom[adresse] = valeur;
+    return 255;
+}
+
+unsigned char eepromOccupee() {
+    return 0;
+}
+
+static int ouvreBus() {
+    memset(flash, 0xFF, sizeof (flash));
+    memset(eeprom, 0xFF, sizeof (eeprom));
+    return 0;
+}
+
+static int demandeMiseAJour() {
+    eeprom[EEPROM_DEMARREUR] = DEMARREUR_DEMANDE;
+    return 0;
+}
+
+/** Octet d'adresse du démarreur sur le bus, sans le bit R/W. */
+#define OCTET_ADRESSE (UPS_ADRESSE(REGISTRES) << 1)
+
+/**
+ * Écriture vue par l'automate esclave: adresse, octets, puis STOP.
+ */
+static int envoie(const uint8_t *octets, int longueur) {
+    unsigned char emission;
+    int n;
+
+    i2cAutomate(STATUT_BF, OCTET_ADRESSE, 255, &emission);
+    for (n = 0; n < longueur; n++) {
+        i2cAutomate(STATUT_DA | STATUT_BF, octets[n], 255, &emission);
+    }
+    i2cAutomate(STATUT_P, 0, 0, &emission);
+    return 0;
+}
+
+/**
+ * Lecture vue par l'automate esclave: adresse, l'état émis, puis le NACK
+ * du maître (R/W à 0, BF à 0, SSP1BUF contient encore l'état) et STOP.
+ */
+static int recoit(uint8_t *reponse) {
+    unsigned char emission = 0;
+
+    if (i2cAutomate(STATUT_RW | STATUT_BF, OCTET_ADRESSE | 1, 255, &emission) != DEMARREUR_I2C_EMET) {
+        return -1;
+    }
+    *reponse = emission;
+    i2cAutomate(STATUT_DA, emission, 0, &emission);
+    i2cAutomate(STATUT_P, 0, 0, &emission);
+    return 0;
+}
+
+static void attends(useconds_t duree) {
+    (void) duree;
+}
+
+#endif
+
+/**
+ * Envoie une commande et lit son état, en la renvoyant si le transfert
+ * échoue ou si le démarreur signale un CRC faux.
+ * @return L'état, voir DemarreurEtat, ou -1.
+ */
+static int execute(const uint8_t *octets, int longueur, useconds_t pause) {
+    uint8_t reponse;
+    int tentative, resultat = -1;
+
+    for (tentative = 0; tentative < TENTATIVES; tentative++) {
+        if (envoie(octets, longueur) < 0) {
+            continue;
+        }
+        attends(pause);
+        if (recoit(&reponse) < 0) {
+            continue;
+        }
+        resultat = reponse;
+        if (resultat != DEMARREUR_ERREUR_CRC) {
+            break;
+        }
+    }
+    return resultat;
+}
+
+/**
+ * Prépare une commande DEMARREUR_ECRIT: position, données et CRC.
+ */
+static void prepareRangee(uint8_t *commande, unsigned int position, const uint8_t *donnees) {
+    uint16_t crc = DEMARREUR_CRC_INITIAL;
+    int n;
+
+    commande[0] = DEMARREUR_ECRIT;
+    commande[1] = (uint8_t) position;
+    commande[2] = (uint8_t) (position >> 8);
+    memcpy(commande + 3, donnees, DEMARREUR_TAILLE_RANGEE);
+    for (n = 1; n < 3 + DEMARREUR_TAILLE_RANGEE; n++) {
+        crc = crcOctet(crc, commande[n]);
+    }
+    commande[n] = (uint8_t) crc;
+    commande[n + 1] = (uint8_t) (crc >> 8);
+}
+
+static int envoieRangee(unsigned int position) {
+    uint8_t commande[DEMARREUR_TAILLE_COMMANDE];
+
+    prepareRangee(commande, position, micrologiciel + position);
+    return execute(commande, sizeof (commande), PAUSE_ECRITURE_US);
+}
+
+static int valide() {
+    uint8_t commande[7];
+    uint16_t crc = DEMARREUR_CRC_INITIAL;
+    unsigned int n;
+
+    for (n = 0; n < taille; n++) {
+        crc = crcOctet(crc, micrologiciel[n]);
+    }
+    commande[0] = DEMARREUR_VALIDE;
+    commande[1] = (uint8_t) taille;
+    commande[2] = (uint8_t) (taille >> 8);
+    commande[3] = (uint8_t) crc;
+    commande[4] = (uint8_t) (crc >> 8);
+    commande[5] = (uint8_t) configuration.version;
+    commande[6] = (uint8_t) (configuration.version >> 8);
+    return execute(commande, sizeof (commande), PAUSE_VALIDATION_US);
+}
+
+/**
+ * Envoie le micrologiciel.
+ * @return 0 si il est vérifié, échangé avec l'emplacement A et démarré.
+ */
+static int metAJour() {
+    uint8_t commande = DEMARREUR_DEMARRE;
+    unsigned int position;
+    int etat;
+
+    if (demandeMiseAJour() < 0) {
+        // Peut-être déjà dans le démarreur:
+        fprintf(stderr, "Demande de mise à jour: %s\n", strerror(errno));
+    }
+    attends(PAUSE_REDEMARRAGE_US);
+
+    for (position = 0; position < taille; position += DEMARREUR_TAILLE_RANGEE) {
+        etat = envoieRangee(position);
+        if (configuration.bavard) {
+            printf("0x%04X: %d\n", DEMARREUR_EMPLACEMENT_B + position, etat);
+        }
+        if (etat != DEMARREUR_PRET) {
+            fprintf(stderr, "Rangée 0x%04X: état %d\n", position, etat);
+            return -1;
+        }
+    }
+    etat = valide();
+    if (etat != DEMARREUR_VALIDE_ET_COPIE) {
+        fprintf(stderr, "Validation: état %d\n", etat);
+        return -1;
+    }
+    if (envoie(&commande, 1) < 0) {
+        fprintf(stderr, "Démarrage: %s\n", strerror(errno));
+        return -1;
+    }
+    printf("%u octets, version %u\n", taille, configuration.version);
+    return 0;
+}
+
+#ifdef DEMARREUR_SIMULATION
+
+static int echecs = 0;
+
+static void verifie(const char *nom, int condition) {
+    printf("%s: %s\n", nom, condition ? "ok" : "ÉCHEC");
+    if (!condition) {
+        echecs++;
+    }
+}
+
+/** Version précédente, pour vérifier qu'elle est rétablie. */
+static uint8_t ancien[DEMARREUR_TAILLE_IMAGE];
+
+/**
+ * Vérifie l'envoi, le rétablissement de l'ancienne version, la reprise
+ * d'un échange interrompu, le rejet d'une rangée corrompue et le NACK
+ * qui termine une lecture de l'état.
+ */
+static int verifieSimulation() {
+    uint8_t commande[DEMARREUR_TAILLE_COMMANDE];
+    unsigned int n;
+
+    verifie("FLASH01", demarre);
+    verifie("FLASH02", memcmp(flash + DEMARREUR_EMPLACEMENT_A, micrologiciel, taille) == 0);
+    verifie("FLASH03", eeprom[EEPROM_DEMARREUR] == DEMARREUR_LANCE);
+    verifie("FLASH04", emplacementValide(DEMARREUR_EMPLACEMENT_A));
+
+    // Le micrologiciel confirme son démarrage, puis une nouvelle version
+    // est envoyée, mais ne confirme pas le sien:
+    eeprom[EEPROM_DEMARREUR] = 0xFF;
+    memcpy(ancien, micrologiciel, taille);
+    for (n = 0; n < taille; n += 3) {
+        micrologiciel[n] ^= 0x5A;
+    }
+    verifie("FLASH05", metAJour() == 0
+            && memcmp(flash + DEMARREUR_EMPLACEMENT_A, micrologiciel, taille) == 0
+            && eeprom[EEPROM_DEMARREUR] == DEMARREUR_LANCE);
+    demarre = 0;
+    lancement();
+    verifie("FLASH06", demarre
+            && memcmp(flash + DEMARREUR_EMPLACEMENT_A, ancien, taille) == 0
+            && emplacementValide(DEMARREUR_EMPLACEMENT_A)
+            && eeprom[EEPROM_DEMARREUR] == 0xFF);
+
+    // Coupure au milieu de l'échange: il reprend au démarrage suivant.
+    rangeesAvantCoupure = taille / DEMARREUR_TAILLE_RANGEE + 1 + 40;
+    verifie("FLASH07", metAJour() < 0 && eeprom[EEPROM_DEMARREUR] == DEMARREUR_ECHANGE
+            && !emplacementValide(DEMARREUR_EMPLACEMENT_A));
+    rangeesAvantCoupure = -1;
+    demarre = 0;
+    lancement();
+    verifie("FLASH08", demarre
+            && memcmp(flash + DEMARREUR_EMPLACEMENT_A, micrologiciel, taille) == 0
+            && eeprom[EEPROM_DEMARREUR] == DEMARREUR_LANCE);
+
+    // Coupure pendant le rétablissement: aucun micrologiciel valide, rien
+    // ne démarre, puis le rétablissement reprend.
+    rangeesAvantCoupure = 20;
+    demarre = 0;
+    lancement();
+    verifie("FLASH09", !demarre && !emplacementValide(DEMARREUR_EMPLACEMENT_A));
+    rangeesAvantCoupure = -1;
+    lancement();
+    verifie("FLASH10", demarre && memcmp(flash + DEMARREUR_EMPLACEMENT_A, ancien, taille) == 0);
+
+    // Rangée corrompue, position hors de l'emplacement, commande inconnue:
+    prepareRangee(commande, 0, micrologiciel);
+    commande[10] ^= 1;
+    verifie("FLASH11", execute(commande, sizeof (commande), 0) == DEMARREUR_ERREUR_CRC);
+    prepareRangee(commande, DEMARREUR_TAILLE_IMAGE, micrologiciel);
+    verifie("FLASH12", execute(commande, sizeof (commande), 0) == DEMARREUR_ERREUR_POSITION);
+    prepareRangee(commande, 1, micrologiciel);
+    verifie("FLASH13", execute(commande, sizeof (commande), 0) == DEMARREUR_ERREUR_POSITION);
+    commande[0] = 9;
+    verifie("FLASH14", execute(commande, 1, 0) == DEMARREUR_ERREUR_COMMANDE);
+    verifie("FLASH15", execute(commande, DEMARREUR_TAILLE_COMMANDE + 5, 0) == DEMARREUR_ERREUR_COMMANDE);
+
+    // Le NACK qui termine une lecture de l'état n'est pas une commande,
+    // même si l'état vaut DEMARREUR_DEMARRE:
+    etat = DEMARREUR_ERREUR_ECRITURE;
+    demarre = 0;
+    verifie("FLASH16", recoit(commande) == 0 && commande[0] == DEMARREUR_ERREUR_ECRITURE);
+    verifie("FLASH17", !demarre && etat == DEMARREUR_ERREUR_ECRITURE);
+
+    printf("%d échec(s)\n", echecs);
+    return echecs ? 1 : 0;
+}
+
+#endif
+
+static void utilisation(const char *programme) {
+    fprintf(stderr, "Utilisation: %s [-b bus] [-n version] [-P] [-v] fichier.hex\n", programme);
+    exit(2);
+}
+
+int main(int argc, char **argv) {
+    int option;
+
+    while ((option = getopt(argc, argv, "b:n:Pv")) != -1) {
+        switch (option) {
+            case 'b': configuration.bus = optarg; break;
+            case 'n': configuration.version = atoi(optarg); break;
+            case 'P': configuration.pec = 1; break;
+            case 'v': configuration.bavard = 1; break;
+            default: utilisation(argv[0]);
+        }
+    }
+#ifndef DEMARREUR_SIMULATION
+    if (optind != argc - 1) {
+        utilisation(argv[0]);
+    }
+#else
+    if (optind == argc) {
+        unsigned int n;
+        srand(1);
+        taille = DEMARREUR_TAILLE_IMAGE / 2 / DEMARREUR_TAILLE_RANGEE * DEMARREUR_TAILLE_RANGEE;
+        memset(micrologiciel, 0xFF, sizeof (micrologiciel));
+        for (n = 0; n < taille; n++) {
+            micrologiciel[n] = (uint8_t) rand();
+        }
+    } else
+#endif
+    if (litHex(argv[optind]) < 0) {
+        return 1;
+    }
+    if (ouvreBus() < 0 || metAJour() < 0) {
+        return 1;
+    }
+#ifdef DEMARREUR_SIMULATION
+    return verifieSimulation();
+#else
+    return 0;
+#endif
+}
@@ -0,0 +1,630 @@
+/**
+ * upsd: seul maître du bus I2C côté raspberry.
+ * 
+ * Interroge l'UPS aux adresses de i2c.h et publie son état dans la
+ * mémoire partagée UPS_ETAT_NOM (voir ups-etat.h), pour un nombre 
+ * quelconque de lecteurs. Le rythme d'interrogation est lent sur secteur,
+ * rapide sur accumulateur et après chaque changement.
+ * Quand l'accumulateur est presque vide, upsd annonce l'arrêt à l'UPS
+ * (REGISTRE_ARRET_ANNONCE) puis exécute la commande d'arrêt.
+ * Quand l'heure du système est synchronisée (NTP), upsd règle l'horloge
+ * de l'UPS sur l'heure Unix (REGISTRE_HORLOGE), ce qui permet aussi à
+ * l'UPS de corriger la durée de son sommeil (voir horloge.h).
+ * 
+ * Compilation, sur le raspberry ou sur n'importe quel Linux:
+ *     gcc -O2 -Wall -o upsd upsd.c -lrt
+ * 
+ * Essai sans UPS, avec i2c-stub (l'UPS répond aux adresses 0x08 à 0x0F):
+ *     modprobe i2c-dev
+ *     modprobe i2c-stub chip_addr=0x08,0x0c,0x0d,0x0e,0x0f
+ *     i2cset -y N 0x08 5 0x0a     # N: numéro du bus i2c-stub (i2cdetect -l)
+ *     ./upsd -b /dev/i2c-N -v
+ * 
+ * Essai avec un périphérique simulé: -i fichier lit à chaque interrogation
+ * une image de l'UPS, 4 octets pour les adresses LECTURE_ALIMENTATION à
+ * LECTURE_ERREUR suivis des I2C_NOMBRE_REGISTRES registres. Un simulateur
+ * (par exemple la compilation hôte du micrologiciel) la réécrit à volonté;
+ * l'annonce d'arrêt est écrite à sa place dans l'image.
+ * 
+ * Options:
+ *     -b bus        Bus I2C (défaut: /dev/i2c-1).
+ *     -i image      Image d'un UPS simulé, au lieu du bus.
+ *     -l secondes   Intervalle d'interrogation sur secteur (défaut: 5).
+ *     -r secondes   Intervalle d'interrogation sur accumulateur (défaut: 1).
+ *     -m minutes    Autonomie restante qui déclenche l'arrêt (défaut: 5).
+ *     -c pourcent   État de charge qui déclenche l'arrêt (défaut: 10).
+ *     -a secondes   Délai annoncé à l'UPS avant la coupure (défaut: 60).
+ *     -x commande   Commande d'arrêt (défaut: "/sbin/shutdown -h now").
+ *     -e commande   Commande appelée à chaque événement, avec l'événement en
+ *                   argument: defaillance, retour, arret, absent, present.
+ *     -P            Active le mode PEC de l'UPS: chaque lecture et chaque
+ *                   écriture est vérifiée par un CRC. Les registres sont
+ *                   alors lus mot par mot.
+ *     -v            Affiche chaque interrogation.
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syslog.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/timex.h>
+#include <sys/wait.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+
+#include "ups-etat.h"
+
+/** Nombre d'interrogations rapides après un changement. */
+#define INTERROGATIONS_RAPIDES_APRES_CHANGEMENT 10
+
+/** Nombre d'échecs consécutifs avant de considérer l'UPS absent. */
+#define ECHECS_AVANT_ABSENCE 3
+
+/** Écart toléré entre l'horloge de l'UPS et celle du système, en secondes. */
+#define ECART_HORLOGE_MAXIMUM 2
+
+/** Taille maximum d'un bloc SMBus. */
+#define TAILLE_BLOC 32
+
+/** Taille de l'image d'un UPS simulé. */
+#define TAILLE_IMAGE (4 + I2C_NOMBRE_REGISTRES)
+
+typedef struct {
+    const char *bus;
+    const char *image;
+    unsigned int intervalleLent;
+    unsigned int intervalleRapide;
+    unsigned int minutesArret;
+    unsigned int chargeArret;
+    unsigned int delaiAnnonce;
+    const char *commandeArret;
+    const char *commandeEvenement;
+    int pec;
+    int bavard;
+} Configuration;
+
+static Configuration configuration = {
+    "/dev/i2c-1", NULL, 5, 1, 5, 10, 60, "/sbin/shutdown -h now", NULL, 0, 0
+};
+
+static volatile sig_atomic_t termine = 0;
+
+static void interromps(int signal) {
+    (void) signal;
+    termine = 1;
+}
+
+/** Heure courante, en ms depuis l'époque. */
+static uint64_t maintenant() {
+    struct timespec t;
+    clock_gettime(CLOCK_REALTIME, &t);
+    return (uint64_t) t.tv_sec * 1000 + t.tv_nsec / 1000000;
+}
+
+/**
+ * Transfert SMBus, comme i2c_smbus_access de i2c-tools.
+ */
+static int smbus(int fd, char lecture, uint8_t commande, int taille, union i2c_smbus_data *donnees) {
+    struct i2c_smbus_ioctl_data arguments;
+
+    arguments.read_write = lecture;
+    arguments.command = commande;
+    arguments.size = taille;
+    arguments.data = donnees;
+    return ioctl(fd, I2C_SMBUS, &arguments);
+}
+
+static int choisitEsclave(int fd, I2cAdresse adresse) {
+    return ioctl(fd, I2C_SLAVE, UPS_ADRESSE(adresse));
+}
+
+/**
+ * Lit un octet à une adresse de lecture simple.
+ */
+static int litValeur(int fd, I2cAdresse adresse, uint8_t *valeur) {
+    union i2c_smbus_data donnees;
+
+    if (choisitEsclave(fd, adresse) < 0) {
+        return -1;
+    }
+    if (smbus(fd, I2C_SMBUS_READ, 0, I2C_SMBUS_BYTE, &donnees) < 0) {
+        return -1;
+    }
+    *valeur = donnees.byte;
+    return 0;
+}
+
+/**
+ * Lit tous les registres, par blocs: le numéro de registre est écrit,
+ * puis chaque octet lu le fait avancer.
+ */
+static int litRegistres(int fd, uint8_t *registres) {
+    union i2c_smbus_data donnees;
+    int registre, taille;
+
+    if (choisitEsclave(fd, REGISTRES) < 0) {
+        return -1;
+    }
+    for (registre = 0; registre < I2C_NOMBRE_REGISTRES; registre += taille) {
+        taille = I2C_NOMBRE_REGISTRES - registre;
+        if (taille > TAILLE_BLOC) {
+            taille = TAILLE_BLOC;
+        }
+        donnees.block[0] = taille;
+        if (smbus(fd, I2C_SMBUS_READ, registre, I2C_SMBUS_I2C_BLOCK_DATA, &donnees) < 0) {
+            return -1;
+        }
+        if (donnees.block[0] != taille) {
+            errno = EIO;
+            return -1;
+        }
+        memcpy(registres + registre, donnees.block + 1, taille);
+    }
+    return 0;
+}
+
+/** Registres de 32 bits, lus en deux mots en mode PEC. */
+static const I2cRegistre registres32[] = {
+    REGISTRE_HORLOGE, REGISTRE_REVEIL, REGISTRE_SECONDES_SECTEUR,
+    REGISTRE_SECONDES_ACCUMULATEUR, REGISTRE_SECONDES_CHARGE, REGISTRE_MAH_FOURNIS
+};
+
+/** Nombre de relectures d'un registre de 32 bits avant d'abandonner. */
+#define RELECTURES_32_BITS 3
+
+/**
+ * Lit un mot de 16 bits suivi de son PEC (SMBus Read Word).
+ */
+static int litMot(int fd, int registre, uint16_t *mot) {
+    union i2c_smbus_data donnees;
+
+    if (smbus(fd, I2C_SMBUS_READ, registre, I2C_SMBUS_WORD_DATA, &donnees) < 0) {
+        return -1;
+    }
+    *mot = donnees.word;
+    return 0;
+}
+
+/**
+ * Relit un registre de 32 bits en mode PEC. Chaque Read Word copie à
+ * nouveau les registres figés: le mot de poids faible est relu entre
+ * deux lectures du mot de poids fort, jusqu'à ce que celui-ci soit
+ * stable.
+ */
+static int litRegistre32ParMots(int fd, int registre, uint8_t *registres) {
+    uint16_t haut, bas, verification;
+    int relecture;
+
+    if (litMot(fd, registre + 2, &haut) < 0) {
+        return -1;
+    }
+    for (relecture = 0; relecture < RELECTURES_32_BITS; relecture++) {
+        if (litMot(fd, registre, &bas) < 0 || litMot(fd, registre + 2, &verification) < 0) {
+            return -1;
+        }
+        if (verification == haut) {
+            registres[registre] = (uint8_t) bas;
+            registres[registre + 1] = (uint8_t) (bas >> 8);
+            registres[registre + 2] = (uint8_t) haut;
+            registres[registre + 3] = (uint8_t) (haut >> 8);
+            return 0;
+        }
+        haut = verification;
+    }
+    errno = EAGAIN;
+    return -1;
+}
+
+/**
+ * Lit tous les registres en mode PEC: le PEC suit chaque mot de 16 bits
+ * (SMBus Read Word), et est vérifié par le noyau. Les registres de 32
+ * bits sont relus jusqu'à être cohérents.
+ */
+static int litRegistresParMots(int fd, uint8_t *registres) {
+    uint16_t mot;
+    int registre;
+    unsigned int n;
+
+    if (choisitEsclave(fd, REGISTRES) < 0) {
+        return -1;
+    }
+    for (registre = 0; registre < I2C_NOMBRE_REGISTRES; registre += 2) {
+        if (litMot(fd, registre, &mot) < 0) {
+            return -1;
+        }
+        registres[registre] = (uint8_t) mot;
+        if (registre + 1 < I2C_NOMBRE_REGISTRES) {
+            registres[registre + 1] = (uint8_t) (mot >> 8);
+        }
+    }
+    for (n = 0; n < sizeof (registres32) / sizeof (registres32[0]); n++) {
+        if (litRegistre32ParMots(fd, registres32[n], registres) < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int ecritRegistre(int fd, I2cRegistre registre, uint8_t valeur) {
+    union i2c_smbus_data donnees;
+
+    if (choisitEsclave(fd, REGISTRES) < 0) {
+        return -1;
+    }
+    donnees.byte = valeur;
+    return smbus(fd, I2C_SMBUS_WRITE, registre, I2C_SMBUS_BYTE_DATA, &donnees);
+}
+
+/**
+ * Interroge l'UPS sur le bus.
+ * @return 0 si toutes les lectures ont réussi.
+ */
+static int interrogeBus(int fd, UpsEtat *etat) {
+    if (litValeur(fd, LECTURE_ALIMENTATION, &etat->alimentation) < 0
+            || litValeur(fd, LECTURE_BOOST, &etat->boost) < 0
+            || litValeur(fd, LECTURE_ACCUMULATEUR, &etat->accumulateur) < 0
+            || litValeur(fd, LECTURE_ERREUR, &etat->erreur) < 0) {
+        return -1;
+    }
+    if (configuration.pec) {
+        return litRegistresParMots(fd, etat->registres);
+    }
+    return litRegistres(fd, etat->registres);
+}
+
+/**
+ * Lit l'image d'un UPS simulé.
+ * @return 0 si l'image est complète.
+ */
+static int interrogeImage(UpsEtat *etat) {
+    uint8_t image[TAILLE_IMAGE];
+    ssize_t lu;
+    int fd;
+
+    fd = open(configuration.image, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    lu = read(fd, image, sizeof (image));
+    close(fd);
+    if (lu != sizeof (image)) {
+        errno = EIO;
+        return -1;
+    }
+    etat->alimentation = image[0];
+    etat->boost = image[1];
+    etat->accumulateur = image[2];
+    etat->erreur = image[3];
+    memcpy(etat->registres, image + 4, I2C_NOMBRE_REGISTRES);
+    return 0;
+}
+
+static int ecritImage(I2cRegistre registre, uint8_t valeur) {
+    int fd, resultat;
+
+    fd = open(configuration.image, O_WRONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    resultat = pwrite(fd, &valeur, 1, 4 + registre) == 1 ? 0 : -1;
+    close(fd);
+    return resultat;
+}
+
+/**
+ * Règle l'horloge de l'UPS sur l'heure Unix, si l'heure du système est
+ * synchronisée et que l'écart dépasse ECART_HORLOGE_MAXIMUM. L'octet le
+ * plus signifiant est écrit en dernier.
+ */
+static void regleHorloge(int fd, const UpsEtat *etat) {
+    struct timex synchronisation;
+    uint32_t heure = (uint32_t) time(NULL);
+    int64_t ecart;
+    int n, resultat = 0;
+
+    memset(&synchronisation, 0, sizeof (synchronisation));
+    if (adjtimex(&synchronisation) == TIME_ERROR) {
+        return;
+    }
+    ecart = (int64_t) heure - upsRegistre32(etat, REGISTRE_HORLOGE);
+    if (ecart <= ECART_HORLOGE_MAXIMUM && ecart >= -ECART_HORLOGE_MAXIMUM) {
+        return;
+    }
+    for (n = 0; n < 4 && resultat == 0; n++) {
+        if (configuration.image) {
+            resultat = ecritImage(REGISTRE_HORLOGE + n, (uint8_t) (heure >> (8 * n)));
+        } else {
+            resultat = ecritRegistre(fd, REGISTRE_HORLOGE + n, (uint8_t) (heure >> (8 * n)));
+        }
+    }
+    if (resultat < 0) {
+        syslog(LOG_WARNING, "Réglage de l'horloge impossible: %m");
+    } else if (configuration.bavard) {
+        syslog(LOG_DEBUG, "Horloge réglée, écart de %llds", (long long) ecart);
+    }
+}
+
+/**
+ * Publie l'état en mémoire partagée. La séquence est impaire pendant
+ * la copie; les barrières empêchent les écritures de la copie de 
+ * déborder de part et d'autre.
+ */
+static void publie(volatile UpsEtat *publie, const UpsEtat *etat) {
+    uint32_t sequence = publie->sequence;
+
+    __atomic_store_n(&publie->sequence, sequence + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy((uint8_t *) publie + sizeof (uint32_t),
+            (const uint8_t *) etat + sizeof (uint32_t),
+            sizeof (UpsEtat) - sizeof (uint32_t));
+    __atomic_store_n(&publie->sequence, sequence + 2, __ATOMIC_RELEASE);
+}
+
+/**
+ * Crée la mémoire partagée, lisible par tous.
+ */
+static volatile UpsEtat *ouvrePublication() {
+    volatile UpsEtat *publication;
+    int fd;
+
+    fd = shm_open(UPS_ETAT_NOM, O_CREAT | O_RDWR, 0644);
+    if (fd < 0) {
+        return NULL;
+    }
+    fchmod(fd, 0644);
+    if (ftruncate(fd, sizeof (UpsEtat)) < 0) {
+        close(fd);
+        return NULL;
+    }
+    publication = mmap(NULL, sizeof (UpsEtat), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (publication == MAP_FAILED) {
+        return NULL;
+    }
+    return publication;
+}
+
+/**
+ * Exécute une commande par le shell, sans attendre la fin.
+ */
+static void execute(const char *commande, const char *argument) {
+    pid_t pid;
+
+    if (commande == NULL) {
+        return;
+    }
+    pid = fork();
+    if (pid == 0) {
+        if (argument) {
+            execl("/bin/sh", "sh", "-c", "exec $0 \"$1\"", commande, argument, (char *) NULL);
+        } else {
+            execl("/bin/sh", "sh", "-c", commande, (char *) NULL);
+        }
+        _exit(127);
+    }
+    if (pid < 0) {
+        syslog(LOG_ERR, "Impossible d'exécuter %s: %m", commande);
+    }
+}
+
+static void evenement(const char *nom) {
+    syslog(LOG_NOTICE, "Événement: %s", nom);
+    execute(configuration.commandeEvenement, nom);
+}
+
+/**
+ * @return 1 si l'accumulateur se décharge.
+ */
+static int surAccumulateur(const UpsEtat *etat) {
+    return upsRegistre16(etat, REGISTRE_MINUTES_AVANT_DECHARGE) != 0xFFFF;
+}
+
+/**
+ * @return 1 si l'autonomie restante impose l'arrêt.
+ */
+static int arretNecessaire(const UpsEtat *etat) {
+    if (!surAccumulateur(etat)) {
+        return 0;
+    }
+    return upsRegistre16(etat, REGISTRE_MINUTES_AVANT_DECHARGE) <= configuration.minutesArret
+            || etat->registres[REGISTRE_ETAT_CHARGE] <= configuration.chargeArret;
+}
+
+/**
+ * Compare seulement les valeurs qui décrivent l'état de l'UPS: les
+ * conversions, tensions, courants et compteurs varient à chaque
+ * interrogation, et maintiendraient les interrogations rapides en
+ * permanence. Les changements de l'alimentation et de l'accumulateur
+ * sont comptés par les transitions.
+ * @return 1 si l'état a changé.
+ */
+static int etatChange(const UpsEtat *etat, const UpsEtat *precedent) {
+    return etat->erreur != precedent->erreur
+            || upsRegistre16(etat, REGISTRE_TRANSITIONS_DISPONIBLE)
+                != upsRegistre16(precedent, REGISTRE_TRANSITIONS_DISPONIBLE)
+            || upsRegistre16(etat, REGISTRE_TRANSITIONS_CHARGE)
+                != upsRegistre16(precedent, REGISTRE_TRANSITIONS_CHARGE)
+            || upsRegistre16(etat, REGISTRE_TRANSITIONS_SOLLICITATION)
+                != upsRegistre16(precedent, REGISTRE_TRANSITIONS_SOLLICITATION)
+            || upsRegistre16(etat, REGISTRE_TRANSITIONS_ISOLATION)
+                != upsRegistre16(precedent, REGISTRE_TRANSITIONS_ISOLATION)
+            || etat->registres[REGISTRE_ETAT_CHARGE] != precedent->registres[REGISTRE_ETAT_CHARGE]
+            || upsRegistre16(etat, REGISTRE_MINUTES_AVANT_DECHARGE)
+                != upsRegistre16(precedent, REGISTRE_MINUTES_AVANT_DECHARGE)
+            || etat->registres[REGISTRE_ARRET_ANNONCE] != precedent->registres[REGISTRE_ARRET_ANNONCE]
+            || etat->registres[REGISTRE_CHARGE_SUSPENDUE] != precedent->registres[REGISTRE_CHARGE_SUSPENDUE]
+            || etat->registres[REGISTRE_FIN_CHARGE] != precedent->registres[REGISTRE_FIN_CHARGE];
+}
+
+static void utilisation(const char *programme) {
+    fprintf(stderr, "Utilisation: %s [-b bus | -i image] [-l s] [-r s] [-m min] "
+            "[-c %%] [-a s] [-x commande] [-e commande] [-P] [-v]\n", programme);
+    exit(2);
+}
+
+static void litOptions(int argc, char **argv) {
+    int option;
+
+    while ((option = getopt(argc, argv, "b:i:l:r:m:c:a:x:e:Pv")) != -1) {
+        switch (option) {
+            case 'b': configuration.bus = optarg; break;
+            case 'i': configuration.image = optarg; break;
+            case 'l': configuration.intervalleLent = atoi(optarg); break;
+            case 'r': configuration.intervalleRapide = atoi(optarg); break;
+            case 'm': configuration.minutesArret = atoi(optarg); break;
+            case 'c': configuration.chargeArret = atoi(optarg); break;
+            case 'a': configuration.delaiAnnonce = atoi(optarg); break;
+            case 'x': configuration.commandeArret = optarg; break;
+            case 'e': configuration.commandeEvenement = optarg; break;
+            case 'P': configuration.pec = 1; break;
+            case 'v': configuration.bavard = 1; break;
+            default: utilisation(argv[0]);
+        }
+    }
+    if (configuration.intervalleRapide == 0 || configuration.intervalleLent == 0
+            || configuration.delaiAnnonce > 255) {
+        utilisation(argv[0]);
+    }
+}
+
+int main(int argc, char **argv) {
+    volatile UpsEtat *publication;
+    UpsEtat etat, precedent;
+    struct sigaction action;
+    unsigned int rapides = 0, echecs = 0;
+    int fd = -1, arretEngage = 0, resultat;
+
+    litOptions(argc, argv);
+    openlog("upsd", LOG_PID | (configuration.bavard ? LOG_PERROR : 0), LOG_DAEMON);
+
+    memset(&action, 0, sizeof (action));
+    action.sa_handler = interromps;
+    sigaction(SIGTERM, &action, NULL);
+    sigaction(SIGINT, &action, NULL);
+    action.sa_handler = SIG_DFL;
+    action.sa_flags = SA_NOCLDWAIT;
+    sigaction(SIGCHLD, &action, NULL);
+
+    if (configuration.image == NULL) {
+        fd = open(configuration.bus, O_RDWR);
+        if (fd < 0) {
+            syslog(LOG_ERR, "Impossible d'ouvrir %s: %m", configuration.bus);
+            return 1;
+        }
+        // Le PEC est ajouté et vérifié par le noyau. L'activation est
+        // elle-même envoyée avec son PEC, que l'UPS ignore s'il n'est 
+        // pas encore en mode PEC.
+        if (configuration.pec && ioctl(fd, I2C_PEC, 1) < 0) {
+            syslog(LOG_ERR, "PEC impossible sur %s: %m", configuration.bus);
+            return 1;
+        }
+        if (configuration.pec) {
+            ecritRegistre(fd, REGISTRE_PEC, 1);
+        }
+    }
+    publication = ouvrePublication();
+    if (publication == NULL) {
+        syslog(LOG_ERR, "Impossible de créer %s: %m", UPS_ETAT_NOM);
+        return 1;
+    }
+
+    memset(&etat, 0, sizeof (etat));
+    etat.version = UPS_ETAT_VERSION;
+    etat.taille = sizeof (UpsEtat);
+    precedent = etat;
+    // Rien n'est connu: l'UPS est supposé sur secteur.
+    memset(precedent.registres, 0xFF, I2C_NOMBRE_REGISTRES);
+    publie(publication, &etat);
+
+    while (!termine) {
+        if (configuration.image) {
+            resultat = interrogeImage(&etat);
+        } else {
+            resultat = interrogeBus(fd, &etat);
+        }
+
+        if (resultat == 0) {
+            etat.lectures++;
+            etat.horodatage = maintenant();
+            if (!etat.present) {
+                etat.present = 1;
+                evenement("present");
+            }
+            echecs = 0;
+        } else {
+            etat.erreurs++;
+            if (configuration.bavard) {
+                syslog(LOG_WARNING, "Lecture impossible: %m");
+            }
+            // L'UPS a peut-être redémarré, et perdu le mode PEC:
+            if (configuration.pec) {
+                ecritRegistre(fd, REGISTRE_PEC, 1);
+            }
+            if (++echecs == ECHECS_AVANT_ABSENCE && etat.present) {
+                etat.present = 0;
+                evenement("absent");
+            }
+        }
+        publie(publication, &etat);
+
+        if (etat.present && resultat == 0) {
+            if (surAccumulateur(&etat) && !surAccumulateur(&precedent)) {
+                evenement("defaillance");
+            } else if (!surAccumulateur(&etat) && surAccumulateur(&precedent)) {
+                evenement("retour");
+            }
+            if (etatChange(&etat, &precedent)) {
+                rapides = INTERROGATIONS_RAPIDES_APRES_CHANGEMENT;
+            }
+            if (configuration.bavard) {
+                syslog(LOG_DEBUG, "Charge %u%%, %umV, %dmA, %u minutes",
+                        etat.registres[REGISTRE_ETAT_CHARGE],
+                        upsRegistre16(&etat, REGISTRE_MILLIVOLTS_ACCUMULATEUR),
+                        (int16_t) upsRegistre16(&etat, REGISTRE_COURANT_MOYEN),
+                        upsRegistre16(&etat, REGISTRE_MINUTES_AVANT_DECHARGE));
+            }
+            regleHorloge(fd, &etat);
+            if (!arretEngage && arretNecessaire(&etat)) {
+                syslog(LOG_ALERT, "Accumulateur presque vide: arrêt dans %us",
+                        configuration.delaiAnnonce);
+                if (configuration.image) {
+                    resultat = ecritImage(REGISTRE_ARRET_ANNONCE, configuration.delaiAnnonce);
+                } else {
+                    resultat = ecritRegistre(fd, REGISTRE_ARRET_ANNONCE, configuration.delaiAnnonce);
+                }
+                if (resultat < 0) {
+                    syslog(LOG_ERR, "Annonce de l'arrêt impossible: %m");
+                }
+                evenement("arret");
+                execute(configuration.commandeArret, NULL);
+                arretEngage = 1;
+            }
+            precedent = etat;
+        }
+
+        if (rapides > 0) {
+            rapides--;
+            sleep(configuration.intervalleRapide);
+        } else if (etat.present && surAccumulateur(&etat)) {
+            sleep(configuration.intervalleRapide);
+        } else {
+            sleep(configuration.intervalleLent);
+        }
+    }
+
+    // La mémoire partagée reste en place: les lecteurs voient que
+    // l'horodatage n'avance plus.
+    if (fd >= 0) {
+        close(fd);
+    }
+    closelog();
+    return 0;
+}
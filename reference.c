@@ -0,0 +1,166 @@
+#include "reference.h"
+#include "i2c.h"
+#include "test.h"
+
+/** 
+ * Conversion filtrée de la référence fixe, en 1/4 de pas de 10 bits.
+ * Mise à jour par l'interruption, lue par referenceSeconde.
+ */
+static volatile unsigned int fvrFiltre = REFERENCE_FVR_NOMINALE;
+
+/** 
+ * Correction de VDD, en 1/256: une conversion v est compensée 
+ * en v + v * correction / 256.
+ */
+static signed char correction = 0;
+
+/** Tension d'alimentation du micro-contrôleur, en mV. */
+static unsigned int vdd = REFERENCE_VDD_NOMINALE_MV;
+
+void referenceInitialise() {
+    fvrFiltre = REFERENCE_FVR_NOMINALE;
+    correction = 0;
+    vdd = REFERENCE_VDD_NOMINALE_MV;
+}
+
+void referenceMesure(unsigned int fvr) {
+    // Filtre passe-bas (1/4) de la conversion de la référence:
+    fvrFiltre = fvrFiltre - (fvrFiltre >> 2) + fvr;
+}
+
+void referenceSeconde() {
+    unsigned int fvr;
+    int c;
+
+    // Relit la conversion filtrée si une interruption l'a modifiée
+    // entre ses deux octets:
+    do {
+        fvr = fvrFiltre;
+    } while (fvr != fvrFiltre);
+
+    // Si VDD baisse, la conversion de la référence augmente, et
+    // les autres conversions doivent être réduites.
+    c = (int) ((REFERENCE_FVR_NOMINALE * 256UL) / fvr) - 256;
+    if (c < -128) {
+        c = -128;
+    }
+    if (c > 127) {
+        c = 127;
+    }
+    correction = (signed char) c;
+    vdd = (unsigned int) ((REFERENCE_FVR_NOMINALE * (unsigned long) REFERENCE_VDD_NOMINALE_MV) / fvr);
+    i2cExposeRegistre16(REGISTRE_MILLIVOLTS_VDD, vdd);
+}
+
+unsigned char referenceCompense(unsigned char v) {
+    int c = (int) v + (((int) v * correction) >> 8);
+    if (c > 255) {
+        return 255;
+    }
+    return (unsigned char) c;
+}
+
+unsigned int referenceMillivolts(unsigned char v) {
+    // 2 x 5000mV / 255 = 39.25mV par pas.
+    return ((unsigned int) v * 157) >> 2;
+}
+
+unsigned int referenceVdd() {
+    return vdd;
+}
+
+#ifdef TEST
+
+#include "energie.h"
+
+/**
+ * Simule la conversion d'une tension, avec une référence VDD.
+ * @param mv La tension, en mV.
+ * @param vddMv La tension VDD, en mV.
+ * @return La conversion sur 8 bits.
+ */
+static unsigned char convertit(unsigned int mv, unsigned int vddMv) {
+    return (unsigned char) ((mv * 256UL) / vddMv);
+}
+
+/**
+ * Simule la conversion de la référence fixe, sur 10 bits.
+ */
+static unsigned int convertitReference(unsigned int vddMv) {
+    return (unsigned int) ((REFERENCE_FVR_MV * 1024UL) / vddMv);
+}
+
+/**
+ * Stabilise le filtre de la référence pour la tension VDD indiquée.
+ */
+static void stabilise(unsigned int vddMv) {
+    unsigned char n;
+    for (n = 0; n < 32; n++) {
+        referenceMesure(convertitReference(vddMv));
+    }
+    referenceSeconde();
+}
+
+static void mesure_vdd() {
+    referenceInitialise();
+    stabilise(5000);
+    verifieEgalite("REFVD01", referenceVdd() / 10, 500);
+    stabilise(4600);
+    verifieEgalite("REFVD02", referenceVdd() / 10, 460);
+}
+
+static void recalcule_une_fois_par_seconde() {
+    referenceInitialise();
+    stabilise(5000);
+    referenceMesure(convertitReference(4000));
+    verifieEgalite("REFSC01", referenceVdd() / 10, 500);
+    referenceSeconde();
+    verifieEgalite("REFSC02", referenceVdd() < 5000, 1);
+    referenceInitialise();
+}
+
+static void compense_la_baisse_de_vdd() {
+    unsigned int vddMv;
+    unsigned char v;
+    
+    // Un accumulateur à 3.52V donne 90 avec VDD nominale, quelle que 
+    // soit la dérive de VDD:
+    for (vddMv = 5000; vddMv >= 4500; vddMv -= 100) {
+        referenceInitialise();
+        stabilise(vddMv);
+        v = referenceCompense(convertit(3520 / 2, vddMv));
+        if (verifieEgalite("REFCO01", (v >= 89) && (v <= 90), 1)) {
+            return;
+        }
+    }
+}
+
+static void les_seuils_tiennent_malgre_la_derive_de_vdd() {
+    initialiseEnergie();
+    referenceInitialise();
+    mesureAccumulateur(referenceCompense(convertit(4000 / 2, 5000)));
+
+    // L'alimentation tombe à 6.9V pendant que VDD baisse à 4.6V. 
+    // Sans compensation, 6.9V serait lue comme 7.5V:
+    stabilise(4600);
+    verifieEgalite("REFSE01", convertit(6900 / 2, 4600) > 180, 1);
+    verifieEgalite("REFSE02", 
+            mesureAlimentation(referenceCompense(convertit(6900 / 2, 4600)))->solliciterAccumulateur, 1);
+    
+    // Avec VDD à 4.6V, le Boost à 9.0V ne signifie pas que le raspberry
+    // est arrêté:
+    verifieEgalite("REFSE03", convertit(9000 / 2, 4600) > 241, 1);
+    verifieEgalite("REFSE04", 
+            mesureBoost(referenceCompense(convertit(9000 / 2, 4600)))->solliciterAccumulateur, 1);
+    
+    referenceInitialise();
+}
+
+void testeReference() {
+    mesure_vdd();
+    recalcule_une_fois_par_seconde();
+    compense_la_baisse_de_vdd();
+    les_seuils_tiennent_malgre_la_derive_de_vdd();
+}
+
+#endif
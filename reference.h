@@ -0,0 +1,65 @@
+#ifndef REFERENCE_H
+#define	REFERENCE_H
+
+/**
+ * Tension de la référence fixe (FVR), en mV.
+ */
+#define REFERENCE_FVR_MV 2048
+
+/**
+ * Tension d'alimentation nominale du micro-contrôleur, en mV.
+ * Les seuils et les calibrations sont exprimés pour cette tension.
+ */
+#define REFERENCE_VDD_NOMINALE_MV 5000
+
+/**
+ * Conversion de la référence fixe lorsque VDD est nominale, en 1/4 de pas
+ * de 10 bits: 2.048V / 5V * 1024 * 4
+ */
+#define REFERENCE_FVR_NOMINALE ((unsigned int) ((REFERENCE_FVR_MV * 4096UL + REFERENCE_VDD_NOMINALE_MV / 2) / REFERENCE_VDD_NOMINALE_MV))
+
+/**
+ * Initialise la compensation, en supposant que VDD est nominale.
+ */
+void referenceInitialise();
+
+/**
+ * Prend note d'une conversion de la référence fixe.
+ * Ne fait que filtrer: appelée à chaque conversion de la référence.
+ * @param fvr La conversion de la référence fixe, sur 10 bits.
+ */
+void referenceMesure(unsigned int fvr);
+
+/**
+ * Recalcule le facteur de compensation et la tension VDD à partir
+ * de la référence filtrée. Fait deux divisions de 32 bits: à
+ * appeler une fois par seconde, hors de l'interruption.
+ */
+void referenceSeconde();
+
+/**
+ * Compense une conversion de la variation de VDD, c'est à dire
+ * la ramène à ce qu'elle serait si VDD était nominale.
+ * Ne fait qu'une multiplication 8x8 bits signée.
+ * @param v La conversion.
+ * @return La conversion compensée.
+ */
+unsigned char referenceCompense(unsigned char v);
+
+/**
+ * @param v Une conversion compensée, obtenue au travers d'un 
+ * diviseur de tension 1/2.
+ * @return La tension à l'entrée du diviseur, en mV.
+ */
+unsigned int referenceMillivolts(unsigned char v);
+
+/**
+ * @return La tension d'alimentation du micro-contrôleur, en mV.
+ */
+unsigned int referenceVdd();
+
+#ifdef TEST
+void testeReference();
+#endif
+
+#endif
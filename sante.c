@@ -0,0 +1,178 @@
+#include "sante.h"
+#include "jauge.h"
+#include "i2c.h"
+#include "test.h"
+
+/** 
+ * Tension correspondant à un pas de conversion, en µV.
+ * Diviseur 1/2, référence de 5V, conversion sur 8 bits.
+ */
+#define MICROVOLTS_PAR_PAS (10000000UL / 255)
+
+/**
+ * Énumère les étapes de la mesure de la résistance interne.
+ */
+typedef enum {
+    /** Attend une transition de charge. */
+    ATTEND_TRANSITION,
+    /** Attend que la tension se stabilise après une transition. */
+    ATTEND_STABILISATION
+} EtapeSante;
+
+static EtapeSante etape = ATTEND_TRANSITION;
+
+/** Indique si le convertisseur Boost était connecté à l'échantillon précédent. */
+static unsigned char sollicite = 0;
+
+/** Dernière tension de l'accumulateur, ou 0 si elle n'est pas utilisable. */
+static unsigned char vPrecedente = 0;
+
+/** Tension de l'accumulateur juste avant la transition. */
+static unsigned char vAvant = 0;
+
+/** Nombre d'échantillons restant avant la fin de la stabilisation. */
+static unsigned char stabilisation = 0;
+
+/** Résistance interne filtrée, en mΩ. */
+static unsigned int resistance = 0;
+
+/** Indicateur de santé. */
+static unsigned char indicateur = SANTE_INCONNUE;
+
+void santeInitialise() {
+    etape = ATTEND_TRANSITION;
+    sollicite = 0;
+    vPrecedente = 0;
+    vAvant = 0;
+    stabilisation = 0;
+    resistance = 0;
+    indicateur = SANTE_INCONNUE;
+}
+
+/**
+ * Intègre une nouvelle mesure de résistance dans le filtre, puis 
+ * recalcule l'indicateur de santé.
+ * Ceci n'arrive qu'une fois par transition; les divisions sont permises.
+ * @param ecart Écart de tension entre les états chargé et pas chargé.
+ */
+static void santeIntegre(unsigned char ecart) {
+    unsigned int mesure;
+    
+    mesure = (unsigned int) ((ecart * MICROVOLTS_PAR_PAS) / JAUGE_COURANT_DECHARGE_MA);
+    if (indicateur == SANTE_INCONNUE) {
+        resistance = mesure;
+    } else {
+        resistance = (unsigned int) ((int) resistance + (((int) mesure - (int) resistance) >> 2));
+    }
+
+    if (resistance <= SANTE_RESISTANCE_NEUVE) {
+        indicateur = 100;
+    } else if (resistance >= SANTE_RESISTANCE_USEE) {
+        indicateur = 0;
+    } else {
+        indicateur = (unsigned char) (100 - ((resistance - SANTE_RESISTANCE_NEUVE) * 100) 
+                / (SANTE_RESISTANCE_USEE - SANTE_RESISTANCE_NEUVE));
+    }
+    i2cExposeRegistre16(REGISTRE_RESISTANCE_INTERNE, resistance);
+    i2cExposeRegistre(REGISTRE_SANTE, indicateur);
+}
+
+void santeMesureAccumulateur(unsigned char v, Energie *energie) {
+    // Le chargeur fausse la mesure:
+    if (energie->chargerAccumulateur || !energie->accumulateurDisponible) {
+        etape = ATTEND_TRANSITION;
+        v = 0;
+    }
+    
+    // Transition de charge: retient la tension d'avant la transition.
+    else if (energie->solliciterAccumulateur != sollicite) {
+        if (vPrecedente) {
+            vAvant = vPrecedente;
+            stabilisation = SANTE_ECHANTILLONS_STABILISATION;
+            etape = ATTEND_STABILISATION;
+        }
+    }
+
+    // Après stabilisation, la différence donne la résistance interne:
+    else if (etape == ATTEND_STABILISATION) {
+        if (--stabilisation == 0) {
+            if (sollicite) {
+                santeIntegre(vAvant > v ? vAvant - v : 0);
+            } else {
+                santeIntegre(v > vAvant ? v - vAvant : 0);
+            }
+            etape = ATTEND_TRANSITION;
+        }
+    }
+
+    sollicite = energie->solliciterAccumulateur;
+    vPrecedente = v;
+}
+
+unsigned int santeResistanceInterne() {
+    return resistance;
+}
+
+unsigned char santeIndicateur() {
+    return indicateur;
+}
+
+#ifdef TEST
+
+static Energie auRepos = {1, 0, 0, 0};
+static Energie enCharge = {1, 1, 0, 0};
+static Energie enDecharge = {1, 0, 1, 0};
+
+static void echantillons(unsigned char v, Energie *energie, unsigned char n) {
+    while (n-- > 0) {
+        santeMesureAccumulateur(v, energie);
+    }
+}
+
+static void mesure_la_resistance_interne_a_la_connexion_du_boost() {
+    santeInitialise();
+    verifieEgalite("SANCO01", santeIndicateur(), SANTE_INCONNUE);
+    
+    echantillons(100, &auRepos, 10);
+    echantillons(96, &enDecharge, SANTE_ECHANTILLONS_STABILISATION);
+    verifieEgalite("SANCO02", santeIndicateur(), SANTE_INCONNUE);
+
+    // 4 pas de 39.2mV sous 1.8A: 87mΩ
+    echantillons(96, &enDecharge, 1);
+    verifieEgalite("SANCO03", santeResistanceInterne(), 87);
+    verifieEgalite("SANCO04", santeIndicateur(), 92);
+}
+
+static void mesure_la_resistance_interne_a_la_deconnexion_du_boost() {
+    santeInitialise();
+    echantillons(90, &enDecharge, 10);
+    echantillons(96, &auRepos, SANTE_ECHANTILLONS_STABILISATION + 1);
+    verifieEgalite("SANDE01", santeResistanceInterne(), 130);
+    verifieEgalite("SANDE02", santeIndicateur(), 38);
+}
+
+static void filtre_les_mesures_successives() {
+    santeInitialise();
+    echantillons(100, &auRepos, 10);
+    echantillons(96, &enDecharge, 10);      // 87mΩ
+    echantillons(100, &auRepos, 10);        // 87mΩ
+    echantillons(92, &enDecharge, 10);      // 174mΩ
+    verifieEgalite("SANFI01", santeResistanceInterne(), 108);
+    verifieEgalite("SANFI02", santeIndicateur(), 65);
+}
+
+static void ignore_les_transitions_pendant_la_charge() {
+    santeInitialise();
+    echantillons(100, &enCharge, 10);
+    echantillons(96, &enDecharge, 10);
+    verifieEgalite("SANCH01", santeIndicateur(), SANTE_INCONNUE);
+}
+
+void testeSante() {
+    mesure_la_resistance_interne_a_la_connexion_du_boost();
+    mesure_la_resistance_interne_a_la_deconnexion_du_boost();
+    filtre_les_mesures_successives();
+    ignore_les_transitions_pendant_la_charge();
+}
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef SANTE_H
+#define	SANTE_H
+
+#include "energie.h"
+#include "profil.h"
+
+/**
+ * Résistance interne d'un accumulateur neuf, connectique et transistor
+ * d'isolation compris, en mΩ.
+ */
+#ifndef SANTE_RESISTANCE_NEUVE
+#define SANTE_RESISTANCE_NEUVE PROFIL_RESISTANCE_NEUVE
+#endif
+
+/**
+ * Résistance interne d'un accumulateur à remplacer, en mΩ.
+ * La résistance interne double en fin de vie.
+ */
+#ifndef SANTE_RESISTANCE_USEE
+#define SANTE_RESISTANCE_USEE PROFIL_RESISTANCE_USEE
+#endif
+
+/**
+ * Nombre d'échantillons de l'accumulateur à ignorer à partir d'une 
+ * transition de charge, le temps que le convertisseur Boost se stabilise.
+ */
+#define SANTE_ECHANTILLONS_STABILISATION 8
+
+/**
+ * Indicateur de santé rendu tant qu'aucune transition n'a été mesurée.
+ */
+#define SANTE_INCONNUE 255
+
+/**
+ * Initialise l'estimation de la résistance interne.
+ */
+void santeInitialise();
+
+/**
+ * Compare la tension de l'accumulateur juste avant et juste après chaque 
+ * connexion ou déconnexion du convertisseur Boost, pour en déduire la
+ * résistance interne de l'accumulateur.
+ * @param vAccumulateur Tension de l'accumulateur, obtenue au travers d'un 
+ * diviseur de tension 1/2, puis numérisée sur 8 bits.
+ * @param energie La configuration du circuit pendant la mesure.
+ */
+void santeMesureAccumulateur(unsigned char vAccumulateur, Energie *energie);
+
+/**
+ * @return La résistance interne estimée, en mΩ, ou 0 si aucune 
+ * transition n'a été mesurée.
+ */
+unsigned int santeResistanceInterne();
+
+/**
+ * @return L'indicateur de santé de l'accumulateur, en pourcent, ou
+ * SANTE_INCONNUE.
+ */
+unsigned char santeIndicateur();
+
+#ifdef TEST
+void testeSante();
+#endif
+
+#endif
@@ -0,0 +1,481 @@
+/**
+ * Simulateur de coupures de courant, pour estimer l'autonomie sur
+ * accumulateur et justifier le choix des seuils et des cellules.
+ *
+ * Chaque scénario tire au hasard un accumulateur (capacité, résistance
+ * interne, état de charge), une consommation du raspberry, un rendement
+ * du convertisseur Boost et une durée de coupure. La décharge est simulée
+ * seconde par seconde; les décisions sont prises par les vrais energie.c
+ * et jauge.c, compilés avec ce fichier, à partir des tensions numérisées
+ * comme sur le circuit. Le raspberry annonce son arrêt comme upsd (voir
+ * raspberry/upsd.c), d'après les registres exposés par la jauge: il ne
+ * connaît pas la charge réelle.
+ * Les scénarios sont répartis sur plusieurs processus, un par cœur.
+ * Un scénario ne dépend que de la graine et de son numéro: le résultat
+ * ne dépend pas du nombre de processus.
+ *
+ * Compilation, depuis ce répertoire:
+ *     gcc -O2 -funsigned-char -o simulateur simulateur.c -lm
+ * Pour le profil NiMH, ajouter -DPROFIL_NIMH.
+ *
+ * Options:
+ *     -n nombre     Nombre de scénarios (défaut: 10000).
+ *     -j processus  Nombre de processus (défaut: nombre de cœurs).
+ *     -g graine     Graine des tirages (défaut: 1).
+ *     -d minutes    Durée moyenne d'une coupure (défaut: 60).
+ *     -p min:max    Consommation du raspberry, en W (défaut: 2.0:4.5).
+ *     -s santé      Capacité minimum, en fraction de la capacité nominale
+ *                   (défaut: 0.7).
+ *     -e charge     État de charge minimum au début de la coupure, en
+ *                   fraction (défaut: 0.6).
+ *     -m minutes    Autonomie restante qui déclenche l'arrêt (défaut: 5).
+ *     -c pourcent   État de charge qui déclenche l'arrêt (défaut: 10).
+ *     -a secondes   Délai annoncé avant la coupure (défaut: 60).
+ *     -U seuil      Remplace calibration.accumulateurPasUtilisable.
+ *     -F seuil      Remplace calibration.accumulateurFaible.
+ */
+#define _GNU_SOURCE
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+// Logique d'administration d'énergie du micro-contrôleur, telle quelle:
+#include "../energie.c"
+#ifdef PROFIL_CHARGE_DELTA_V
+#include "../charge.c"
+#endif
+#include "../jauge.c"
+
+/** Tension de sortie du convertisseur Boost quand le raspberry consomme. */
+#define BOOST_TENSION_CHARGE 9.0
+/** Tension de sortie du convertisseur Boost quand le raspberry est arrêté. */
+#define BOOST_TENSION_A_VIDE 9.8
+/** Le convertisseur Boost décroche en dessous de cette tension d'entrée. */
+#define BOOST_TENSION_MINIMALE 2.5
+/** Rendement du convertisseur Boost. */
+#define BOOST_RENDEMENT_MINIMUM 0.85
+#define BOOST_RENDEMENT_MAXIMUM 0.92
+
+/** Tension de l'alimentation, sur secteur. */
+#define ALIMENTATION_TENSION 12.0
+/** Consommation du raspberry une fois arrêté, en W. */
+#define RASPBERRY_PUISSANCE_ARRETE 0.1
+/** Consommation supplémentaire pendant une rafale d'activité, en W. */
+#define RASPBERRY_PUISSANCE_RAFALE 1.5
+/** Probabilité qu'une rafale d'activité commence, chaque seconde. */
+#define RASPBERRY_PROBABILITE_RAFALE 0.02
+/** Durée d'un arrêt du raspberry, en secondes. */
+#define RASPBERRY_ARRET_MINIMUM 10
+#define RASPBERRY_ARRET_MAXIMUM 40
+
+/** Durée maximum d'un scénario, en secondes. */
+#define SCENARIO_DUREE_MAXIMALE (24L * 3600)
+
+/** 
+ * Nombre de conversions de l'accumulateur par seconde sur le circuit: 
+ * 2 étapes sur 10 de la séquence, à 2000 conversions par seconde. La
+ * jauge ajuste ses prédictions d'une minute à chaque conversion.
+ */
+#define CONVERSIONS_ACCUMULATEUR_PAR_SECONDE 400
+
+/** Température de l'accumulateur pendant la simulation, en °C. */
+#define TEMPERATURE_AMBIANTE 25
+
+typedef struct {
+    unsigned long scenarios;
+    int processus;
+    unsigned long graine;
+    double dureeMoyenne;
+    double puissanceMinimum;
+    double puissanceMaximum;
+    double santeMinimum;
+    double chargeMinimum;
+    unsigned int minutesArret;
+    unsigned int chargeArret;
+    unsigned char delaiAnnonce;
+} Parametres;
+
+static Parametres parametres = {
+    10000, 0, 1, 60, 2.0, 4.5, 0.7, 0.6, 5, 10, 60
+};
+
+/**
+ * Résultat d'un scénario.
+ */
+typedef struct {
+    /** 1 si l'alimentation est revenue avant l'arrêt du raspberry. */
+    unsigned char survie;
+    /** 1 si le raspberry a perdu son alimentation sans s'être arrêté. */
+    unsigned char brutal;
+    /** Temps passé sur accumulateur, en secondes. */
+    unsigned long autonomie;
+    /** Temps passé dans l'état UTILISABLE_MAIS_FAIBLE, en secondes. */
+    unsigned long secondesFaible;
+    /** État de charge restant à la fin, en pourcent. */
+    double chargeRestante;
+} Resultat;
+
+/**
+ * Registres exposés par le micro-contrôleur, tels que upsd les lit.
+ */
+static unsigned char registres[I2C_NOMBRE_REGISTRES];
+
+void i2cExposeRegistre(unsigned char registre, unsigned char valeur) {
+    registres[registre] = valeur;
+}
+
+void i2cExposeRegistre16(unsigned char registre, unsigned int valeur) {
+    registres[registre] = (unsigned char) valeur;
+    registres[registre + 1] = (unsigned char) (valeur >> 8);
+}
+
+static unsigned int registre16(unsigned char registre) {
+    return registres[registre] | (registres[registre + 1] << 8);
+}
+
+/**
+ * Même décision que arretNecessaire, dans upsd.
+ * @return 1 si l'autonomie restante impose l'arrêt.
+ */
+static int arretNecessaire() {
+    if (registre16(REGISTRE_MINUTES_AVANT_DECHARGE) == JAUGE_DUREE_INCONNUE) {
+        return 0;
+    }
+    return registre16(REGISTRE_MINUTES_AVANT_DECHARGE) <= parametres.minutesArret
+            || registres[REGISTRE_ETAT_CHARGE] <= parametres.chargeArret;
+}
+
+void journalEnregistre(JournalEvenement evenement) {
+    (void) evenement;
+}
+
+void captureDeclenche(CaptureCause cause) {
+    (void) cause;
+}
+
+Calibration calibration = CALIBRATION_IDEALE;
+
+/**
+ * Générateur pseudo-aléatoire xorshift64*.
+ */
+typedef struct {
+    unsigned long long etat;
+} Alea;
+
+static void aleaInitialise(Alea *alea, unsigned long long graine) {
+    // splitmix64, pour que des graines voisines donnent des suites distinctes.
+    graine += 0x9E3779B97F4A7C15ULL;
+    graine = (graine ^ (graine >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    graine = (graine ^ (graine >> 27)) * 0x94D049BB133111EBULL;
+    alea->etat = (graine ^ (graine >> 31)) | 1;
+}
+
+/**
+ * @return Un nombre uniformément réparti dans [0, 1[.
+ */
+static double aleaUniforme(Alea *alea) {
+    alea->etat ^= alea->etat >> 12;
+    alea->etat ^= alea->etat << 25;
+    alea->etat ^= alea->etat >> 27;
+    return ((alea->etat * 0x2545F4914F6CDD1DULL) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static double aleaEntre(Alea *alea, double minimum, double maximum) {
+    return minimum + (maximum - minimum) * aleaUniforme(alea);
+}
+
+/**
+ * Tension à vide de l'accumulateur, interpolée dans la courbe du profil.
+ * @param pourcent État de charge, en pourcent.
+ * @return La tension, en V.
+ */
+static double tensionAVide(double pourcent) {
+    static const unsigned char courbe[][2] = PROFIL_COURBE_TENSION_A_VIDE;
+    const int n = sizeof (courbe) / sizeof (courbe[0]);
+    double conversion;
+    int i;
+
+    if (pourcent <= courbe[0][1]) {
+        conversion = courbe[0][0];
+    } else if (pourcent >= courbe[n - 1][1]) {
+        conversion = courbe[n - 1][0];
+    } else {
+        for (i = 1; courbe[i][1] < pourcent; i++);
+        conversion = courbe[i - 1][0] + (courbe[i][0] - courbe[i - 1][0])
+                * (pourcent - courbe[i - 1][1]) / (courbe[i][1] - courbe[i - 1][1]);
+    }
+    return conversion * 10.0 / 255;
+}
+
+/**
+ * Numérise une tension comme le circuit: diviseur 1/2, puis
+ * conversion sur 8 bits avec une référence de 5V.
+ */
+static unsigned char numerise(double tension) {
+    double conversion = tension * 255 / 10;
+
+    if (conversion < 0) {
+        return 0;
+    }
+    if (conversion > 255) {
+        return 255;
+    }
+    return (unsigned char) conversion;
+}
+
+/**
+ * Fait suivre à la jauge une seconde de conversions de l'accumulateur.
+ * @param v La tension de l'accumulateur, numérisée.
+ */
+static void jaugeConversions(unsigned char v) {
+    int n;
+    for (n = 0; n < CONVERSIONS_ACCUMULATEUR_PAR_SECONDE; n++) {
+        jaugeMesureAccumulateur(v);
+    }
+}
+
+typedef enum {
+    RASPBERRY_ACTIF,
+    RASPBERRY_S_ARRETE,
+    RASPBERRY_ARRETE
+} EtatSimule;
+
+/**
+ * Simule une coupure de courant.
+ * @param numero Numéro du scénario.
+ * @param resultat Le résultat.
+ */
+static void simule(unsigned long numero, Resultat *resultat) {
+    Alea alea;
+    double capacite, charge, resistance, rendement, puissanceBase;
+    double puissance, tension, courant, discriminant;
+    unsigned long duree, t;
+    unsigned int dureeArret, rafale = 0, restant = 0;
+    EtatSimule raspberry = RASPBERRY_ACTIF;
+    Energie *e;
+    int n;
+
+    aleaInitialise(&alea, parametres.graine * 0x100000001B3ULL + numero);
+    capacite = PROFIL_CAPACITE_MAH * aleaEntre(&alea, parametres.santeMinimum, 1.0);
+    charge = capacite * aleaEntre(&alea, parametres.chargeMinimum, 1.0);
+    resistance = aleaEntre(&alea, PROFIL_RESISTANCE_NEUVE, PROFIL_RESISTANCE_USEE) / 1000.0;
+    rendement = aleaEntre(&alea, BOOST_RENDEMENT_MINIMUM, BOOST_RENDEMENT_MAXIMUM);
+    puissanceBase = aleaEntre(&alea, parametres.puissanceMinimum, parametres.puissanceMaximum);
+    duree = (unsigned long) (-log(1.0 - aleaUniforme(&alea)) * parametres.dureeMoyenne * 60) + 1;
+    dureeArret = (unsigned int) aleaEntre(&alea, RASPBERRY_ARRET_MINIMUM, RASPBERRY_ARRET_MAXIMUM);
+
+    memset(resultat, 0, sizeof (Resultat));
+
+    // Sur secteur, l'accumulateur est au repos:
+    initialiseEnergie();
+    jaugeInitialise();
+    for (n = 0; n < 10; n++) {
+        mesureTemperature(TEMPERATURE_AMBIANTE);
+        mesureAlimentation(numerise(ALIMENTATION_TENSION));
+        mesureAccumulateur(numerise(tensionAVide(100 * charge / capacite)));
+        jaugeConversions(numerise(tensionAVide(100 * charge / capacite)));
+        mesureBoost(numerise(BOOST_TENSION_CHARGE));
+        jaugeSeconde(energieActuelle());
+        energieSeconde();
+    }
+
+    for (t = 1; t < SCENARIO_DUREE_MAXIMALE; t++) {
+        if (t >= duree) {
+            resultat->survie = 1;
+            break;
+        }
+        e = mesureAlimentation(0);
+
+        // Consommation du raspberry:
+        if (raspberry == RASPBERRY_ARRETE) {
+            puissance = RASPBERRY_PUISSANCE_ARRETE;
+        } else {
+            if (rafale) {
+                rafale--;
+            } else if (aleaUniforme(&alea) < RASPBERRY_PROBABILITE_RAFALE) {
+                rafale = (unsigned int) aleaEntre(&alea, 10, 60);
+            }
+            puissance = puissanceBase + (rafale ? RASPBERRY_PUISSANCE_RAFALE : 0);
+        }
+
+        // Tension de l'accumulateur sous la charge P / (η.V), résistance
+        // interne comprise: V² - Vo.V + P.R/η = 0.
+        tension = tensionAVide(100 * charge / capacite);
+        courant = 0;
+        if (e->solliciterAccumulateur) {
+            discriminant = tension * tension - 4 * puissance * resistance / rendement;
+            if (discriminant < 0) {
+                tension = 0;
+            } else {
+                tension = (tension + sqrt(discriminant)) / 2;
+                courant = puissance / (rendement * tension);
+            }
+            charge -= courant * 1000 / 3600;
+            if ((tension < BOOST_TENSION_MINIMALE) || (charge <= 0)) {
+                // Le convertisseur Boost décroche.
+                resultat->brutal = raspberry != RASPBERRY_ARRETE;
+                break;
+            }
+        }
+
+        mesureAccumulateur(numerise(tension));
+        jaugeConversions(numerise(tension));
+        mesureBoost(numerise(raspberry == RASPBERRY_ARRETE ? BOOST_TENSION_A_VIDE : BOOST_TENSION_CHARGE));
+        jaugeSeconde(energieActuelle());
+        e = energieSeconde();
+
+        if (etatAccumulateur == UTILISABLE_MAIS_FAIBLE) {
+            resultat->secondesFaible++;
+        }
+        if (!e->solliciterAccumulateur) {
+            resultat->brutal = raspberry != RASPBERRY_ARRETE;
+            break;
+        }
+
+        // Le raspberry s'arrête comme upsd, d'après la jauge:
+        switch (raspberry) {
+            case RASPBERRY_ACTIF:
+                if (arretNecessaire()) {
+                    energieAnnonceArret(parametres.delaiAnnonce);
+                    raspberry = RASPBERRY_S_ARRETE;
+                    restant = dureeArret;
+                }
+                break;
+            case RASPBERRY_S_ARRETE:
+                if (--restant == 0) {
+                    raspberry = RASPBERRY_ARRETE;
+                }
+                break;
+            case RASPBERRY_ARRETE:
+                break;
+        }
+    }
+
+    resultat->autonomie = t;
+    resultat->chargeRestante = charge > 0 ? 100 * charge / capacite : 0;
+}
+
+static int compare(const void *a, const void *b) {
+    unsigned long x = *(const unsigned long *) a, y = *(const unsigned long *) b;
+    return (x > y) - (x < y);
+}
+
+static void utilisation(const char *programme) {
+    fprintf(stderr, "Utilisation: %s [-n nombre] [-j processus] [-g graine] [-d minutes] "
+            "[-p min:max] [-s santé] [-e charge] [-m minutes] [-c %%] [-a s] "
+            "[-U seuil] [-F seuil]\n", programme);
+    exit(2);
+}
+
+static void litOptions(int argc, char **argv) {
+    int option;
+
+    while ((option = getopt(argc, argv, "n:j:g:d:p:s:e:m:c:a:U:F:")) != -1) {
+        switch (option) {
+            case 'n': parametres.scenarios = strtoul(optarg, NULL, 0); break;
+            case 'j': parametres.processus = atoi(optarg); break;
+            case 'g': parametres.graine = strtoul(optarg, NULL, 0); break;
+            case 'd': parametres.dureeMoyenne = atof(optarg); break;
+            case 'p':
+                if (sscanf(optarg, "%lf:%lf", &parametres.puissanceMinimum, &parametres.puissanceMaximum) != 2) {
+                    utilisation(argv[0]);
+                }
+                break;
+            case 's': parametres.santeMinimum = atof(optarg); break;
+            case 'e': parametres.chargeMinimum = atof(optarg); break;
+            case 'm': parametres.minutesArret = atoi(optarg); break;
+            case 'c': parametres.chargeArret = atoi(optarg); break;
+            case 'a': parametres.delaiAnnonce = atoi(optarg); break;
+            case 'U': calibration.accumulateurPasUtilisable = atoi(optarg); break;
+            case 'F': calibration.accumulateurFaible = atoi(optarg); break;
+            default: utilisation(argv[0]);
+        }
+    }
+    if (parametres.scenarios == 0 || parametres.delaiAnnonce == 0) {
+        utilisation(argv[0]);
+    }
+    if (parametres.processus <= 0) {
+        parametres.processus = (int) sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    if (parametres.processus <= 0) {
+        parametres.processus = 1;
+    }
+}
+
+int main(int argc, char **argv) {
+    Resultat *resultats;
+    unsigned long *autonomies;
+    unsigned long n, epuisees = 0, survies = 0, brutaux = 0;
+    double autonomie = 0, faible = 0, restante = 0;
+    int p;
+
+    litOptions(argc, argv);
+
+    // Chaque processus écrit les résultats de ses scénarios à leur place.
+    resultats = mmap(NULL, parametres.scenarios * sizeof (Resultat),
+            PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (resultats == MAP_FAILED) {
+        perror("mmap");
+        return 1;
+    }
+    for (p = 0; p < parametres.processus; p++) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            perror("fork");
+            return 1;
+        }
+        if (pid == 0) {
+            for (n = p; n < parametres.scenarios; n += parametres.processus) {
+                simule(n, &resultats[n]);
+            }
+            _exit(0);
+        }
+    }
+    while (wait(NULL) > 0);
+
+    autonomies = malloc(parametres.scenarios * sizeof (unsigned long));
+    if (autonomies == NULL) {
+        perror("malloc");
+        return 1;
+    }
+    for (n = 0; n < parametres.scenarios; n++) {
+        if (resultats[n].survie) {
+            survies++;
+        } else {
+            autonomies[epuisees++] = resultats[n].autonomie;
+            autonomie += resultats[n].autonomie;
+            restante += resultats[n].chargeRestante;
+        }
+        brutaux += resultats[n].brutal;
+        faible += resultats[n].secondesFaible;
+    }
+
+    printf("Profil: %s, %umAh, seuils %u/%u (pas utilisable/faible)\n",
+#ifdef PROFIL_NIMH
+            "NiMH",
+#else
+            "Li-ion",
+#endif
+            PROFIL_CAPACITE_MAH, calibration.accumulateurPasUtilisable, calibration.accumulateurFaible);
+    printf("Scénarios: %lu, sur %d processus\n", parametres.scenarios, parametres.processus);
+    printf("Coupures plus courtes que l'autonomie: %lu\n", survies);
+    printf("Coupures plus longues que l'autonomie: %lu\n", epuisees);
+    if (epuisees) {
+        qsort(autonomies, epuisees, sizeof (unsigned long), compare);
+        printf("  Autonomie moyenne: %.1f minutes\n", autonomie / epuisees / 60);
+        printf("  Autonomie 5%%/50%%/95%%: %.1f/%.1f/%.1f minutes\n",
+                autonomies[epuisees * 5 / 100] / 60.0,
+                autonomies[epuisees / 2] / 60.0,
+                autonomies[epuisees * 95 / 100] / 60.0);
+        printf("  Charge restante moyenne à l'arrêt: %.1f%%\n", restante / epuisees);
+    }
+    printf("Arrêts brutaux: %lu (%.2f%%)\n", brutaux, 100.0 * brutaux / parametres.scenarios);
+    printf("Temps moyen en UTILISABLE_MAIS_FAIBLE: %.1f secondes\n", faible / parametres.scenarios);
+
+    free(autonomies);
+    return 0;
+}
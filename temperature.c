@@ -0,0 +1,78 @@
+#include "temperature.h"
+#include "test.h"
+
+/**
+ * Point de la courbe de la thermistance.
+ */
+typedef struct {
+    /** Conversion sur 8 bits. */
+    unsigned char conversion;
+    /** Température correspondante, en °C. */
+    signed char degres;
+} PointThermistance;
+
+/**
+ * Courbe de la thermistance, par pas de 10°C.
+ * La conversion diminue lorsque la température augmente.
+ */
+static const PointThermistance courbeThermistance[] = {
+    {227, -20},
+    {211, -10},
+    {190,   0},
+    {166,  10},
+    {141,  20},
+    {116,  30},
+    { 94,  40},
+    { 74,  50},
+    { 59,  60},
+    { 46,  70},
+    { 36,  80}
+};
+
+#define NOMBRE_POINTS_THERMISTANCE (sizeof(courbeThermistance) / sizeof(PointThermistance))
+
+signed char temperatureDegres(unsigned char conversion) {
+    unsigned char n;
+    const PointThermistance *a, *b;
+    
+    if ((conversion < TEMPERATURE_CONVERSION_COURT_CIRCUIT) || (conversion > TEMPERATURE_CONVERSION_COUPEE)) {
+        return TEMPERATURE_SONDE_DEFAILLANTE;
+    }
+    if (conversion >= courbeThermistance[0].conversion) {
+        return courbeThermistance[0].degres;
+    }
+    for (n = 1; n < NOMBRE_POINTS_THERMISTANCE; n++) {
+        b = &courbeThermistance[n];
+        if (conversion >= b->conversion) {
+            a = &courbeThermistance[n - 1];
+            return a->degres + 
+                    (signed char) (((a->conversion - conversion) * 10) / (a->conversion - b->conversion));
+        }
+    }
+    return courbeThermistance[NOMBRE_POINTS_THERMISTANCE - 1].degres;
+}
+
+#ifdef TEST
+
+static void convertit_la_tension_en_degres() {
+    verifieEgalite("TMPCO01", temperatureDegres(141), 20);
+    verifieEgalite("TMPCO02", temperatureDegres(190), 0);
+    verifieEgalite("TMPCO03", temperatureDegres(128), 25);
+    verifieEgalite("TMPCO04", temperatureDegres(TEMPERATURE_CONVERSION_COUPEE), -20);
+    verifieEgalite("TMPCO05", temperatureDegres(TEMPERATURE_CONVERSION_COURT_CIRCUIT), 80);
+    verifieEgalite("TMPCO06", temperatureDegres(200), -5);
+}
+
+static void detecte_une_sonde_absente_ou_defaillante() {
+    verifieEgalite("TMPSD01", temperatureDegres(255), TEMPERATURE_SONDE_DEFAILLANTE);
+    verifieEgalite("TMPSD02", temperatureDegres(TEMPERATURE_CONVERSION_COUPEE + 1), TEMPERATURE_SONDE_DEFAILLANTE);
+    verifieEgalite("TMPSD03", temperatureDegres(0), TEMPERATURE_SONDE_DEFAILLANTE);
+    verifieEgalite("TMPSD04", temperatureDegres(TEMPERATURE_CONVERSION_COURT_CIRCUIT - 1), TEMPERATURE_SONDE_DEFAILLANTE);
+}
+
+void testeTemperature() {
+    convertit_la_tension_en_degres();
+    detecte_une_sonde_absente_ou_defaillante();
+}
+
+#endif
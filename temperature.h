@@ -0,0 +1,55 @@
+#ifndef TEMPERATURE_H
+#define	TEMPERATURE_H
+
+/**
+ * La charge de l'accumulateur est suspendue en dessous de cette 
+ * température, en °C.
+ */
+#define TEMPERATURE_CHARGE_MINIMUM 0
+
+/**
+ * La charge de l'accumulateur est suspendue au dessus de cette 
+ * température, en °C.
+ */
+#define TEMPERATURE_CHARGE_MAXIMUM 45
+
+/**
+ * La charge reprend lorsque la température est revenue de cet écart
+ * à l'intérieur des limites, en °C.
+ */
+#define TEMPERATURE_HYSTERESIS 3
+
+/**
+ * Conversion en dessous de laquelle la thermistance est en court-circuit
+ * (plus de 120°C).
+ */
+#define TEMPERATURE_CONVERSION_COURT_CIRCUIT 8
+
+/**
+ * Conversion au dessus de laquelle la thermistance est absente ou coupée
+ * (moins de -45°C): RA3 est tiré vers VDD.
+ */
+#define TEMPERATURE_CONVERSION_COUPEE 247
+
+/**
+ * Température rendue lorsque la thermistance est absente ou défaillante.
+ * La charge n'est alors pas suspendue.
+ */
+#define TEMPERATURE_SONDE_DEFAILLANTE -128
+
+/**
+ * Convertit la tension de la thermistance en température.
+ * La thermistance CTN de 10kΩ (B=3435) est reliée à la masse, avec une 
+ * résistance de 10kΩ vers VDD, sur RA3 / AN3. La mesure est ratiométrique,
+ * et n'a pas besoin d'être compensée.
+ * @param conversion La conversion, sur 8 bits.
+ * @return La température, en °C, limitée entre -20 et 80°C, ou
+ * TEMPERATURE_SONDE_DEFAILLANTE si la conversion est proche d'un rail.
+ */
+signed char temperatureDegres(unsigned char conversion);
+
+#ifdef TEST
+void testeTemperature();
+#endif
+
+#endif
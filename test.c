@@ -33,6 +33,28 @@ void initialiseUART1() {
     TXSTAbits.TXEN = 1;  // Active l'émetteur.
 }
 
+/** Coût du démarrage et de la lecture du chronomètre, en cycles. */
+static unsigned int coutChronometre = 0;
+
+void chronometreDemarre() {
+    T3CON = 0;              // Fosc/4, sans pré-diviseur, arrêté.
+    T3CONbits.RD16 = 1;     // Lecture de 16 bits en une opération.
+    TMR3H = 0;
+    TMR3L = 0;
+    T3CONbits.TMR3ON = 1;
+}
+
+unsigned int chronometreLit() {
+    unsigned int cycles;
+    T3CONbits.TMR3ON = 0;
+    cycles = TMR3L;
+    cycles |= (unsigned int) TMR3H << 8;
+    if (cycles < coutChronometre) {
+        return 0;
+    }
+    return cycles - coutChronometre;
+}
+
 /** Nombre de tests en erreur depuis l'initialisation des tests. */
 static int testsEnErreur = 0;
 
@@ -42,6 +64,9 @@ static int testsSucces = 0;
 void initialiseTests() {
     initialiseUART1();
     testsEnErreur = 0;
+    coutChronometre = 0;
+    chronometreDemarre();
+    coutChronometre = chronometreLit();
     printf("\r\nLancement des tests...\r\n");
 }
 
@@ -55,6 +80,21 @@ unsigned char verifieEgalite(const char *testId, int valeurObtenue, int valeurAt
     return 0;
 }
 
+unsigned char verifieInferieur(const char *testId, unsigned int valeurObtenue, unsigned int maximum) {
+    if (valeurObtenue > maximum) {
+        printf("%s: Valeur obtenue %u - Maximum %u\r\n", testId, valeurObtenue, maximum);
+        testsEnErreur++;
+        return 255;
+    }
+    testsSucces++;
+    return 0;
+}
+
+unsigned char verifieCycles(const char *testId, unsigned int cycles, unsigned int maximum) {
+    printf("%s: %u cycles (maximum %u)\r\n", testId, cycles, maximum);
+    return verifieInferieur(testId, cycles, maximum);
+}
+
 void finaliseTests() {
     printf("%d tests en succes\r\n", testsSucces);
     printf("%d tests en erreur\r\n", testsEnErreur);
@@ -18,6 +18,36 @@ void initialiseTests();
  */
 unsigned char verifieEgalite(const char *testId, int value, int expectedValue);
 
+/**
+ * Vérifie si la valeur obtenue ne dépasse pas la valeur maximum.
+ * @param testId Identifiant du test.
+ * @param value Valeur obtenue.
+ * @param maximum Valeur maximum.
+ * @return 1 si le test échoue.
+ */
+unsigned char verifieInferieur(const char *testId, unsigned int value, unsigned int maximum);
+
+/**
+ * Affiche le nombre de cycles mesurés, et vérifie qu'il ne dépasse pas
+ * le budget.
+ * @param testId Identifiant du test.
+ * @param cycles Cycles mesurés.
+ * @param maximum Budget, en cycles.
+ * @return 1 si le test échoue.
+ */
+unsigned char verifieCycles(const char *testId, unsigned int cycles, unsigned int maximum);
+
+/**
+ * Démarre le chronomètre de cycles d'instruction (temporisateur 3).
+ */
+void chronometreDemarre();
+
+/**
+ * @return Le nombre de cycles d'instruction depuis le démarrage du 
+ * chronomètre, moins le coût du chronomètre lui-même.
+ */
+unsigned int chronometreLit();
+
 /**
  * Affiche le nombre de tests en échec.
  */